@@ -80,6 +80,16 @@ static inline void *memcpy(void *dest, const void *src, size_t n) {
     }
     return dest;
 }
+static inline void *memmove(void *dest, const void *src, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+    if(d < s) {
+        for(size_t i = 0; i < n; i++) d[i] = s[i];
+    } else {
+        while(n--) d[n] = s[n];
+    }
+    return dest;
+}
 static inline void *memset(void *s, int c, size_t n) {
     unsigned char *p = (unsigned char *)s;
     while(n--) *p++ = (unsigned char)c;
@@ -251,6 +261,20 @@ void assert(int c);  // TODO: are we sure we want to require wasm embedder to pr
 #define EXT_PRINTF_FORMAT(a, b)
 #endif  // __GNUC__
 
+// Hints the cpu to bring the cache line of `addr` into the cache ahead of its use
+#if defined(__GNUC__) || defined(__clang__)
+#define EXT_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define EXT_PREFETCH(addr) ((void)(addr))
+#endif  // defined(__GNUC__) || defined(__clang__)
+
+// Marks a function that might not be used, so that the compiler doesn't warn about it
+#if defined(__GNUC__) || defined(__clang__)
+#define EXT_MAYBE_UNUSED __attribute__((unused))
+#else
+#define EXT_MAYBE_UNUSED
+#endif  // defined(__GNUC__) || defined(__clang__)
+
 // -----------------------------------------------------------------------------
 // SECTION: Logging
 //
@@ -315,6 +339,89 @@ Ext_Context *ext_pop_context(void);
         pop_context();              \
     } while(0)
 
+// -----------------------------------------------------------------------------
+// SECTION: Mutex
+//
+// A minimal mutex over the platform threading library, used by the concurrent data structures.
+// Without the EXTLIB_THREADSAFE flag all operations are no-ops, so code using mutexes still
+// compiles (and runs single-threaded) in non-threadsafe builds.
+//
+// USAGE
+// ```c
+// Mutex m;
+// mutex_init(&m);
+// mutex_lock(&m);
+//      // Critical section
+// mutex_unlock(&m);
+// mutex_destroy(&m);
+// ```
+#ifdef EXTLIB_THREADSAFE
+#if defined(EXT_POSIX)
+#include <pthread.h>
+#define EXT_MUTEX_PTHREAD
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define EXT_MUTEX_C11
+#else
+#warning "mutexes are not supported on this platform. Fallback to no-op (non-thread-safe) mutexes."
+#endif
+#endif  // EXTLIB_THREADSAFE
+
+typedef struct {
+#if defined(EXT_MUTEX_PTHREAD)
+    pthread_mutex_t handle;
+#elif defined(EXT_MUTEX_C11)
+    mtx_t handle;
+#else
+    char unused;
+#endif
+} Ext_Mutex;
+
+void ext_mutex_init(Ext_Mutex *m);
+void ext_mutex_destroy(Ext_Mutex *m);
+void ext_mutex_lock(Ext_Mutex *m);
+void ext_mutex_unlock(Ext_Mutex *m);
+
+// -----------------------------------------------------------------------------
+// SECTION: Threads
+//
+// A minimal thread over the same threading library used by `Mutex`, used by the parallel data
+// structure operations.
+// Without the EXTLIB_THREADSAFE flag `thread_create` runs the function to completion on the calling
+// thread, and `thread_join` does nothing, so code using threads still runs correctly (but
+// sequentially) in non-threadsafe builds.
+//
+// USAGE
+// ```c
+// void work(void *arg) {
+//     // ...
+// }
+//
+// Thread t;
+// thread_create(&t, work, NULL);
+// thread_join(&t);
+// ```
+//
+// NOTE
+// The `Thread` struct must not be moved until the thread is joined.
+// A new thread starts with the default context, so it must not rely on allocators or settings
+// pushed in the context of the thread that created it.
+
+typedef void (*Ext_ThreadFn)(void *arg);
+
+typedef struct {
+#if defined(EXT_MUTEX_PTHREAD)
+    pthread_t handle;
+#elif defined(EXT_MUTEX_C11)
+    thrd_t handle;
+#endif
+    Ext_ThreadFn fn;
+    void *arg;
+} Ext_Thread;
+
+void ext_thread_create(Ext_Thread *t, Ext_ThreadFn fn, void *arg);
+void ext_thread_join(Ext_Thread *t);
+
 // -----------------------------------------------------------------------------
 // SECTION: Allocators
 //
@@ -338,7 +445,7 @@ Ext_Context *ext_pop_context(void);
 // // ... other allocator functions (my_allocator_realloc_fn, my_allocator_free_fn)
 //
 // MyNewAllocator my_new_allocator = {
-//     {my_allocator_alloc_fn, my_allocator_realloc_fn, my_allocator_free_fn},
+//     {my_allocator_alloc_fn, my_allocator_realloc_fn, my_allocator_free_fn, 0 /* flags */},
 //     // other fields of your allocator
 // }
 // ```
@@ -351,10 +458,25 @@ Ext_Context *ext_pop_context(void);
 //     // ...
 // pop_context()
 // ```
+
+// Capabilities of an allocator, that containers can use to pick an allocation strategy.
+// Custom allocators that don't have any of these should set `flags` to 0.
+typedef enum {
+    // Memory is only reclaimed when freeing the last allocation, and only the last allocation can
+    // be resized in place, as in the arena and temp allocators.
+    // Instead of allocating a new table and freeing the old one on rehash, `hmap`, `hset`, `shmap`,
+    // `rhmap`, `swmap`, `dmap`, `iset`, `ghmap` and `ckmap` extend the old table and move the new
+    // one over it, so that no dead tables are left behind. `ihmap` keeps both tables alive while
+    // migrating, so it can't do the same.
+    EXT_ALLOCATOR_LIFO = 1 << 0,
+} Ext_AllocatorFlags;
+
 typedef struct Ext_Allocator {
     void *(*alloc)(struct Ext_Allocator *, size_t size);
     void *(*realloc)(struct Ext_Allocator *, void *ptr, size_t old_size, size_t new_size);
     void (*free)(struct Ext_Allocator *, void *ptr, size_t size);
+    // Allocator flags. See `AllocatorFlags` enum
+    Ext_AllocatorFlags flags;
 } Ext_Allocator;
 
 // ext_new:
@@ -473,6 +595,14 @@ typedef enum {
     // When a single allocation requests more than `page_size` bytes, the arena
     // will request a larger page from the system instead of failing.
     EXT_ARENA_FLEXIBLE_PAGE = 1 << 2,
+    // Reserves a single large range of virtual memory (`page_size` bytes, by default
+    // `EXT_ARENA_VM_RESERVE`) instead of chaining pages, and commits it on demand as the arena
+    // grows. Allocations are contiguous, so reallocating the last allocation never copies.
+    // Only supported on POSIX systems, elsewhere the arena falls back to regular pages.
+    EXT_ARENA_VIRTUAL = 1 << 3,
+    // With `EXT_ARENA_VIRTUAL`, `arena_reset` and `arena_rewind` decommit the memory past the
+    // reset point, returning it to the OS.
+    EXT_ARENA_DECOMMIT = 1 << 4,
 } Ext_ArenaFlags;
 
 // An allocated chunk in the arena
@@ -501,6 +631,8 @@ typedef struct Ext_Arena {
     // `EXT_DEFAULT_ALIGNMENT`.
     size_t alignment;
     // The default page size of the arena. By default it's `EXT_ARENA_PAGE_SZ`.
+    // With `EXT_ARENA_VIRTUAL` it's the size of the reserved range, by default
+    // `EXT_ARENA_VM_RESERVE`.
     size_t page_size;
     // `Allocator` used to allocate pages. By default uses the current context allocator.
     Ext_Allocator *page_allocator;
@@ -518,7 +650,8 @@ typedef struct Ext_Arena {
 // `alignment` will be the alignment of allocations returned by the arena. If 0 the default
 // alignment of `EXT_DEFAULT_ALIGNMENT` will be used.
 // `page_size` is the size of the arena interal pages. if 0 the default page size of
-// `EXT_ARENA_PAGE_SZ` will be used.
+// `EXT_ARENA_PAGE_SZ` will be used. With `EXT_ARENA_VIRTUAL` it is the size of the virtual range
+// to reserve, and if 0 `EXT_ARENA_VM_RESERVE` will be used.
 // `flags` used to customize the arena's behaviour. See `ArenaFlags` enum.
 Ext_Arena ext_new_arena(Ext_Allocator *page_alloc, size_t alignment, size_t page_size,
                         Ext_ArenaFlags flags);
@@ -566,6 +699,305 @@ char *ext_arena_sprintf(Ext_Arena *a, const char *fmt, ...) EXT_PRINTF_FORMAT(2,
 char *ext_arena_vsprintf(Ext_Arena *a, const char *fmt, va_list ap);
 #endif
 
+// -----------------------------------------------------------------------------
+// SECTION: Concurrent arena
+//
+// An arena allocator that can be shared by multiple threads.
+// Allocations bump the offset of the current page with an atomic fetch-add, so threads only
+// synchronize on a single atomic operation in the common case. When the page is full, the thread
+// allocates a new one and installs it with a compare-and-swap. If another thread installed its page
+// first, the new page is released and the allocation is retried on the winner's page.
+// The arena is only thread safe when the library is compiled with EXTLIB_THREADSAFE.
+//
+// USAGE
+// ```c
+// ConcurrentArena arena = new_concurrent_arena(NULL, 0, 0);
+//
+// void worker(void *arg) {
+//     Context ctx = *ext_context;
+//     ctx.alloc = &arena.base;
+//     push_context(&ctx);
+//         // Allocate from all threads at once
+//     pop_context();
+// }
+//
+// // ... start and join the workers
+// concurrent_arena_destroy(&arena);
+// ```
+//
+// NOTE
+// As in `Arena`, only the last allocation of the current page can be resized or freed in place.
+// With many threads allocating concurrently this rarely succeeds, so realloc usually copies.
+// The page allocator is called concurrently by the allocating threads, so it must be thread safe
+// (the default allocator is). `reset` and `destroy` must not be called while other threads are
+// using the arena.
+
+typedef struct Ext_ConcurrentArenaPage {
+    struct Ext_ConcurrentArenaPage *next;
+    // Start of the allocatable memory, aligned to the arena's alignment
+    char *start;
+    // Bump offset from `start`. Can grow past `capacity` once the page is full
+    size_t offset, capacity;
+} Ext_ConcurrentArenaPage;
+
+typedef struct Ext_ConcurrentArena {
+    Ext_Allocator base;
+    // The alignment of the allocations returned by the arena. By default is
+    // `EXT_DEFAULT_ALIGNMENT`.
+    size_t alignment;
+    // The size of the arena pages. By default it's `EXT_ARENA_PAGE_SZ`.
+    size_t page_size;
+    // `Allocator` used to allocate pages. By default uses the current context allocator.
+    Ext_Allocator *page_allocator;
+    // Page allocations are bumped from, followed by the list of full pages
+    Ext_ConcurrentArenaPage *page;
+    // Dedicated pages of allocations larger than a page
+    Ext_ConcurrentArenaPage *large_pages;
+    // Current bytes allocated in the arena
+    size_t allocated;
+} Ext_ConcurrentArena;
+
+// Creates a new concurrent arena. Parameters are the same of `new_arena`
+Ext_ConcurrentArena ext_new_concurrent_arena(Ext_Allocator *page_alloc, size_t alignment,
+                                             size_t page_size);
+// Allocates `size` bytes in the arena
+void *ext_concurrent_arena_alloc(Ext_ConcurrentArena *a, size_t size);
+// Reallocates `new_size` bytes. If `ptr` is the last allocation of the current page, it tries to
+// resize it in-place. Otherwise, it allocates a new region of `new_size` bytes and copies the data
+// over.
+void *ext_concurrent_arena_realloc(Ext_ConcurrentArena *a, void *ptr, size_t old_size,
+                                   size_t new_size);
+// Frees a previous allocation of `size` bytes. It only actually frees data if `ptr` is the last
+// allocation of the current page.
+void ext_concurrent_arena_free(Ext_ConcurrentArena *a, void *ptr, size_t size);
+// Resets the whole arena, keeping only the current page.
+void ext_concurrent_arena_reset(Ext_ConcurrentArena *a);
+// Frees all memory allocated in the arena and resets it.
+void ext_concurrent_arena_destroy(Ext_ConcurrentArena *a);
+
+// -----------------------------------------------------------------------------
+// SECTION: Pool allocator
+//
+// A pool allocator for objects of a single size.
+// Objects are carved from slabs allocated from a parent allocator, and freed objects are kept in an
+// intrusive free list, so both allocation and deallocation are O(1) and never touch the parent
+// allocator once the pool is warm. Unlike an arena, objects can be freed individually and in any
+// order.
+// `Pool` conforms to the `Allocator` interface. Requests larger than the object size are forwarded
+// to the parent allocator, so a pool can be safely used as the context allocator, or as the
+// allocator of a container whose buffers don't fit in an object.
+//
+// USAGE
+// ```c
+// typedef struct Node {
+//     struct Node *next;
+//     int value;
+// } Node;
+//
+// Pool pool = new_pool(NULL, sizeof(Node), 0, 0);
+// Node *n = pool_alloc(&pool, sizeof(Node));
+// pool_free(&pool, n, sizeof(Node));
+// pool_destroy(&pool);
+// ```
+
+// An allocated slab of objects
+typedef struct Ext_PoolSlab {
+    struct Ext_PoolSlab *next;
+    // Number of objects carved from the slab
+    size_t used;
+} Ext_PoolSlab;
+
+typedef struct Ext_Pool {
+    Ext_Allocator base;
+    // Size of the pool objects, rounded up to the alignment
+    size_t object_size;
+    // The alignment of the objects. By default is `EXT_DEFAULT_ALIGNMENT`.
+    size_t alignment;
+    // Number of objects in a slab. By default slabs are about `EXT_POOL_SLAB_SZ` bytes
+    size_t slab_objects;
+    // `Allocator` used to allocate slabs and large requests. By default uses the current context
+    // allocator.
+    Ext_Allocator *parent;
+    // Linked list of slabs, newest first. Objects are carved from the first one
+    Ext_PoolSlab *slabs;
+    // Intrusive list of freed objects
+    void *free_list;
+    // Number of objects currently allocated from the pool
+    size_t count;
+} Ext_Pool;
+
+// Creates a new pool of objects of `object_size` bytes.
+// `parent` is the allocator used to allocate slabs. If NULL the current context allocator will be
+// used.
+// `alignment` will be the alignment of the objects. If 0 the default alignment of
+// `EXT_DEFAULT_ALIGNMENT` will be used.
+// `slab_objects` is the number of objects allocated at once in a slab. If 0 it's computed so that
+// a slab is about `EXT_POOL_SLAB_SZ` bytes.
+Ext_Pool ext_new_pool(Ext_Allocator *parent, size_t object_size, size_t alignment,
+                      size_t slab_objects);
+// Allocates an object. If `size` is larger than the object size, the allocation is forwarded to the
+// parent allocator
+void *ext_pool_alloc(Ext_Pool *p, size_t size);
+// Reallocates `new_size` bytes. Resizing within the object size is a no-op, otherwise the data is
+// moved between the pool and the parent allocator as needed
+void *ext_pool_realloc(Ext_Pool *p, void *ptr, size_t old_size, size_t new_size);
+// Frees an object, or forwards the deallocation to the parent allocator if `size` is larger than
+// the object size
+void ext_pool_free(Ext_Pool *p, void *ptr, size_t size);
+// Frees all objects at once, keeping only the newest slab for reuse. Large allocations forwarded to
+// the parent allocator are not affected.
+void ext_pool_reset(Ext_Pool *p);
+// Frees all slabs of the pool and resets it.
+void ext_pool_destroy(Ext_Pool *p);
+
+// -----------------------------------------------------------------------------
+// SECTION: Slab allocator
+//
+// A general purpose allocator that serves small allocations from size-classed `Pool`s.
+// Since `Allocator.free` and `realloc` receive the size of the allocation, the size class of a
+// block is computed directly from it, and blocks need no header. This removes the per-allocation
+// overhead of malloc for the small buffers, nodes and strings containers allocate all the time, and
+// packs blocks of the same size tightly in slabs.
+// Size classes are spaced by 16 bytes up to 128 bytes, then by a quarter of the power of two above
+// that, up to `EXT_SLAB_MAX_SIZE`. Larger allocations are forwarded to the parent allocator.
+//
+// USAGE
+// ```c
+// SlabAllocator slab = new_slab_allocator(NULL);
+// Context ctx = *ext_context;
+// ctx.alloc = &slab.base;
+// push_context(&ctx);
+//     // ...
+// pop_context();
+// slab_allocator_destroy(&slab);
+// ```
+//
+// NOTE
+// As with every `Allocator`, memory must be freed with the same size it was allocated (or last
+// reallocated) with, as that's the only way the allocator has to find its size class.
+// Freed memory is kept in the pools for reuse, and only returned to the parent allocator by
+// `slab_allocator_destroy`.
+
+// Largest allocation served from a size class
+#define EXT_SLAB_MAX_SIZE (16 * 1024)
+// Number of size classes: 8 up to 128 bytes, then 4 for each power of two up to `EXT_SLAB_MAX_SIZE`
+#define EXT_SLAB_CLASSES (8 + 4 * 7)
+
+typedef struct Ext_SlabAllocator {
+    Ext_Allocator base;
+    // `Allocator` used to allocate slabs and large blocks. By default uses the current context
+    // allocator.
+    Ext_Allocator *parent;
+    // A pool for each size class
+    Ext_Pool classes[EXT_SLAB_CLASSES];
+} Ext_SlabAllocator;
+
+// Creates a new slab allocator.
+// `parent` is the allocator used to allocate slabs and large blocks. If NULL the current context
+// allocator will be used.
+Ext_SlabAllocator ext_new_slab_allocator(Ext_Allocator *parent);
+// Allocates `size` bytes
+void *ext_slab_alloc(Ext_SlabAllocator *s, size_t size);
+// Reallocates `new_size` bytes. If the new size falls in the same size class, the block is
+// returned as-is
+void *ext_slab_realloc(Ext_SlabAllocator *s, void *ptr, size_t old_size, size_t new_size);
+// Frees a block of `size` bytes
+void ext_slab_free(Ext_SlabAllocator *s, void *ptr, size_t size);
+// Frees all slabs of the allocator. Large blocks must have already been freed.
+void ext_slab_allocator_destroy(Ext_SlabAllocator *s);
+// Returns the size of the block actually reserved for an allocation of `size` bytes, or `size`
+// itself for allocations larger than `EXT_SLAB_MAX_SIZE`
+size_t ext_slab_block_size(size_t size);
+
+// -----------------------------------------------------------------------------
+// SECTION: Thread cache allocator
+//
+// A general purpose allocator for multi-threaded programs, split in two layers:
+//   - `CentralHeap`, a `SlabAllocator` shared by all threads and protected by a mutex
+//   - `ThreadCache`, owned by a single thread, that keeps a magazine (a small stack) of free
+//     blocks for each size class of the slab allocator
+// Allocations and frees are served from the thread's magazines without any synchronization. When a
+// magazine runs empty it is refilled from the central heap, and when it's full half of it is
+// drained back, in batches of `EXT_TCACHE_BATCH` blocks under a single lock. Threads thus rarely
+// contend on the heap, and blocks freed by a thread other than the one that allocated them simply
+// migrate through the central heap.
+// The central heap is only thread safe when the library is compiled with EXTLIB_THREADSAFE.
+//
+// USAGE
+// ```c
+// CentralHeap heap;
+// central_heap_init(&heap, NULL);
+//
+// void worker(void *arg) {
+//     ThreadCache cache;
+//     thread_cache_init(&cache, &heap);
+//     Context ctx = *ext_context;
+//     ctx.alloc = &cache.base;
+//     push_context(&ctx);
+//         // Allocate and free from the thread
+//     pop_context();
+//     thread_cache_flush(&cache);
+// }
+//
+// // ... start and join the workers
+// central_heap_destroy(&heap);
+// ```
+//
+// NOTE
+// A thread cache must only be used by the thread that owns it, and must be flushed before the
+// thread exits or the heap is destroyed, otherwise the blocks in its magazines are lost.
+// The central heap also conforms to `Allocator`, locking on every operation. Use it for data
+// structures shared between threads, such as the allocator of a `shmap`.
+// Allocations larger than `EXT_SLAB_MAX_SIZE` go straight to the parent allocator of the heap,
+// which must be thread safe (the default allocator is).
+
+// Number of blocks cached per size class in a thread
+#ifndef EXT_TCACHE_MAGAZINE_SIZE
+#define EXT_TCACHE_MAGAZINE_SIZE 32
+#endif  // EXT_TCACHE_MAGAZINE_SIZE
+
+// Number of blocks moved at once between a thread cache and the central heap
+#define EXT_TCACHE_BATCH (EXT_TCACHE_MAGAZINE_SIZE / 2)
+
+EXT_STATIC_ASSERT(EXT_TCACHE_BATCH > 0, "thread cache magazines must hold at least 2 blocks");
+
+typedef struct Ext_CentralHeap {
+    Ext_Allocator base;
+    Ext_SlabAllocator slab;
+    Ext_Mutex lock;
+} Ext_CentralHeap;
+
+typedef struct Ext_TcacheMagazine {
+    void *blocks[EXT_TCACHE_MAGAZINE_SIZE];
+    size_t count;
+} Ext_TcacheMagazine;
+
+typedef struct Ext_ThreadCache {
+    Ext_Allocator base;
+    Ext_CentralHeap *heap;
+    // A magazine for each size class of the slab allocator
+    Ext_TcacheMagazine magazines[EXT_SLAB_CLASSES];
+} Ext_ThreadCache;
+
+// Initializes the central heap.
+// `parent` is the allocator used to allocate slabs and large blocks. If NULL the current context
+// allocator will be used.
+void ext_central_heap_init(Ext_CentralHeap *h, Ext_Allocator *parent);
+// Frees all memory of the heap. All thread caches must have been flushed.
+void ext_central_heap_destroy(Ext_CentralHeap *h);
+
+// Initializes a thread cache over `heap`
+void ext_thread_cache_init(Ext_ThreadCache *c, Ext_CentralHeap *heap);
+// Allocates `size` bytes
+void *ext_thread_cache_alloc(Ext_ThreadCache *c, size_t size);
+// Reallocates `new_size` bytes. If the new size falls in the same size class, the block is
+// returned as-is
+void *ext_thread_cache_realloc(Ext_ThreadCache *c, void *ptr, size_t old_size, size_t new_size);
+// Frees a block of `size` bytes
+void ext_thread_cache_free(Ext_ThreadCache *c, void *ptr, size_t size);
+// Returns all cached blocks to the central heap
+void ext_thread_cache_flush(Ext_ThreadCache *c);
+
 // -----------------------------------------------------------------------------
 // SECTION: Dynamic array
 //
@@ -913,49 +1345,173 @@ int ext_cmd_write(const char* cmd, const void* data, size_t size);
 // -----------------------------------------------------------------------------
 // SECTION: Hashmap
 //
+// A linear probing hashmap over a user-defined struct.
+// Deleted entries leave a tombstone behind, so that the probe sequences of the other keys are not
+// broken. Tombstones are counted alongside live entries for the purpose of the load factor: when
+// the table gets full, it is compacted in place if tombstones make up at least a quarter of the
+// load, and grown otherwise. This keeps probe sequences short under insert/delete churn without
+// doubling the memory of the map.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     size_t *hashes;
+//     size_t size, tombstones, capacity;
+//     Allocator *allocator;
+// } IntMap;
+//
+// IntMap map = {0};
+// hmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry *e;
+// hmap_get(&map, &((IntEntry){.key = 1}), &e);
+// hmap_delete(&map, &((IntEntry){.key = 1}));
+// hmap_free(&map);
+// ```
+//
+// NOTE
+// The map stores the full hash of each entry, to skip comparing keys that cannot match and to
+// rehash without calling the hash function again. Declaring the `hashes` field as `uint32_t *`
+// instead of `size_t *` makes the map keep only the low 32 bits of the hashes, halving the
+// metadata memory on 64-bit targets. This is a good trade-off for maps with small entries, as long
+// as the map holds far fewer than 2^32 entries.
 
 // Read as: size * 0.75, i.e. a load factor of 75%
 // This is basically doing:
 //   size / 2 + size / 4 = (3 * size) / 4
 #define EXT_HMAP_MAX_ENTRY_LOAD(size) (((size) >> 1) + ((size) >> 2))
 
-#define ext_hmap_put_ex(hmap, entry, hash, cmp)                                                  \
-    do {                                                                                         \
-        if((hmap)->size >= EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) {                      \
-            ext_hmap_grow_((void **)&(hmap)->entries, sizeof(*(hmap)->entries), &(hmap)->hashes, \
-                           &(hmap)->capacity, &(hmap)->allocator);                               \
-        }                                                                                        \
-        size_t hash_ = hash(entry);                                                              \
-        if(hash_ < 2) hash_ += 2;                                                                \
-        ext_hmap_find_index_(hmap, entry, hash_, cmp);                                           \
-        if(!EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                                           \
-            (hmap)->size++;                                                                      \
-        }                                                                                        \
-        (hmap)->hashes[idx_] = hash_;                                                            \
-        (hmap)->entries[idx_] = *(entry);                                                        \
+#define ext_hmap_put_ex(hmap, entry, hash, cmp)                              \
+    do {                                                                     \
+        ext_hmap_make_room_(hmap);                                           \
+        size_t hash_ = ext_hmap_fix_hash_(hmap, hash(entry));                \
+        ext_hmap_find_index_(hmap, entry, hash_, cmp);                       \
+        if(!EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                       \
+            if(EXT_HMAP_IS_TOMB((hmap)->hashes[idx_])) (hmap)->tombstones--; \
+            (hmap)->size++;                                                  \
+        }                                                                    \
+        (hmap)->hashes[idx_] = hash_;                                        \
+        (hmap)->entries[idx_] = *(entry);                                    \
+    } while(0)
+
+#define ext_hmap_get_ex(hmap, entry, out, hash, cmp)          \
+    do {                                                      \
+        size_t hash_ = ext_hmap_fix_hash_(hmap, hash(entry)); \
+        ext_hmap_find_index_(hmap, entry, hash_, cmp);        \
+        if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {         \
+            *(out) = &(hmap)->entries[idx_];                  \
+        } else {                                              \
+            *(out) = NULL;                                    \
+        }                                                     \
+    } while(0)
+
+#define ext_hmap_delete_ex(hmap, entry, hash, cmp)            \
+    do {                                                      \
+        size_t hash_ = ext_hmap_fix_hash_(hmap, hash(entry)); \
+        ext_hmap_find_index_(hmap, entry, hash_, cmp);        \
+        if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {         \
+            (hmap)->hashes[idx_] = EXT_HMAP_TOMB_MARK;        \
+            (hmap)->size--;                                   \
+            (hmap)->tombstones++;                             \
+            ext_hmap_auto_shrink_(hmap);                      \
+        }                                                     \
+    } while(0)
+
+// Inserts `n` entries from the array `arr` into the map.
+// The table is sized once up front, and the keys are hashed in batches of `EXT_HMAP_BATCH_SIZE`
+// in a separate pass from the probing, so building a large map from an array is much faster than
+// calling `put` in a loop. If the same key appears more than once, the last entry wins.
+#define ext_hmap_put_all_ex(hmap, arr, n, hash, cmp)                                         \
+    do {                                                                                     \
+        size_t n_ = (n);                                                                     \
+        ext_hmap_reserve(hmap, (hmap)->size + n_);                                           \
+        size_t batch_hashes_[EXT_HMAP_BATCH_SIZE];                                           \
+        for(size_t b_ = 0; b_ < n_; b_ += EXT_HMAP_BATCH_SIZE) {                             \
+            size_t batch_n_ = n_ - b_ < EXT_HMAP_BATCH_SIZE ? n_ - b_ : EXT_HMAP_BATCH_SIZE; \
+            for(size_t j_ = 0; j_ < batch_n_; j_++) {                                        \
+                batch_hashes_[j_] = ext_hmap_fix_hash_(hmap, hash(&(arr)[b_ + j_]));         \
+            }                                                                                \
+            for(size_t j_ = 0; j_ < batch_n_; j_++) {                                        \
+                ext_hmap_find_index_(hmap, &(arr)[b_ + j_], batch_hashes_[j_], cmp);         \
+                if(!EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                               \
+                    if(EXT_HMAP_IS_TOMB((hmap)->hashes[idx_])) (hmap)->tombstones--;         \
+                    (hmap)->size++;                                                          \
+                }                                                                            \
+                (hmap)->hashes[idx_] = batch_hashes_[j_];                                    \
+                (hmap)->entries[idx_] = (arr)[b_ + j_];                                      \
+            }                                                                                \
+        }                                                                                    \
     } while(0)
 
-#define ext_hmap_get_ex(hmap, entry, out, hash, cmp)   \
-    do {                                               \
-        size_t hash_ = hash(entry);                    \
-        if(hash_ < 2) hash_ += 2;                      \
-        ext_hmap_find_index_(hmap, entry, hash_, cmp); \
-        if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {  \
-            *(out) = &(hmap)->entries[idx_];           \
-        } else {                                       \
-            *(out) = NULL;                             \
-        }                                              \
+// Looks up the `n` keys in the array `keys`, storing in `outs[i]` a pointer to the entry matching
+// `keys[i]`, or NULL if not found.
+// Keys are hashed in batches of `EXT_HMAP_BATCH_SIZE`, prefetching their home slots, before any
+// probing takes place. This way the cache misses of the keys in a batch overlap, instead of each
+// lookup stalling on its own.
+#define ext_hmap_get_batch_ex(hmap, keys, n, outs, hash, cmp)                                \
+    do {                                                                                     \
+        size_t n_ = (n);                                                                     \
+        size_t batch_hashes_[EXT_HMAP_BATCH_SIZE];                                           \
+        for(size_t b_ = 0; b_ < n_; b_ += EXT_HMAP_BATCH_SIZE) {                             \
+            size_t batch_n_ = n_ - b_ < EXT_HMAP_BATCH_SIZE ? n_ - b_ : EXT_HMAP_BATCH_SIZE; \
+            if(!(hmap)->entries) {                                                           \
+                for(size_t j_ = 0; j_ < batch_n_; j_++) (outs)[b_ + j_] = NULL;              \
+                continue;                                                                    \
+            }                                                                                \
+            for(size_t j_ = 0; j_ < batch_n_; j_++) {                                        \
+                size_t hash_ = ext_hmap_fix_hash_(hmap, hash(&(keys)[b_ + j_]));             \
+                batch_hashes_[j_] = hash_;                                                   \
+                EXT_PREFETCH(&(hmap)->hashes[hash_ & (hmap)->capacity]);                     \
+                EXT_PREFETCH(&(hmap)->entries[hash_ & (hmap)->capacity]);                    \
+            }                                                                                \
+            for(size_t j_ = 0; j_ < batch_n_; j_++) {                                        \
+                ext_hmap_find_index_(hmap, &(keys)[b_ + j_], batch_hashes_[j_], cmp);        \
+                if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                                \
+                    (outs)[b_ + j_] = &(hmap)->entries[idx_];                                \
+                } else {                                                                     \
+                    (outs)[b_ + j_] = NULL;                                                  \
+                }                                                                            \
+            }                                                                                \
+        }                                                                                    \
     } while(0)
 
-#define ext_hmap_delete_ex(hmap, entry, hash, cmp)     \
-    do {                                               \
-        size_t hash_ = hash(entry);                    \
-        if(hash_ < 2) hash_ += 2;                      \
-        ext_hmap_find_index_(hmap, entry, hash_, cmp); \
-        if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {  \
-            (hmap)->hashes[idx_] = EXT_HMAP_TOMB_MARK; \
-            (hmap)->size--;                            \
-        }                                              \
+// Finds the entry matching `entry`, or inserts a new one if the key is not in the map, with a
+// single hash and probe. `out` is set to point to the entry in the table, and `inserted` to whether
+// it was just inserted. A new entry is zeroed, with only its key set, and is meant to be
+// initialized in place through `out`. `key_of` extracts the key to store from `entry`.
+//
+// USAGE
+// ```c
+// IntEntry *e;
+// bool inserted;
+// hmap_entry(&map, &((IntEntry){.key = 1}), &e, &inserted);
+// e->value++;
+// ```
+#define ext_hmap_entry_ex(hmap, entry, out, inserted, hash, cmp, key_of)      \
+    do {                                                                      \
+        if(!(hmap)->entries) ext_hmap_make_room_(hmap);                       \
+        size_t hash_ = ext_hmap_fix_hash_(hmap, hash(entry));                 \
+        size_t slot_;                                                         \
+        {                                                                     \
+            ext_hmap_find_index_(hmap, entry, hash_, cmp);                    \
+            slot_ = idx_;                                                     \
+        }                                                                     \
+        *(inserted) = !EXT_HMAP_IS_VALID((hmap)->hashes[slot_]);              \
+        if(*(inserted)) {                                                     \
+            /* Only make room when actually inserting, then probe again */    \
+            if((hmap)->size + (hmap)->tombstones >=                           \
+               EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) {               \
+                ext_hmap_make_room_(hmap);                                    \
+                ext_hmap_find_index_(hmap, entry, hash_, cmp);                \
+                slot_ = idx_;                                                 \
+            }                                                                 \
+            if(EXT_HMAP_IS_TOMB((hmap)->hashes[slot_])) (hmap)->tombstones--; \
+            (hmap)->size++;                                                   \
+            (hmap)->hashes[slot_] = hash_;                                    \
+            memset(&(hmap)->entries[slot_], 0, sizeof(*(hmap)->entries));     \
+            (hmap)->entries[slot_].key = key_of(entry);                       \
+        }                                                                     \
+        *(out) = &(hmap)->entries[slot_];                                     \
     } while(0)
 
 #define ext_hmap_put(hmap, entry) \
@@ -979,10 +1535,82 @@ int ext_cmd_write(const char* cmd, const void* data, size_t size);
 #define ext_hmap_delete_ss(hmap, entry) \
     ext_hmap_delete_ex(hmap, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
 
+#define ext_hmap_entry(hmap, entry, out, inserted)                                        \
+    ext_hmap_entry_ex(hmap, entry, out, inserted, ext_hmap_hash_bytes_, ext_hmap_memcmp_, \
+                      ext_hmap_key_entry_)
+// `key` is a `const char *`. The pointer is stored as is in new entries, not copied
+#define ext_hmap_entry_cstr(hmap, key, out, inserted)                                  \
+    ext_hmap_entry_ex(hmap, key, out, inserted, ext_hmap_hash_cstr_, ext_hmap_strcmp_, \
+                      ext_hmap_key_)
+// `key` is an `Ext_StringSlice`
+#define ext_hmap_entry_ss(hmap, key, out, inserted) \
+    ext_hmap_entry_ex(hmap, key, out, inserted, ext_hmap_hash_ss_, ext_hmap_sscmp_, ext_hmap_key_)
+
+#define ext_hmap_put_all(hmap, arr, n) \
+    ext_hmap_put_all_ex(hmap, arr, n, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_hmap_put_all_cstr(hmap, arr, n) \
+    ext_hmap_put_all_ex(hmap, arr, n, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_hmap_put_all_ss(hmap, arr, n) \
+    ext_hmap_put_all_ex(hmap, arr, n, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+
+// `keys` is an array of entries with the key set
+#define ext_hmap_get_batch(hmap, keys, n, outs) \
+    ext_hmap_get_batch_ex(hmap, keys, n, outs, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+// `keys` is an array of `const char *`
+#define ext_hmap_get_batch_cstr(hmap, keys, n, outs) \
+    ext_hmap_get_batch_ex(hmap, keys, n, outs, ext_hmap_hash_cstr_ptr_, ext_hmap_strcmp_ptr_)
+// `keys` is an array of `Ext_StringSlice`
+#define ext_hmap_get_batch_ss(hmap, keys, n, outs) \
+    ext_hmap_get_batch_ex(hmap, keys, n, outs, ext_hmap_hash_ss_ptr_, ext_hmap_sscmp_ptr_)
+
 #define ext_hmap_clear(hmap)                                                         \
     do {                                                                             \
         memset((hmap)->hashes, 0, sizeof(*(hmap)->hashes) * ((hmap)->capacity + 1)); \
         (hmap)->size = 0;                                                            \
+        (hmap)->tombstones = 0;                                                      \
+    } while(0)
+
+// Makes sure the map can hold at least `n` entries without having to grow.
+// Tombstones are purged in the process if they would otherwise take up the reserved room.
+#define ext_hmap_reserve(hmap, n)                                                             \
+    do {                                                                                      \
+        size_t reserve_n_ = (n);                                                              \
+        if(reserve_n_ + (hmap)->tombstones > EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) { \
+            if(reserve_n_ > EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) {                  \
+                ext_hmap_reserve_((void **)&(hmap)->entries, sizeof(*(hmap)->entries),        \
+                                  (void **)&(hmap)->hashes, sizeof(*(hmap)->hashes),          \
+                                  &(hmap)->capacity, reserve_n_, &(hmap)->allocator);         \
+                (hmap)->tombstones = 0;                                                       \
+            } else {                                                                          \
+                ext_hmap_compact(hmap);                                                       \
+            }                                                                                 \
+        }                                                                                     \
+    } while(0)
+
+// Purges all tombstones by rehashing the map in place, without changing its capacity.
+// This is done automatically by `put` when the table is full, but can also be called explicitly,
+// for example after a large batch of deletions.
+#define ext_hmap_compact(hmap)                                                           \
+    do {                                                                                 \
+        if((hmap)->tombstones) {                                                         \
+            ext_hmap_compact_((hmap)->entries, sizeof(*(hmap)->entries), (hmap)->hashes, \
+                              sizeof(*(hmap)->hashes), (hmap)->capacity);                \
+            (hmap)->tombstones = 0;                                                      \
+        }                                                                                \
+    } while(0)
+
+// Shrinks the table to the smallest capacity that can hold the current entries, purging all
+// tombstones. The table is never shrunk below `EXT_HMAP_INIT_CAPACITY`.
+// Call this after removing most of the entries of a map, so that its memory and the time taken to
+// iterate it follow its size again. See also `EXT_HMAP_AUTO_SHRINK`.
+#define ext_hmap_shrink_to_fit(hmap)                                               \
+    do {                                                                           \
+        if((hmap)->entries) {                                                      \
+            ext_hmap_shrink_((void **)&(hmap)->entries, sizeof(*(hmap)->entries),  \
+                             (void **)&(hmap)->hashes, sizeof(*(hmap)->hashes),    \
+                             &(hmap)->capacity, (hmap)->size, &(hmap)->allocator); \
+            (hmap)->tombstones = 0;                                                \
+        }                                                                          \
     } while(0)
 
 #define ext_hmap_free(hmap)                                                               \
@@ -1002,10 +1630,56 @@ int ext_cmd_write(const char* cmd, const void* data, size_t size);
 
 #define ext_hmap_end(hmap) \
     ext_hmap_end_((hmap)->entries, (hmap)->capacity, sizeof(*(hmap)->entries))
-#define ext_hmap_begin(hmap) \
-    ext_hmap_begin_((hmap)->entries, (hmap)->hashes, (hmap)->capacity, sizeof(*(hmap)->entries))
-#define ext_hmap_next(hmap, it) \
-    ext_hmap_next_((hmap)->entries, (hmap)->hashes, it, (hmap)->capacity, sizeof(*(hmap)->entries))
+#define ext_hmap_begin(hmap)                                                                    \
+    ext_hmap_begin_((hmap)->entries, (hmap)->hashes, sizeof(*(hmap)->hashes), (hmap)->capacity, \
+                    sizeof(*(hmap)->entries))
+#define ext_hmap_next(hmap, it)                                                                    \
+    ext_hmap_next_((hmap)->entries, (hmap)->hashes, sizeof(*(hmap)->hashes), it, (hmap)->capacity, \
+                   sizeof(*(hmap)->entries))
+
+// Number of buckets of the probe length histogram of `Ext_HmapStats`
+#ifndef EXT_HMAP_STATS_HISTOGRAM_SIZE
+#define EXT_HMAP_STATS_HISTOGRAM_SIZE 16
+#endif  // EXT_HMAP_STATS_HISTOGRAM_SIZE
+
+// Statistics about the health of a hashmap, as returned by `ext_hmap_stats`.
+// The probe length of an entry is its distance from the slot its hash maps to, so 0 means it sits
+// in its home slot. Long probe lengths are a symptom of a bad hash distribution, or of a table
+// that is too full.
+typedef struct Ext_HmapStats {
+    size_t size;         // Number of live entries
+    size_t capacity;     // Number of slots of the table
+    size_t tombstones;   // Number of deleted slots not yet reused or purged
+    double load_factor;  // (size + tombstones) / capacity
+    double avg_probe;    // Average probe length of the live entries
+    size_t max_probe;    // Longest probe length of the live entries
+    // Number of entries for each probe length. The last bucket also counts all longer probes
+    size_t probe_histogram[EXT_HMAP_STATS_HISTOGRAM_SIZE];
+    size_t entries_bytes;  // Memory used by the entries array
+    size_t hashes_bytes;   // Memory used by the hashes array
+} Ext_HmapStats;
+
+// Fills `out` with statistics about the map.
+// This scans the whole table, so it is meant for debugging and monitoring, not for hot paths.
+#define ext_hmap_stats(hmap, out)                                                            \
+    ext_hmap_stats_((hmap)->hashes, sizeof(*(hmap)->hashes), (hmap)->capacity, (hmap)->size, \
+                    (hmap)->tombstones, sizeof(*(hmap)->entries), out)
+
+#ifdef EXT_HMAP_PROBE_COUNTERS
+// Counters updated by every lookup on a linear probing table (`hmap`, and the incremental and
+// sharded maps built on top of it). Only available when compiling with EXT_HMAP_PROBE_COUNTERS.
+// The counters are global, and thread local when compiling with EXTLIB_THREADSAFE.
+typedef struct Ext_HmapCounters {
+    size_t lookups;      // Number of lookups performed
+    size_t probes;       // Number of slots visited by all lookups
+    size_t comparisons;  // Number of times the `cmp` function was called on a key
+} Ext_HmapCounters;
+
+extern EXT_TLS Ext_HmapCounters ext_hmap_counters;
+
+// Resets all counters to zero
+void ext_hmap_reset_counters(void);
+#endif  // EXT_HMAP_PROBE_COUNTERS
 
 #ifndef EXT_HMAP_INIT_CAPACITY
 #define EXT_HMAP_INIT_CAPACITY 8
@@ -1014,6 +1688,17 @@ int ext_cmd_write(const char* cmd, const void* data, size_t size);
 EXT_STATIC_ASSERT(((EXT_HMAP_INIT_CAPACITY) & (EXT_HMAP_INIT_CAPACITY - 1)) == 0,
                   "hashmap initial capacity must be a power of two");
 
+// Number of keys hashed in a single pass by the bulk operations
+#ifndef EXT_HMAP_BATCH_SIZE
+#define EXT_HMAP_BATCH_SIZE 64
+#endif  // EXT_HMAP_BATCH_SIZE
+
+// Define EXT_HMAP_AUTO_SHRINK to make `delete` shrink the table when its load drops below 1/8.
+// The table is then sized for twice its entries, at a load of at most 37.5%: far enough from both
+// the shrink and the grow thresholds that alternating inserts and deletes don't keep resizing it.
+// Note that this makes `delete` invalidate pointers to entries, as `put` does, so entries must not
+// be deleted while iterating the map.
+
 // -----------------------------------------------------------------------------
 // Private hashmap implementation
 
@@ -1023,31 +1708,86 @@ EXT_STATIC_ASSERT(((EXT_HMAP_INIT_CAPACITY) & (EXT_HMAP_INIT_CAPACITY - 1)) == 0
 #define EXT_HMAP_IS_EMPTY(h) ((h) == EXT_HMAP_EMPTY_MARK)
 #define EXT_HMAP_IS_VALID(h) (!EXT_HMAP_IS_EMPTY(h) && !EXT_HMAP_IS_TOMB(h))
 
-void ext_hmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
+void ext_hmap_grow_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz, size_t *cap,
                     Ext_Allocator **a);
+void ext_hmap_reserve_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz,
+                       size_t *cap, size_t n, Ext_Allocator **a);
+void ext_hmap_free_table_(void *entries, size_t entries_sz, size_t hash_sz, size_t cap,
+                          Ext_Allocator *a);
+void ext_hmap_compact_(void *entries, size_t entries_sz, void *hashes, size_t hash_sz, size_t cap);
+void ext_hmap_shrink_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz, size_t *cap,
+                      size_t n, Ext_Allocator **a);
+void ext_hmap_stats_(const void *hashes, size_t hash_sz, size_t cap, size_t size,
+                     size_t tombstones, size_t entries_sz, Ext_HmapStats *out);
+
+#ifdef EXT_HMAP_PROBE_COUNTERS
+#define EXT_HMAP_COUNT_(counter) (ext_hmap_counters.counter++)
+#else
+#define EXT_HMAP_COUNT_(counter) ((void)0)
+#endif  // EXT_HMAP_PROBE_COUNTERS
+
+// Makes room for one more entry, compacting or growing the table if it's full
+#define ext_hmap_make_room_(hmap)                                                   \
+    do {                                                                            \
+        size_t max_load_ = EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1);           \
+        if((hmap)->size + (hmap)->tombstones >= max_load_) {                        \
+            if((hmap)->size < EXT_HMAP_MAX_ENTRY_LOAD(max_load_)) {                 \
+                ext_hmap_compact(hmap);                                             \
+            } else {                                                                \
+                ext_hmap_grow_((void **)&(hmap)->entries, sizeof(*(hmap)->entries), \
+                               (void **)&(hmap)->hashes, sizeof(*(hmap)->hashes),   \
+                               &(hmap)->capacity, &(hmap)->allocator);              \
+                (hmap)->tombstones = 0;                                             \
+            }                                                                       \
+        }                                                                           \
+    } while(0)
 
-#define ext_hmap_find_index_(map, entry, hash, cmp)                             \
-    size_t idx_ = 0;                                                            \
-    {                                                                           \
-        size_t i_ = (hash) & (map)->capacity;                                   \
-        bool tomb_found_ = false;                                               \
-        size_t tomb_idx_ = 0;                                                   \
-        for(;;) {                                                               \
-            size_t buck = (map)->hashes[i_];                                    \
-            if(!EXT_HMAP_IS_VALID(buck)) {                                      \
-                if(EXT_HMAP_IS_EMPTY(buck)) {                                   \
-                    idx_ = tomb_found_ ? tomb_idx_ : i_;                        \
-                    break;                                                      \
-                } else if(!tomb_found_) {                                       \
-                    tomb_found_ = true;                                         \
-                    tomb_idx_ = i_;                                             \
-                }                                                               \
-            } else if(buck == hash && cmp((entry), &(map)->entries[i_]) == 0) { \
-                idx_ = i_;                                                      \
-                break;                                                          \
-            }                                                                   \
-            i_ = (i_ + 1) & (map)->capacity;                                    \
-        }                                                                       \
+#define ext_hmap_fix_hash_(hmap, hash) ext_hmap_fix_hash_width_(hash, sizeof(*(hmap)->hashes))
+
+#ifdef EXT_HMAP_AUTO_SHRINK
+#define ext_hmap_auto_shrink_(hmap)                                                    \
+    do {                                                                               \
+        if((hmap)->capacity + 1 > EXT_HMAP_INIT_CAPACITY &&                            \
+           (hmap)->size < ((hmap)->capacity + 1) / 8) {                                \
+            ext_hmap_shrink_((void **)&(hmap)->entries, sizeof(*(hmap)->entries),      \
+                             (void **)&(hmap)->hashes, sizeof(*(hmap)->hashes),        \
+                             &(hmap)->capacity, (hmap)->size * 2, &(hmap)->allocator); \
+            (hmap)->tombstones = 0;                                                    \
+        }                                                                              \
+    } while(0)
+#else
+#define ext_hmap_auto_shrink_(hmap) ((void)0)
+#endif  // EXT_HMAP_AUTO_SHRINK
+
+#define ext_hmap_find_index_(map, entry, hash, cmp) \
+    ext_hmap_find_index_in_((map)->entries, (map)->hashes, (map)->capacity, entry, hash, cmp)
+
+// Same as `ext_hmap_find_index_`, but works on the raw table arrays
+#define ext_hmap_find_index_in_(entries_, hashes_, cap_, entry, hash, cmp)                  \
+    size_t idx_ = 0;                                                                        \
+    {                                                                                       \
+        size_t i_ = (hash) & (cap_);                                                        \
+        bool tomb_found_ = false;                                                           \
+        size_t tomb_idx_ = 0;                                                               \
+        EXT_HMAP_COUNT_(lookups);                                                           \
+        for(;;) {                                                                           \
+            EXT_HMAP_COUNT_(probes);                                                        \
+            size_t buck = (hashes_)[i_];                                                    \
+            if(!EXT_HMAP_IS_VALID(buck)) {                                                  \
+                if(EXT_HMAP_IS_EMPTY(buck)) {                                               \
+                    idx_ = tomb_found_ ? tomb_idx_ : i_;                                    \
+                    break;                                                                  \
+                } else if(!tomb_found_) {                                                   \
+                    tomb_found_ = true;                                                     \
+                    tomb_idx_ = i_;                                                         \
+                }                                                                           \
+            } else if(buck == hash &&                                                       \
+                      (EXT_HMAP_COUNT_(comparisons), cmp((entry), &(entries_)[i_])) == 0) { \
+                idx_ = i_;                                                                  \
+                break;                                                                      \
+            }                                                                               \
+            i_ = (i_ + 1) & (cap_);                                                         \
+        }                                                                                   \
     }
 
 #define ext_hmap_hash_bytes_(e)      ext_hash_bytes_(&(e)->key, sizeof((e)->key))
@@ -1055,11 +1795,17 @@ void ext_hmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *
 #define ext_hmap_hash_cstr_(e)       ext_hash_cstr_(e)
 #define ext_hmap_hash_ss_entry_(e)   ext_hash_bytes_((e)->key.data, (e)->key.size)
 #define ext_hmap_hash_ss_(e)         ext_hash_bytes_((e).data, (e).size)
+#define ext_hmap_hash_cstr_ptr_(e)   ext_hash_cstr_(*(e))
+#define ext_hmap_hash_ss_ptr_(e)     ext_hash_bytes_((e)->data, (e)->size)
 #define ext_hmap_memcmp_(a, b)       memcmp(&(a)->key, &(b)->key, sizeof((a)->key))
 #define ext_hmap_strcmp_entry_(a, b) strcmp((a)->key, (b)->key)
 #define ext_hmap_strcmp_(a, b)       strcmp((a), (b)->key)
 #define ext_hmap_sscmp_entry_(a, b)  ext_ss_cmp((a)->key, (b)->key)
 #define ext_hmap_sscmp_(a, b)        ext_ss_cmp((a), (b)->key)
+#define ext_hmap_strcmp_ptr_(a, b)   strcmp(*(a), (b)->key)
+#define ext_hmap_sscmp_ptr_(a, b)    ext_ss_cmp(*(a), (b)->key)
+#define ext_hmap_key_entry_(e)       ((e)->key)
+#define ext_hmap_key_(e)             (e)
 
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -1070,28 +1816,196 @@ static inline void *ext_hmap_end_(const void *entries, size_t cap, size_t sz) {
     return entries ? (char *)entries + (cap + 1) * sz : NULL;
 }
 
-static inline void *ext_hmap_begin_(const void *entries, const size_t *hashes, size_t cap,
-                                    size_t sz) {
+// The hashes array holds either `size_t` or `uint32_t` hashes, depending on how the map declares it
+static inline size_t ext_hmap_get_hash_(const void *hashes, size_t hash_sz, size_t i) {
+    if(hash_sz == sizeof(uint32_t)) return ((const uint32_t *)hashes)[i];
+    return ((const size_t *)hashes)[i];
+}
+
+static inline void ext_hmap_set_hash_(void *hashes, size_t hash_sz, size_t i, size_t hash) {
+    if(hash_sz == sizeof(uint32_t)) {
+        ((uint32_t *)hashes)[i] = (uint32_t)hash;
+    } else {
+        ((size_t *)hashes)[i] = hash;
+    }
+}
+
+// Truncates the hash to the width of the hashes stored by the map, and moves it out of the values
+// reserved for empty and deleted slots
+static inline size_t ext_hmap_fix_hash_width_(size_t hash, size_t hash_sz) {
+    EXT_ASSERT(hash_sz == sizeof(size_t) || hash_sz == sizeof(uint32_t),
+               "hashes must be stored as size_t or uint32_t");
+    if(hash_sz < sizeof(size_t)) hash = (uint32_t)hash;
+    return hash < 2 ? hash + 2 : hash;
+}
+
+static inline void *ext_hmap_begin_(const void *entries, const void *hashes, size_t hash_sz,
+                                    size_t cap, size_t sz) {
     if(!entries) return NULL;
     for(size_t i = 0; i <= cap; i++) {
-        if(EXT_HMAP_IS_VALID(hashes[i])) {
+        if(EXT_HMAP_IS_VALID(ext_hmap_get_hash_(hashes, hash_sz, i))) {
             return (char *)entries + i * sz;
         }
     }
     return ext_hmap_end_(entries, cap, sz);
 }
 
-static inline void *ext_hmap_next_(const void *entries, const size_t *hashes, const void *it,
-                                   size_t cap, size_t sz) {
+static inline void *ext_hmap_next_(const void *entries, const void *hashes, size_t hash_sz,
+                                   const void *it, size_t cap, size_t sz) {
     size_t curr = ((char *)it - (char *)entries) / sz;
     for(size_t idx = curr + 1; idx <= cap; idx++) {
-        if(EXT_HMAP_IS_VALID(hashes[idx])) {
+        if(EXT_HMAP_IS_VALID(ext_hmap_get_hash_(hashes, hash_sz, idx))) {
             return (char *)entries + idx * sz;
         }
     }
     return ext_hmap_end_(entries, cap, sz);
 }
 
+// -----------------------------------------------------------------------------
+// Hash functions for variable length keys
+//
+// The hash used for keys that are not 4 or 8 bytes long (strings, string slices, structs) can be
+// selected at compile time:
+//   - default:          stb_ds's reduced-round SipHash variant
+//   - EXT_SIPHASH_2_4:  full SipHash-2-4, for all keys. Use this if keys can be controlled by an
+//                       attacker (hash flooding)
+//   - EXT_HASH_WYHASH:  wyhash, a much faster non-cryptographic 64-bit hash
+//   - EXT_HASH_CRC32C:  hardware CRC32C on x86-64 with SSE4.2 (compile with `-msse4.2`). Falls back
+//                       to wyhash when the instructions are not available
+// With any option other than the default, c-strings are hashed with the same function instead of
+// the byte-at-a-time stb_ds string hash.
+
+#if (defined(EXT_SIPHASH_2_4) + defined(EXT_HASH_WYHASH) + defined(EXT_HASH_CRC32C)) > 1
+#error "only one of EXT_SIPHASH_2_4, EXT_HASH_WYHASH and EXT_HASH_CRC32C can be defined"
+#endif
+
+#if defined(EXT_HASH_CRC32C) && defined(__SSE4_2__) && \
+    (defined(__x86_64__) || defined(_M_X64)) && !defined(EXTLIB_NO_STD)
+#include <nmmintrin.h>
+#define EXT_HASH_HW_CRC32C_
+#endif
+
+static size_t ext_siphash_bytes_(const void *p, size_t len, size_t seed);
+
+// Multiplies `a` and `b`, storing the low 64 bits of the result in `a` and the high ones in `b`
+static inline void ext_wymum_(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t ext_wymix_(uint64_t a, uint64_t b) {
+    ext_wymum_(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t ext_read64_(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t ext_read32_(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// wyhash final version 4, by Wang Yi (public domain)
+static size_t ext_wyhash_bytes_(const void *key, size_t len, size_t seed_) {
+    static const uint64_t secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+                                       0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t seed = seed_;
+    seed ^= ext_wymix_(seed ^ secret[0], secret[1]);
+    uint64_t a, b;
+    if(len <= 16) {
+        if(len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (ext_read32_(p) << 32) | ext_read32_(p + off);
+            b = (ext_read32_(p + len - 4) << 32) | ext_read32_(p + len - 4 - off);
+        } else if(len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if(i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = ext_wymix_(ext_read64_(p) ^ secret[1], ext_read64_(p + 8) ^ seed);
+                see1 = ext_wymix_(ext_read64_(p + 16) ^ secret[2], ext_read64_(p + 24) ^ see1);
+                see2 = ext_wymix_(ext_read64_(p + 32) ^ secret[3], ext_read64_(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16) {
+            seed = ext_wymix_(ext_read64_(p) ^ secret[1], ext_read64_(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = ext_read64_(p + i - 16);
+        b = ext_read64_(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    ext_wymum_(&a, &b);
+    return (size_t)ext_wymix_(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+#ifdef EXT_HASH_HW_CRC32C_
+// Runs two independent CRC32C lanes over the key to get 64 bits of state, then mixes them with the
+// murmur3 finalizer so that all bits of the result depend on the key
+static size_t ext_crc32c_bytes_(const void *key, size_t len, size_t seed) {
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t h1 = (uint32_t)seed, h2 = (uint32_t)~seed;
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        h1 = _mm_crc32_u64(h1, ext_read64_(p + i));
+        h2 = _mm_crc32_u64(h2, ext_read64_(p + i + 8));
+    }
+    if(i + 8 <= len) {
+        h1 = _mm_crc32_u64(h1, ext_read64_(p + i));
+        i += 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    h2 = _mm_crc32_u64(h2, tail);
+    h1 = _mm_crc32_u64(h1, len);
+    uint64_t h = (h1 << 32) | h2;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+#endif  // EXT_HASH_HW_CRC32C_
+
+#if defined(EXT_SIPHASH_2_4)
+#define ext_hash_var_bytes_ ext_siphash_bytes_
+#elif defined(EXT_HASH_HW_CRC32C_)
+#define ext_hash_var_bytes_ ext_crc32c_bytes_
+#elif defined(EXT_HASH_WYHASH) || defined(EXT_HASH_CRC32C)
+#define ext_hash_var_bytes_ ext_wyhash_bytes_
+#else
+#define ext_hash_var_bytes_ ext_siphash_bytes_
+#endif
+
 // -----------------------------------------------------------------------------
 // From stb_ds.h
 //
@@ -1118,6 +2032,9 @@ static inline void *ext_hmap_next_(const void *entries, const size_t *hashes, co
 
 static inline size_t ext_hash_cstr_(const char *str) {
     const size_t seed = 2147483647;
+#if defined(EXT_SIPHASH_2_4) || defined(EXT_HASH_WYHASH) || defined(EXT_HASH_CRC32C)
+    return ext_hash_var_bytes_(str, strlen(str), seed);
+#else
     size_t hash = seed;
     while(*str) hash = EXT_ROTATE_LEFT(hash, 9) + (unsigned char)*str++;
     // Thomas Wang 64-to-32 bit mix function, hopefully also works in 32 bits
@@ -1129,6 +2046,7 @@ static inline size_t ext_hash_cstr_(const char *str) {
     hash += (hash << 6);
     hash ^= EXT_ROTATE_RIGHT(hash, 22);
     return hash + seed;
+#endif
 }
 
 #ifdef EXT_SIPHASH_2_4
@@ -1236,7 +2154,7 @@ static size_t ext_siphash_bytes_(const void *p, size_t len, size_t seed) {
 static inline size_t ext_hash_bytes_(const void *p, size_t len) {
     const size_t seed = 2147483647;
 #ifdef EXT_SIPHASH_2_4
-    return stbds_siphash_bytes(p, len, seed);
+    return ext_siphash_bytes_(p, len, seed);
 #else
     unsigned char *d = (unsigned char *)p;
 
@@ -1270,7 +2188,7 @@ static inline size_t ext_hash_bytes_(const void *p, size_t len) {
         hash = (~hash) + (hash << 18);
         return hash;
     } else {
-        return ext_siphash_bytes_(p, len, seed);
+        return ext_hash_var_bytes_(p, len, seed);
     }
 #endif
 }
@@ -1283,899 +2201,5033 @@ static inline size_t ext_hash_bytes_(const void *p, size_t len) {
 // End of stbds.h
 // -----------------------------------------------------------------------------
 
-#ifdef EXTLIB_IMPL
 // -----------------------------------------------------------------------------
-// SECTION: Logging
+// SECTION: Swiss hashmap
 //
-void ext_log(Ext_LogLevel lvl, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    ext_logvf(lvl, fmt, ap);
-    va_end(ap);
-}
-
-void ext_logvf(Ext_LogLevel lvl, const char *fmt, va_list ap) {
-    if(!ext_context->log_fn || lvl == EXT_NO_LOGGING || lvl < ext_context->log_level) return;
-    ext_context->log_fn(lvl, ext_context->log_data, fmt, ap);
-}
+// An alternative hashmap layout in the style of Google's Swiss tables.
+// Instead of storing the full hash of every entry, it keeps a single control byte per slot (7 bits
+// of the hash, or an empty/deleted mark) and probes `EXT_SWMAP_GROUP` slots at a time. On x86 a
+// whole group is matched with a single SSE2 compare; wasm and no-libc builds use a scalar fallback.
+// It follows the same entry-struct conventions as `hmap`, but requires a `ctrl` array in place of
+// `hashes` and a `tombstones` counter.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     uint8_t *ctrl;
+//     size_t size, tombstones, capacity;
+//     Allocator *allocator;
+// } IntSwissMap;
+//
+// IntSwissMap map = {0};
+// swmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry *e;
+// swmap_get(&map, &((IntEntry){.key = 1}), &e);
+// swmap_foreach(IntEntry, it, &map) {
+//     printf("%d -> %d\n", it->key, it->value);
+// }
+// swmap_free(&map);
+// ```
+//
+// NOTE
+// The control bytes only keep 7 bits of the hash, so rehashing the table calls the `hash` function
+// again on every live entry. Prefer `hmap` when hashing keys is expensive.
 
-#ifndef EXTLIB_NO_STD
-static void ext_default_log(Ext_LogLevel lvl, void *data, const char *fmt, va_list ap) {
-    (void)data;
-    switch(lvl) {
-    case EXT_INFO:
-        fprintf(stdout, "[INFO] ");
-        break;
-    case EXT_WARNING:
-        fprintf(stdout, "[WARNING] ");
-        break;
-    case EXT_ERROR:
-        fprintf(stderr, "[ERROR] ");
-        break;
-    case EXT_NO_LOGGING:
-        EXT_UNREACHABLE();
-    }
-    vfprintf(lvl == EXT_ERROR ? stderr : stdout, fmt, ap);
-}
+#if !defined(EXTLIB_NO_STD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define EXT_SWMAP_SSE2
+#include <emmintrin.h>
 #endif
 
-// -----------------------------------------------------------------------------
-// SECTION: Context
-//
-EXT_TLS Ext_Context *ext_context = &(Ext_Context){
-    .alloc = &ext_default_allocator.base,
-    .log_level = EXT_INFO,
-    .log_data = NULL,
-#ifndef EXTLIB_NO_STD
-    .log_fn = &ext_default_log,
-#else
-    .log_fn = NULL,
-#endif
-};
+// Read as: size * 0.875, i.e. a load factor of 87.5%
+#define EXT_SWMAP_MAX_ENTRY_LOAD(size) ((size) - ((size) >> 3))
 
-void ext_push_context(Ext_Context *ctx) {
-    ctx->prev = ext_context;
-    ext_context = ctx;
-}
-
-Ext_Context *ext_pop_context(void) {
-    EXT_ASSERT(ext_context->prev, "Trying to pop default allocator");
-    Ext_Context *old_ctx = ext_context;
-    ext_context = old_ctx->prev;
-    return old_ctx;
-}
+#define ext_swmap_put_ex(map, entry, hash, cmp)                                           \
+    do {                                                                                  \
+        if(!(map)->ctrl) {                                                                \
+            ext_swmap_rehash_(map, EXT_SWMAP_INIT_CAPACITY, hash);                        \
+        } else if((map)->size + (map)->tombstones >=                                      \
+                  EXT_SWMAP_MAX_ENTRY_LOAD((map)->capacity + 1)) {                        \
+            size_t cap_ = (map)->capacity + 1;                                            \
+            /* Mostly tombstones: rehash into a table of the same capacity */             \
+            size_t newcap_ = (map)->size < EXT_SWMAP_MAX_ENTRY_LOAD(cap_) / 2 ? cap_      \
+                                                                              : cap_ * 2; \
+            ext_swmap_rehash_(map, newcap_, hash);                                        \
+        }                                                                                 \
+        size_t hash_ = hash(entry);                                                       \
+        ext_swmap_find_index_(map, entry, hash_, cmp);                                    \
+        if(!found_) {                                                                     \
+            idx_ = ext_swmap_insert_slot_((map)->ctrl, (map)->capacity, hash_);           \
+            if((map)->ctrl[idx_] == EXT_SWMAP_DELETED) (map)->tombstones--;               \
+            (map)->ctrl[idx_] = EXT_SWMAP_H2(hash_);                                      \
+            (map)->size++;                                                                \
+        }                                                                                 \
+        (map)->entries[idx_] = *(entry);                                                  \
+    } while(0)
 
-// -----------------------------------------------------------------------------
-// SECTION: Allocators
-//
+#define ext_swmap_get_ex(map, entry, out, hash, cmp)    \
+    do {                                                \
+        size_t hash_ = hash(entry);                     \
+        ext_swmap_find_index_(map, entry, hash_, cmp);  \
+        *(out) = found_ ? &(map)->entries[idx_] : NULL; \
+    } while(0)
 
+#define ext_swmap_delete_ex(map, entry, hash, cmp)                                       \
+    do {                                                                                 \
+        size_t hash_ = hash(entry);                                                      \
+        ext_swmap_find_index_(map, entry, hash_, cmp);                                   \
+        if(found_) {                                                                     \
+            /* If the group still has an empty slot no probe sequence ever went past it, \
+               so the slot can be marked empty instead of leaving a tombstone */         \
+            const uint8_t *grp_ = (map)->ctrl + (idx_ & ~(size_t)(EXT_SWMAP_GROUP - 1)); \
+            if(ext_swmap_match_empty_(grp_)) {                                           \
+                (map)->ctrl[idx_] = EXT_SWMAP_EMPTY;                                     \
+            } else {                                                                     \
+                (map)->ctrl[idx_] = EXT_SWMAP_DELETED;                                   \
+                (map)->tombstones++;                                                     \
+            }                                                                            \
+            (map)->size--;                                                               \
+        }                                                                                \
+    } while(0)
 
-void* ext_alloc(size_t size) {
-    return ext_context->alloc->alloc(ext_context->alloc, size);
-}
+#define ext_swmap_put(map, entry) \
+    ext_swmap_put_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_swmap_get(map, entry, out) \
+    ext_swmap_get_ex(map, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_swmap_delete(map, entry) \
+    ext_swmap_delete_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_swmap_put_cstr(map, entry) \
+    ext_swmap_put_ex(map, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_swmap_get_cstr(map, entry, out) \
+    ext_swmap_get_ex(map, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_swmap_delete_cstr(map, entry) \
+    ext_swmap_delete_ex(map, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_swmap_put_ss(map, entry) \
+    ext_swmap_put_ex(map, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_swmap_get_ss(map, entry, out) \
+    ext_swmap_get_ex(map, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_swmap_delete_ss(map, entry) \
+    ext_swmap_delete_ex(map, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+#define ext_swmap_clear(map)                                                       \
+    do {                                                                           \
+        if((map)->ctrl) memset((map)->ctrl, EXT_SWMAP_EMPTY, (map)->capacity + 1); \
+        (map)->size = 0;                                                           \
+        (map)->tombstones = 0;                                                     \
+    } while(0)
 
-void* ext_realloc(void* ptr, size_t old_sz, size_t new_sz) {
-    return ext_context->alloc->realloc(ext_context->alloc, ptr, old_sz, new_sz);
-}
+#define ext_swmap_free(map)                                                               \
+    do {                                                                                  \
+        if((map)->entries) {                                                              \
+            ext_swmap_free_((map)->entries, sizeof(*(map)->entries), (map)->capacity + 1, \
+                            (map)->allocator);                                            \
+        }                                                                                 \
+        memset((map), 0, sizeof(*(map)));                                                 \
+    } while(0)
 
-void ext_free(void* ptr, size_t size) {
-    return ext_context->alloc->free(ext_context->alloc, ptr, size);
-}
+#define ext_swmap_foreach(T, it, map)                                       \
+    for(T *it = ext_swmap_begin(map), *end = ext_swmap_end(map); it != end; \
+        it = ext_swmap_next(map, it))
 
-char *ext_strdup(const char *s) {
-    return ext_strdup_alloc(s, ext_context->alloc);
-}
+#define ext_swmap_end(map) \
+    ext_hmap_end_((map)->entries, (map)->capacity, sizeof(*(map)->entries))
+#define ext_swmap_begin(map) \
+    ext_swmap_begin_((map)->entries, (map)->ctrl, (map)->capacity, sizeof(*(map)->entries))
+#define ext_swmap_next(map, it) \
+    ext_swmap_next_((map)->entries, (map)->ctrl, it, (map)->capacity, sizeof(*(map)->entries))
 
-void *ext_memdup(const void *mem, size_t size) {
-    return ext_memdup_alloc(mem, size, ext_context->alloc);
-}
+// Number of slots matched at once by a probe. Fixed at 16 to match the width of an SSE2 register
+#define EXT_SWMAP_GROUP 16
 
-char *ext_strdup_alloc(const char *s, Ext_Allocator *a) {
-    size_t len = strlen(s);
-    char *res = a->alloc(a, len + 1);
-    memcpy(res, s, len);
-    res[len] = '\0';
-    return res;
-}
+#ifndef EXT_SWMAP_INIT_CAPACITY
+#define EXT_SWMAP_INIT_CAPACITY 16
+#endif  // EXT_SWMAP_INIT_CAPACITY
 
-void *ext_memdup_alloc(const void *mem, size_t size, Ext_Allocator *a) {
-    void *res = a->alloc(a, size);
-    memcpy(res, mem, size);
-    return res;
-}
+EXT_STATIC_ASSERT(((EXT_SWMAP_INIT_CAPACITY) & (EXT_SWMAP_INIT_CAPACITY - 1)) == 0 &&
+                      (EXT_SWMAP_INIT_CAPACITY) >= EXT_SWMAP_GROUP,
+                  "swiss map initial capacity must be a power of two of at least 16");
 
-#ifdef EXTLIB_WASM
-extern char __heap_base[];
-static void *ext_heap_start = (void *)__heap_base;
-#endif  // EXTLIB_WASM
+// -----------------------------------------------------------------------------
+// Private swiss hashmap implementation
+
+#define EXT_SWMAP_EMPTY      ((uint8_t)0x80)
+#define EXT_SWMAP_DELETED    ((uint8_t)0xFE)
+#define EXT_SWMAP_IS_FULL(c) (((c) & 0x80) == 0)
+#define EXT_SWMAP_H1(h)      ((h) >> 7)
+#define EXT_SWMAP_H2(h)      ((uint8_t)((h) & 0x7F))
+
+void ext_swmap_alloc_(void **entries, size_t entries_sz, uint8_t **ctrl, size_t cap,
+                      void **old_entries, uint8_t **old_ctrl, size_t old_cap, Ext_Allocator **a);
+void ext_swmap_replace_(void **entries, size_t entries_sz, uint8_t **ctrl, size_t cap,
+                        void *old_entries, size_t old_cap, Ext_Allocator *a);
+void ext_swmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a);
+size_t ext_swmap_insert_slot_(const uint8_t *ctrl, size_t cap, size_t hash);
+
+// Probes groups in triangular order (g, g + 1, g + 3, g + 6, ...), that visits every group when the
+// number of groups is a power of two. Stops at the first group that has an empty slot.
+#define ext_swmap_find_index_(map, entry, hash, cmp)                           \
+    size_t idx_ = 0;                                                           \
+    bool found_ = false;                                                       \
+    if((map)->ctrl) {                                                          \
+        size_t groups_mask_ = (map)->capacity / EXT_SWMAP_GROUP;               \
+        size_t g_ = EXT_SWMAP_H1(hash) & groups_mask_;                         \
+        uint8_t h2_ = EXT_SWMAP_H2(hash);                                      \
+        for(size_t step_ = 1;; step_++) {                                      \
+            const uint8_t *grp_ = (map)->ctrl + g_ * EXT_SWMAP_GROUP;          \
+            for(uint32_t m_ = ext_swmap_match_(grp_, h2_); m_; m_ &= m_ - 1) { \
+                size_t i_ = g_ * EXT_SWMAP_GROUP + ext_ctz32_(m_);             \
+                if(cmp((entry), &(map)->entries[i_]) == 0) {                   \
+                    idx_ = i_;                                                 \
+                    found_ = true;                                             \
+                    break;                                                     \
+                }                                                              \
+            }                                                                  \
+            if(found_ || ext_swmap_match_empty_(grp_)) break;                  \
+            g_ = (g_ + step_) & groups_mask_;                                  \
+        }                                                                      \
+    }
 
-#ifndef EXT_DEFAULT_ALIGNMENT
-#define EXT_DEFAULT_ALIGNMENT (16)
-#endif  // EXT_DEFAULT_ALIGNMENT
-EXT_STATIC_ASSERT(((EXT_DEFAULT_ALIGNMENT) & ((EXT_DEFAULT_ALIGNMENT)-1)) == 0,
-                  "default alignment must be a power of 2");
+// Rehashes all entries in a new table of `newcap` slots. The control bytes do not retain the full
+// hash, so it has to be recomputed for every entry.
+#define ext_swmap_rehash_(map, newcap, hash)                                               \
+    do {                                                                                   \
+        void *newentries_ = NULL;                                                          \
+        uint8_t *newctrl_ = NULL;                                                          \
+        ext_swmap_alloc_(&newentries_, sizeof(*(map)->entries), &newctrl_, (newcap),       \
+                         (void **)&(map)->entries, &(map)->ctrl, (map)->capacity + 1,      \
+                         &(map)->allocator);                                               \
+        if((map)->ctrl) {                                                                  \
+            for(size_t j_ = 0; j_ <= (map)->capacity; j_++) {                              \
+                if(EXT_SWMAP_IS_FULL((map)->ctrl[j_])) {                                   \
+                    size_t h_ = hash(&(map)->entries[j_]);                                 \
+                    size_t slot_ = ext_swmap_insert_slot_(newctrl_, (newcap) - 1, h_);     \
+                    memcpy((char *)newentries_ + slot_ * sizeof(*(map)->entries),          \
+                           &(map)->entries[j_], sizeof(*(map)->entries));                  \
+                    newctrl_[slot_] = EXT_SWMAP_H2(h_);                                    \
+                }                                                                          \
+            }                                                                              \
+            ext_swmap_replace_(&newentries_, sizeof(*(map)->entries), &newctrl_, (newcap), \
+                               (map)->entries, (map)->capacity + 1, (map)->allocator);     \
+        }                                                                                  \
+        (map)->entries = newentries_;                                                      \
+        (map)->ctrl = newctrl_;                                                            \
+        (map)->capacity = (newcap) - 1;                                                    \
+        (map)->tombstones = 0;                                                             \
+    } while(0)
 
-#ifndef EXT_DEFAULT_TEMP_SIZE
-#define EXT_DEFAULT_TEMP_SIZE (8 * 1024 * 1024)
-#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif  // __GNUC__
 
-static void *ext_default_alloc(Ext_Allocator *a, size_t size) {
-    (void)a;
-#ifndef EXTLIB_NO_STD
-    void *mem = malloc(size);
-    EXT_ASSERT(mem, "out of memory");
-    return mem;
-#elif defined(EXTLIB_WASM)
-    size += EXT_ALIGN(size, EXT_DEFAULT_ALIGNMENT);
-    char* mem_end = (char *)(__builtin_wasm_memory_size(0) << 16);
-    if((char*)ext_heap_start + size > mem_end) {
-        size_t pages = (size + 0xFFFFU) >> 16;  // round up
-        ext_heap_start = (void*)__builtin_wasm_memory_grow(0, pages);
-    }
-    void *mem = ext_heap_start;
-    ext_heap_start = (char *)ext_heap_start + size;
-    return mem;
+static inline unsigned ext_ctz32_(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(x);
 #else
-    (void)size;
-    return NULL;
+    unsigned n = 0;
+    while(!(x & 1)) x >>= 1, n++;
+    return n;
 #endif
 }
 
-static void *ext_default_realloc(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
-#ifndef EXTLIB_NO_STD
-    (void)a;
-    (void)old_size;
-    void *mem = realloc(ptr, new_size);
-    EXT_ASSERT(mem, "out of memory");
-    return mem;
-#elif defined EXTLIB_WASM
-    void *mem = ext_default_alloc(a, new_size);
-    memcpy(mem, ptr, old_size);
-    return mem;
+// Returns a bitmask of the slots in the group whose control byte is equal to `h2`
+static inline uint32_t ext_swmap_match_(const uint8_t *grp, uint8_t h2) {
+#ifdef EXT_SWMAP_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)grp);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
 #else
-    (void)ptr;
-    (void)new_size;
-    return NULL
+    uint32_t mask = 0;
+    for(int i = 0; i < EXT_SWMAP_GROUP; i++) mask |= (uint32_t)(grp[i] == h2) << i;
+    return mask;
 #endif
 }
 
-static void ext_default_free(Ext_Allocator *a, void *ptr, size_t size) {
-    (void)a;
-    (void)size;
-#ifndef EXTLIB_NO_STD
-    free(ptr);
+// Returns a bitmask of the empty slots in the group
+static inline uint32_t ext_swmap_match_empty_(const uint8_t *grp) {
+    return ext_swmap_match_(grp, EXT_SWMAP_EMPTY);
+}
+
+// Returns a bitmask of the empty or deleted slots in the group
+static inline uint32_t ext_swmap_match_free_(const uint8_t *grp) {
+#ifdef EXT_SWMAP_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)grp));
 #else
-    (void)ptr;
+    uint32_t mask = 0;
+    for(int i = 0; i < EXT_SWMAP_GROUP; i++) mask |= (uint32_t)(grp[i] >> 7) << i;
+    return mask;
 #endif
 }
 
-Ext_DefaultAllocator ext_default_allocator = {
-    {
-        .alloc = ext_default_alloc,
-        .realloc = ext_default_realloc,
-        .free = ext_default_free,
-    },
-};
+static inline void *ext_swmap_begin_(const void *entries, const uint8_t *ctrl, size_t cap,
+                                     size_t sz) {
+    if(!entries) return NULL;
+    for(size_t i = 0; i <= cap; i++) {
+        if(EXT_SWMAP_IS_FULL(ctrl[i])) {
+            return (char *)entries + i * sz;
+        }
+    }
+    return ext_hmap_end_(entries, cap, sz);
+}
 
-static void *ext_temp_alloc_wrap(Ext_Allocator *a, size_t size);
-static void *ext_temp_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size);
-static void ext_temp_free_wrap(Ext_Allocator *a, void *ptr, size_t size);
+static inline void *ext_swmap_next_(const void *entries, const uint8_t *ctrl, const void *it,
+                                    size_t cap, size_t sz) {
+    size_t curr = ((char *)it - (char *)entries) / sz;
+    for(size_t idx = curr + 1; idx <= cap; idx++) {
+        if(EXT_SWMAP_IS_FULL(ctrl[idx])) {
+            return (char *)entries + idx * sz;
+        }
+    }
+    return ext_hmap_end_(entries, cap, sz);
+}
 
-static char ext_temp_mem[EXT_DEFAULT_TEMP_SIZE];
-EXT_TLS Ext_TempAllocator ext_temp_allocator = {
-    {.alloc = ext_temp_alloc_wrap, .realloc = ext_temp_realloc_wrap, .free = ext_temp_free_wrap},
-    .start = ext_temp_mem,
-    .end = ext_temp_mem + EXT_DEFAULT_TEMP_SIZE,
-    .mem_size = EXT_DEFAULT_TEMP_SIZE,
-    .mem = ext_temp_mem,
-};
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif  // __GNUC__
 
-static void *ext_temp_alloc_wrap(Ext_Allocator *a, size_t size) {
-    (void)a;
-    return ext_temp_alloc(size);
-}
+// -----------------------------------------------------------------------------
+// SECTION: Robin Hood hashmap
+//
+// A variant of `hmap` that uses Robin Hood insertion and backward-shift deletion.
+// On insertion, an entry that is further away from its home slot than the one occupying the slot
+// takes its place, keeping the variance of probe lengths low. This lets lookups stop as soon as
+// they meet an entry closer to its home than the key being searched.
+// On deletion the following entries of the cluster are shifted back by one slot, so the table
+// never contains tombstones and probe chains don't degrade under insert/delete churn.
+//
+// The map uses exactly the same struct layout as `hmap`, so `clear`, `free` and iteration are
+// shared with it. Don't mix `rhmap` and `hmap` put/delete operations on the same map, as they
+// maintain different invariants.
+//
+// USAGE
+// ```c
+// IntMap map = {0};
+// rhmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry *e;
+// rhmap_get(&map, &((IntEntry){.key = 1}), &e);
+// rhmap_delete(&map, &((IntEntry){.key = 1}));
+// rhmap_free(&map);
+// ```
 
-static void *ext_temp_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
-    (void)a;
-    return ext_temp_realloc(ptr, old_size, new_size);
-}
+#define ext_rhmap_put_ex(hmap, entry, hash, cmp)                                                  \
+    do {                                                                                          \
+        if((hmap)->size >= EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) {                       \
+            ext_rhmap_grow_((void **)&(hmap)->entries, sizeof(*(hmap)->entries), &(hmap)->hashes, \
+                            &(hmap)->capacity, &(hmap)->allocator);                               \
+        }                                                                                         \
+        size_t hash_ = hash(entry);                                                               \
+        if(hash_ < 2) hash_ += 2;                                                                 \
+        ext_rhmap_find_index_(hmap, entry, hash_, cmp);                                           \
+        if(!found_) {                                                                             \
+            ext_rhmap_make_room_((hmap)->entries, sizeof(*(hmap)->entries), (hmap)->hashes,       \
+                                 (hmap)->capacity, idx_);                                         \
+            (hmap)->hashes[idx_] = hash_;                                                         \
+            (hmap)->size++;                                                                       \
+        }                                                                                         \
+        (hmap)->entries[idx_] = *(entry);                                                         \
+    } while(0)
 
-static void ext_temp_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
-    (void)a;
-    (void)ptr;
-    (void)size;
-    // No-op, temp allocator does not free memory
-}
+#define ext_rhmap_get_ex(hmap, entry, out, hash, cmp)    \
+    do {                                                 \
+        size_t hash_ = hash(entry);                      \
+        if(hash_ < 2) hash_ += 2;                        \
+        ext_rhmap_find_index_(hmap, entry, hash_, cmp);  \
+        *(out) = found_ ? &(hmap)->entries[idx_] : NULL; \
+    } while(0)
 
-void ext_temp_set_mem(void *mem, size_t size) {
-    ext_temp_allocator.mem_size = size;
-    ext_temp_allocator.mem = mem;
-    ext_temp_reset();
-}
+#define ext_rhmap_delete_ex(hmap, entry, hash, cmp)                                      \
+    do {                                                                                 \
+        size_t hash_ = hash(entry);                                                      \
+        if(hash_ < 2) hash_ += 2;                                                        \
+        ext_rhmap_find_index_(hmap, entry, hash_, cmp);                                  \
+        if(found_) {                                                                     \
+            ext_rhmap_remove_((hmap)->entries, sizeof(*(hmap)->entries), (hmap)->hashes, \
+                              (hmap)->capacity, idx_);                                   \
+            (hmap)->size--;                                                              \
+        }                                                                                \
+    } while(0)
 
-void *ext_temp_alloc(size_t size) {
-    size_t alignment = EXT_ALIGN(size, EXT_DEFAULT_ALIGNMENT);
-    intptr_t available = ext_temp_allocator.end - ext_temp_allocator.start - alignment;
-    if(available < (intptr_t)size) {
-#ifndef EXTLIB_NO_STD
-        ext_log(EXT_ERROR,
-                "%s:%d: temp allocation failed: %zu bytes requested, %zd bytes "
-                "available\n",
-                __FILE__, __LINE__, size, available < 0 ? 0 : available);
-        abort();
-#else
-        EXT_ASSERT(false, "temp allocation failed");
-#endif
-    }
-    void *p = ext_temp_allocator.start;
-    ext_temp_allocator.start += size + alignment;
-    return p;
-}
+#define ext_rhmap_put(hmap, entry) \
+    ext_rhmap_put_ex(hmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_rhmap_get(hmap, entry, out) \
+    ext_rhmap_get_ex(hmap, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_rhmap_delete(hmap, entry) \
+    ext_rhmap_delete_ex(hmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_rhmap_put_cstr(hmap, entry) \
+    ext_rhmap_put_ex(hmap, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_rhmap_get_cstr(hmap, entry, out) \
+    ext_rhmap_get_ex(hmap, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_rhmap_delete_cstr(hmap, entry) \
+    ext_rhmap_delete_ex(hmap, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_rhmap_put_ss(hmap, entry) \
+    ext_rhmap_put_ex(hmap, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_rhmap_get_ss(hmap, entry, out) \
+    ext_rhmap_get_ex(hmap, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_rhmap_delete_ss(hmap, entry) \
+    ext_rhmap_delete_ex(hmap, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+#define ext_rhmap_clear   ext_hmap_clear
+#define ext_rhmap_free    ext_hmap_free
+#define ext_rhmap_foreach ext_hmap_foreach
+#define ext_rhmap_end     ext_hmap_end
+#define ext_rhmap_begin   ext_hmap_begin
+#define ext_rhmap_next    ext_hmap_next
 
-void *ext_temp_realloc(void *ptr, size_t old_size, size_t new_size) {
-    ptrdiff_t alignment = EXT_ALIGN(old_size, EXT_DEFAULT_ALIGNMENT);
-    // Reallocating last allocated memory, can grow/shrink in-place
-    if(ext_temp_allocator.start - old_size - alignment == ptr) {
-        ext_temp_allocator.start -= old_size + alignment;
-        return ext_temp_alloc(new_size);
-    } else if(new_size > old_size) {
-        void *new_ptr = ext_temp_alloc(new_size);
-        memcpy(new_ptr, ptr, old_size);
-        return new_ptr;
-    } else {
-        return ptr;
+// -----------------------------------------------------------------------------
+// Private Robin Hood hashmap implementation
+
+// Distance of the entry with hash `h` stored at slot `i` from its home slot
+#define EXT_RHMAP_PROBE_DIST(h, i, cap) (((i) - ((h) & (cap))) & (cap))
+
+void ext_rhmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
+                     Ext_Allocator **a);
+void ext_rhmap_make_room_(void *entries, size_t entries_sz, size_t *hashes, size_t cap,
+                          size_t idx);
+void ext_rhmap_remove_(void *entries, size_t entries_sz, size_t *hashes, size_t cap, size_t idx);
+
+// Stops on the entry, or on the slot where the entry should be inserted: the first empty slot, or
+// the first slot whose entry is closer to its home than the searched key would be.
+#define ext_rhmap_find_index_(map, entry, hash, cmp)                        \
+    size_t idx_ = 0;                                                        \
+    bool found_ = false;                                                    \
+    if((map)->hashes) {                                                     \
+        size_t i_ = (hash) & (map)->capacity;                               \
+        for(size_t dist_ = 0;; dist_++) {                                   \
+            size_t buck_ = (map)->hashes[i_];                               \
+            if(EXT_HMAP_IS_EMPTY(buck_) ||                                  \
+               dist_ > EXT_RHMAP_PROBE_DIST(buck_, i_, (map)->capacity)) {  \
+                break;                                                      \
+            }                                                               \
+            if(buck_ == (hash) && cmp((entry), &(map)->entries[i_]) == 0) { \
+                found_ = true;                                              \
+                break;                                                      \
+            }                                                               \
+            i_ = (i_ + 1) & (map)->capacity;                                \
+        }                                                                   \
+        idx_ = i_;                                                          \
     }
-}
 
-size_t ext_temp_available(void) {
-    return ext_temp_allocator.end - ext_temp_allocator.start;
-}
+// -----------------------------------------------------------------------------
+// SECTION: Incremental hashmap
+//
+// A variant of the hashmap that spreads the cost of rehashing across operations.
+// When the load factor is exceeded, `hmap` rehashes the whole table inside a single `put`. This
+// map instead keeps the old table alive next to the new one, and every subsequent `put`, `get` and
+// `delete` migrates at most `EXT_IHMAP_REHASH_STEP` slots of it. This bounds the worst-case latency
+// of a single operation, at the cost of looking into both tables while a rehash is in progress.
+// Since both tables are alive at the same time, allocators with `EXT_ALLOCATOR_LIFO` cannot reclaim
+// the old one, that is left behind as dead memory in arenas.
+//
+// The struct is the same as `hmap`, plus the fields tracking the old table. `tombstones` only
+// counts the deleted slots of the current table:
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     size_t *hashes;
+//     size_t size, tombstones, capacity;
+//     Allocator *allocator;
+//     // Rehashing state
+//     IntEntry *old_entries;
+//     size_t *old_hashes;
+//     size_t old_capacity, migrated;
+// } IntIncMap;
+//
+// IntIncMap map = {0};
+// ihmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry *e;
+// ihmap_get(&map, &((IntEntry){.key = 1}), &e);
+// ihmap_free(&map);
+// ```
+//
+// NOTE
+// Since `get` and `delete` can also move entries between the tables, a pointer to an entry is only
+// valid until the next operation on the map.
 
-void ext_temp_reset(void) {
-    ext_temp_allocator.start = ext_temp_allocator.mem;
-    ext_temp_allocator.end = (char *)ext_temp_allocator.mem + ext_temp_allocator.mem_size;
-}
+// Number of slots of the old table migrated by each operation while a rehash is in progress
+#ifndef EXT_IHMAP_REHASH_STEP
+#define EXT_IHMAP_REHASH_STEP 32
+#endif  // EXT_IHMAP_REHASH_STEP
 
-void *ext_temp_checkpoint(void) {
-    return ext_temp_allocator.start;
-}
+EXT_STATIC_ASSERT((EXT_IHMAP_REHASH_STEP) > 0, "rehash step must be greater than 0");
 
-void ext_temp_rewind(void *checkpoint) {
-    ext_temp_allocator.start = checkpoint;
-}
+#define ext_ihmap_put_ex(hmap, entry, hash, cmp)                                                   \
+    do {                                                                                           \
+        ext_ihmap_step_(hmap, EXT_IHMAP_REHASH_STEP);                                              \
+        if((hmap)->size + (hmap)->tombstones >= EXT_HMAP_MAX_ENTRY_LOAD((hmap)->capacity + 1)) {   \
+            /* Only one rehash at a time: finish the previous one before starting a new one */     \
+            ext_ihmap_step_(hmap, SIZE_MAX);                                                       \
+            ext_ihmap_start_rehash_((void **)&(hmap)->entries, sizeof(*(hmap)->entries),           \
+                                    &(hmap)->hashes, &(hmap)->capacity, (hmap)->size,              \
+                                    &(hmap)->tombstones, (void **)&(hmap)->old_entries,            \
+                                    &(hmap)->old_hashes, &(hmap)->old_capacity, &(hmap)->migrated, \
+                                    &(hmap)->allocator);                                           \
+        }                                                                                          \
+        size_t hash_ = hash(entry);                                                                \
+        if(hash_ < 2) hash_ += 2;                                                                  \
+        if((hmap)->old_entries) {                                                                  \
+            /* A key must live in only one of the tables */                                        \
+            ext_hmap_find_index_in_((hmap)->old_entries, (hmap)->old_hashes,                       \
+                                    (hmap)->old_capacity, entry, hash_, cmp);                      \
+            if(EXT_HMAP_IS_VALID((hmap)->old_hashes[idx_])) {                                      \
+                (hmap)->old_hashes[idx_] = EXT_HMAP_TOMB_MARK;                                     \
+                (hmap)->size--;                                                                    \
+            }                                                                                      \
+        }                                                                                          \
+        ext_hmap_find_index_(hmap, entry, hash_, cmp);                                             \
+        if(!EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                                             \
+            if(EXT_HMAP_IS_TOMB((hmap)->hashes[idx_])) (hmap)->tombstones--;                       \
+            (hmap)->size++;                                                                        \
+        }                                                                                          \
+        (hmap)->hashes[idx_] = hash_;                                                              \
+        (hmap)->entries[idx_] = *(entry);                                                          \
+    } while(0)
 
-char *ext_temp_strdup(const char *s) {
-    return ext_strdup_alloc(s, &ext_temp_allocator.base);
-}
+#define ext_ihmap_get_ex(hmap, entry, out, hash, cmp)                             \
+    do {                                                                          \
+        ext_ihmap_step_(hmap, EXT_IHMAP_REHASH_STEP);                             \
+        *(out) = NULL;                                                            \
+        if((hmap)->entries) {                                                     \
+            size_t hash_ = hash(entry);                                           \
+            if(hash_ < 2) hash_ += 2;                                             \
+            ext_hmap_find_index_(hmap, entry, hash_, cmp);                        \
+            if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                         \
+                *(out) = &(hmap)->entries[idx_];                                  \
+            } else if((hmap)->old_entries) {                                      \
+                ext_hmap_find_index_in_((hmap)->old_entries, (hmap)->old_hashes,  \
+                                        (hmap)->old_capacity, entry, hash_, cmp); \
+                if(EXT_HMAP_IS_VALID((hmap)->old_hashes[idx_])) {                 \
+                    *(out) = &(hmap)->old_entries[idx_];                          \
+                }                                                                 \
+            }                                                                     \
+        }                                                                         \
+    } while(0)
 
-void *ext_temp_memdup(void *mem, size_t size) {
-    return ext_memdup_alloc(mem, size, &ext_temp_allocator.base);
-}
+#define ext_ihmap_delete_ex(hmap, entry, hash, cmp)                               \
+    do {                                                                          \
+        ext_ihmap_step_(hmap, EXT_IHMAP_REHASH_STEP);                             \
+        if((hmap)->entries) {                                                     \
+            size_t hash_ = hash(entry);                                           \
+            if(hash_ < 2) hash_ += 2;                                             \
+            ext_hmap_find_index_(hmap, entry, hash_, cmp);                        \
+            if(EXT_HMAP_IS_VALID((hmap)->hashes[idx_])) {                         \
+                (hmap)->hashes[idx_] = EXT_HMAP_TOMB_MARK;                        \
+                (hmap)->size--;                                                   \
+                (hmap)->tombstones++;                                             \
+            } else if((hmap)->old_entries) {                                      \
+                ext_hmap_find_index_in_((hmap)->old_entries, (hmap)->old_hashes,  \
+                                        (hmap)->old_capacity, entry, hash_, cmp); \
+                if(EXT_HMAP_IS_VALID((hmap)->old_hashes[idx_])) {                 \
+                    (hmap)->old_hashes[idx_] = EXT_HMAP_TOMB_MARK;                \
+                    (hmap)->size--;                                               \
+                }                                                                 \
+            }                                                                     \
+        }                                                                         \
+    } while(0)
 
-#ifndef EXTLIB_NO_STD
-char *ext_temp_sprintf(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    char *res = ext_temp_vsprintf(fmt, ap);
-    va_end(ap);
-    return res;
-}
+#define ext_ihmap_put(hmap, entry) \
+    ext_ihmap_put_ex(hmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ihmap_get(hmap, entry, out) \
+    ext_ihmap_get_ex(hmap, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ihmap_delete(hmap, entry) \
+    ext_ihmap_delete_ex(hmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_ihmap_put_cstr(hmap, entry) \
+    ext_ihmap_put_ex(hmap, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_ihmap_get_cstr(hmap, entry, out) \
+    ext_ihmap_get_ex(hmap, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_ihmap_delete_cstr(hmap, entry) \
+    ext_ihmap_delete_ex(hmap, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_ihmap_put_ss(hmap, entry) \
+    ext_ihmap_put_ex(hmap, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_ihmap_get_ss(hmap, entry, out) \
+    ext_ihmap_get_ex(hmap, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_ihmap_delete_ss(hmap, entry) \
+    ext_ihmap_delete_ex(hmap, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+#define ext_ihmap_clear(hmap)                                                            \
+    do {                                                                                 \
+        ext_ihmap_free_old_(hmap);                                                       \
+        if((hmap)->hashes) {                                                             \
+            memset((hmap)->hashes, 0, sizeof(*(hmap)->hashes) * ((hmap)->capacity + 1)); \
+        }                                                                                \
+        (hmap)->size = 0;                                                                \
+        (hmap)->tombstones = 0;                                                          \
+    } while(0)
 
-char *ext_temp_vsprintf(const char *fmt, va_list ap) {
-    va_list cpy;
+#define ext_ihmap_free(hmap)                                                                    \
+    do {                                                                                        \
+        ext_ihmap_free_old_(hmap);                                                              \
+        if((hmap)->entries) {                                                                   \
+            ext_hmap_free_table_((hmap)->entries, sizeof(*(hmap)->entries),                     \
+                                 sizeof(*(hmap)->hashes), (hmap)->capacity, (hmap)->allocator); \
+        }                                                                                       \
+        memset((hmap), 0, sizeof(*(hmap)));                                                     \
+    } while(0)
+
+// Visits the entries still in the old table first, then the ones in the new table
+#define ext_ihmap_foreach(T, it, hmap)                                        \
+    for(T *it = ext_ihmap_begin(hmap), *end = ext_ihmap_end(hmap); it != end; \
+        it = ext_ihmap_next(hmap, it))
+
+#define ext_ihmap_end(hmap) ext_hmap_end(hmap)
+#define ext_ihmap_begin(hmap) ext_ihmap_next(hmap, NULL)
+#define ext_ihmap_next(hmap, it)                                                   \
+    ext_ihmap_next_((hmap)->old_entries, (hmap)->old_hashes, (hmap)->old_capacity, \
+                    (hmap)->entries, (hmap)->hashes, (hmap)->capacity,             \
+                    sizeof(*(hmap)->entries), it)
+
+// -----------------------------------------------------------------------------
+// Private incremental hashmap implementation
+
+void ext_ihmap_start_rehash_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
+                             size_t size, size_t *tombstones, void **old_entries,
+                             size_t **old_hashes, size_t *old_cap, size_t *migrated,
+                             Ext_Allocator **a);
+void ext_ihmap_migrate_(void **old_entries, size_t **old_hashes, size_t *old_cap, size_t *migrated,
+                        void *entries, size_t *hashes, size_t cap, size_t *tombstones,
+                        size_t entries_sz, size_t steps, Ext_Allocator *a);
+void *ext_ihmap_next_(const void *old_entries, const size_t *old_hashes, size_t old_cap,
+                      const void *entries, const size_t *hashes, size_t cap, size_t sz,
+                      const void *it);
+
+#define ext_ihmap_step_(hmap, steps)                                                      \
+    do {                                                                                  \
+        if((hmap)->old_entries) {                                                         \
+            ext_ihmap_migrate_((void **)&(hmap)->old_entries, &(hmap)->old_hashes,        \
+                               &(hmap)->old_capacity, &(hmap)->migrated, (hmap)->entries, \
+                               (hmap)->hashes, (hmap)->capacity, &(hmap)->tombstones,     \
+                               sizeof(*(hmap)->entries), steps, (hmap)->allocator);       \
+        }                                                                                 \
+    } while(0)
+
+#define ext_ihmap_free_old_(hmap)                                               \
+    do {                                                                        \
+        if((hmap)->old_entries) {                                               \
+            ext_hmap_free_table_((hmap)->old_entries, sizeof(*(hmap)->entries), \
+                                 sizeof(*(hmap)->hashes), (hmap)->old_capacity, \
+                                 (hmap)->allocator);                            \
+            (hmap)->old_entries = NULL;                                         \
+            (hmap)->old_hashes = NULL;                                          \
+            (hmap)->old_capacity = 0;                                           \
+            (hmap)->migrated = 0;                                               \
+        }                                                                       \
+    } while(0)
+
+// -----------------------------------------------------------------------------
+// SECTION: Sharded hashmap
+//
+// A hashmap that can be shared between threads.
+// The map is split into a power-of-two number of shards, each one a regular `hmap` protected by its
+// own mutex. The shard of a key is chosen by the high bits of its hash, leaving the low bits to the
+// probing inside the shard, so concurrent operations only contend when they hit the same shard.
+// The map is only thread safe when the library is compiled with EXTLIB_THREADSAFE.
+//
+// The struct of the shard holds the `hmap` and its mutex, and must be declared alongside the map:
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntMap map;
+//     Mutex lock;
+// } IntShard;
+//
+// typedef struct {
+//     IntShard *shards;
+//     size_t shard_count;
+//     Allocator *allocator;
+// } IntShardedMap;
+//
+// IntShardedMap map = {0};
+// shmap_init(&map, 16);
+// shmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry e;
+// bool found;
+// shmap_get(&map, &((IntEntry){.key = 1}), &e, &found);
+// shmap_free(&map);
+// ```
+//
+// NOTE
+// Since the entry could be modified or moved by another thread as soon as its shard is unlocked,
+// `get` copies it out instead of returning a pointer into the table.
+// The allocator of the map, which is also used by all shards, must be thread safe as well.
+
+// Maximum number of shards of a sharded map. The shard is picked from the 16 high bits of the hash
+#define EXT_SHMAP_MAX_SHARDS (1 << 16)
+
+// Initializes the map with `n` shards. `n` must be a power of two
+#define ext_shmap_init(shmap, n)                                                          \
+    do {                                                                                  \
+        size_t n_ = (n);                                                                  \
+        EXT_ASSERT(n_ > 0 && (n_ & (n_ - 1)) == 0, "shard count must be a power of two"); \
+        EXT_ASSERT(n_ <= EXT_SHMAP_MAX_SHARDS, "too many shards");                        \
+        if(!(shmap)->allocator) (shmap)->allocator = ext_context->alloc;                  \
+        (shmap)->shards = (shmap)->allocator->alloc((shmap)->allocator,                   \
+                                                    n_ * sizeof(*(shmap)->shards));       \
+        memset((shmap)->shards, 0, n_ * sizeof(*(shmap)->shards));                        \
+        (shmap)->shard_count = n_;                                                        \
+        for(size_t i_ = 0; i_ < n_; i_++) {                                               \
+            (shmap)->shards[i_].map.allocator = (shmap)->allocator;                       \
+            ext_mutex_init(&(shmap)->shards[i_].lock);                                    \
+        }                                                                                 \
+    } while(0)
+
+#define ext_shmap_put_ex(shmap, entry, hash, cmp)                                          \
+    do {                                                                                   \
+        size_t shmap_hash_ = hash(entry);                                                  \
+        ext_shmap_lock_shard_(shmap, shmap_hash_);                                         \
+        ext_hmap_put_ex(&(shmap)->shards[shard_i_].map, entry, ext_shmap_prehashed_, cmp); \
+        ext_mutex_unlock(&(shmap)->shards[shard_i_].lock);                                 \
+    } while(0)
+
+// Copies the entry matching `entry` in `out`, and sets `found` accordingly
+#define ext_shmap_get_ex(shmap, entry, out, found, hash, cmp)                               \
+    do {                                                                                    \
+        size_t shmap_hash_ = hash(entry);                                                   \
+        ext_shmap_lock_shard_(shmap, shmap_hash_);                                          \
+        *(found) = false;                                                                   \
+        if((shmap)->shards[shard_i_].map.entries) {                                         \
+            size_t hash_ = ext_hmap_fix_hash_(&(shmap)->shards[shard_i_].map, shmap_hash_); \
+            ext_hmap_find_index_(&(shmap)->shards[shard_i_].map, entry, hash_, cmp);        \
+            if(EXT_HMAP_IS_VALID((shmap)->shards[shard_i_].map.hashes[idx_])) {             \
+                *(out) = (shmap)->shards[shard_i_].map.entries[idx_];                       \
+                *(found) = true;                                                            \
+            }                                                                               \
+        }                                                                                   \
+        ext_mutex_unlock(&(shmap)->shards[shard_i_].lock);                                  \
+    } while(0)
+
+#define ext_shmap_delete_ex(shmap, entry, hash, cmp)                                              \
+    do {                                                                                          \
+        size_t shmap_hash_ = hash(entry);                                                         \
+        ext_shmap_lock_shard_(shmap, shmap_hash_);                                                \
+        if((shmap)->shards[shard_i_].map.entries) {                                               \
+            ext_hmap_delete_ex(&(shmap)->shards[shard_i_].map, entry, ext_shmap_prehashed_, cmp); \
+        }                                                                                         \
+        ext_mutex_unlock(&(shmap)->shards[shard_i_].lock);                                        \
+    } while(0)
+
+#define ext_shmap_put(shmap, entry) \
+    ext_shmap_put_ex(shmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_shmap_get(shmap, entry, out, found) \
+    ext_shmap_get_ex(shmap, entry, out, found, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_shmap_delete(shmap, entry) \
+    ext_shmap_delete_ex(shmap, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_shmap_put_cstr(shmap, entry) \
+    ext_shmap_put_ex(shmap, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_shmap_get_cstr(shmap, entry, out, found) \
+    ext_shmap_get_ex(shmap, entry, out, found, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_shmap_delete_cstr(shmap, entry) \
+    ext_shmap_delete_ex(shmap, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_shmap_put_ss(shmap, entry) \
+    ext_shmap_put_ex(shmap, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_shmap_get_ss(shmap, entry, out, found) \
+    ext_shmap_get_ex(shmap, entry, out, found, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_shmap_delete_ss(shmap, entry) \
+    ext_shmap_delete_ex(shmap, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+// Stores the total number of entries of the map in `out`.
+// Shards are locked one at a time, so the result is only exact if no other thread is modifying
+// the map.
+#define ext_shmap_size(shmap, out)                            \
+    do {                                                      \
+        *(out) = 0;                                           \
+        for(size_t i_ = 0; i_ < (shmap)->shard_count; i_++) { \
+            ext_mutex_lock(&(shmap)->shards[i_].lock);        \
+            *(out) += (shmap)->shards[i_].map.size;           \
+            ext_mutex_unlock(&(shmap)->shards[i_].lock);      \
+        }                                                     \
+    } while(0)
+
+#define ext_shmap_clear(shmap)                                \
+    do {                                                      \
+        for(size_t i_ = 0; i_ < (shmap)->shard_count; i_++) { \
+            ext_mutex_lock(&(shmap)->shards[i_].lock);        \
+            if((shmap)->shards[i_].map.entries) {             \
+                ext_hmap_clear(&(shmap)->shards[i_].map);     \
+            }                                                 \
+            ext_mutex_unlock(&(shmap)->shards[i_].lock);      \
+        }                                                     \
+    } while(0)
+
+// Frees the map. Must not be called while other threads are still using it
+#define ext_shmap_free(shmap)                                                          \
+    do {                                                                               \
+        for(size_t i_ = 0; i_ < (shmap)->shard_count; i_++) {                          \
+            ext_hmap_free(&(shmap)->shards[i_].map);                                   \
+            ext_mutex_destroy(&(shmap)->shards[i_].lock);                              \
+        }                                                                              \
+        if((shmap)->shards) {                                                          \
+            (shmap)->allocator->free((shmap)->allocator, (shmap)->shards,              \
+                                     (shmap)->shard_count * sizeof(*(shmap)->shards)); \
+        }                                                                              \
+        memset((shmap), 0, sizeof(*(shmap)));                                          \
+    } while(0)
+
+// Iterates all entries of the map, locking one shard at a time.
+// `break` only skips the rest of the current shard, and returning or jumping out of the loop
+// leaves the shard locked.
+#define ext_shmap_foreach(T, it, shmap)                                                  \
+    for(size_t shard_i_ = 0; shard_i_ < (shmap)->shard_count; shard_i_++)                \
+        for(int locked_ = (ext_mutex_lock(&(shmap)->shards[shard_i_].lock), 1); locked_; \
+            locked_ = (ext_mutex_unlock(&(shmap)->shards[shard_i_].lock), 0))            \
+            ext_hmap_foreach(T, it, &(shmap)->shards[shard_i_].map)
+
+// -----------------------------------------------------------------------------
+// Private sharded hashmap implementation
+
+// Hash function that returns the hash already computed by the sharded map
+#define ext_shmap_prehashed_(e) shmap_hash_
+
+// Shard of `hash` in a map of `shard_count` shards
+#define ext_shmap_shard_index_(hash, shard_count) \
+    (((hash) >> (sizeof(size_t) * 8 - 16)) & ((shard_count) - 1))
+
+#define ext_shmap_lock_shard_(shmap, hash)                                \
+    EXT_ASSERT((shmap)->shards, "sharded map is not initialized");        \
+    size_t shard_i_ = ext_shmap_shard_index_(hash, (shmap)->shard_count); \
+    ext_mutex_lock(&(shmap)->shards[shard_i_].lock)
+
+// -----------------------------------------------------------------------------
+// SECTION: Dense hashmap
+//
+// A hashmap that keeps its entries packed in a contiguous array, in insertion order.
+// Lookups go through a separate index table of 8, 16, 32 or 64 bit slots (the smallest width able
+// to address all entries), that map a hash to the position of the entry in the dense array. Since
+// the index is much smaller than the `size_t` hash array of `hmap`, more of it stays in cache, and
+// iteration is a linear scan over the dense array instead of over all the slots of the table.
+//
+// Deleting an entry leaves a hole in the dense array, that is skipped during iteration and
+// compacted away the next time the table is rebuilt. Re-inserting a deleted key moves it to the end
+// of the iteration order.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     size_t *hashes;
+//     void *index;
+//     size_t size, used, capacity;
+//     Allocator *allocator;
+// } IntDenseMap;
+//
+// IntDenseMap map = {0};
+// dmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// dmap_put(&map, &((IntEntry){.key = 2, .value = 20}));
+// IntEntry *e;
+// dmap_get(&map, &((IntEntry){.key = 1}), &e);
+// dmap_foreach(IntEntry, it, &map) {
+//     // Visits key 1, then key 2
+// }
+// dmap_free(&map);
+// ```
+//
+// NOTE
+// `size` is the number of entries in the map, while `used` is the number of slots of the dense
+// array taken by entries or holes. As with `hmap`, pointers to entries are invalidated by `put`.
+
+#define ext_dmap_put_ex(map, entry, hash, cmp)                                                   \
+    do {                                                                                         \
+        if((map)->used >= EXT_HMAP_MAX_ENTRY_LOAD((map)->capacity + 1)) {                        \
+            ext_dmap_rebuild_((void **)&(map)->entries, sizeof(*(map)->entries), &(map)->hashes, \
+                              &(map)->index, &(map)->capacity, &(map)->used, (map)->size,        \
+                              &(map)->allocator);                                                \
+        }                                                                                        \
+        size_t hash_ = hash(entry);                                                              \
+        if(hash_ < 2) hash_ += 2;                                                                \
+        ext_dmap_find_index_(map, entry, hash_, cmp);                                            \
+        if(entry_idx_ != EXT_DMAP_NOT_FOUND) {                                                   \
+            (map)->entries[entry_idx_] = *(entry);                                               \
+        } else {                                                                                 \
+            ext_dmap_index_set_((map)->index, (map)->capacity, idx_, (map)->used + 2);           \
+            (map)->entries[(map)->used] = *(entry);                                              \
+            (map)->hashes[(map)->used] = hash_;                                                  \
+            (map)->used++;                                                                       \
+            (map)->size++;                                                                       \
+        }                                                                                        \
+    } while(0)
+
+#define ext_dmap_get_ex(map, entry, out, hash, cmp)       \
+    do {                                                  \
+        *(out) = NULL;                                    \
+        if((map)->index) {                                \
+            size_t hash_ = hash(entry);                   \
+            if(hash_ < 2) hash_ += 2;                     \
+            ext_dmap_find_index_(map, entry, hash_, cmp); \
+            (void)idx_;                                   \
+            if(entry_idx_ != EXT_DMAP_NOT_FOUND) {        \
+                *(out) = &(map)->entries[entry_idx_];     \
+            }                                             \
+        }                                                 \
+    } while(0)
+
+#define ext_dmap_delete_ex(map, entry, hash, cmp)                                           \
+    do {                                                                                    \
+        if((map)->index) {                                                                  \
+            size_t hash_ = hash(entry);                                                     \
+            if(hash_ < 2) hash_ += 2;                                                       \
+            ext_dmap_find_index_(map, entry, hash_, cmp);                                   \
+            if(entry_idx_ != EXT_DMAP_NOT_FOUND) {                                          \
+                ext_dmap_index_set_((map)->index, (map)->capacity, idx_, EXT_DMAP_DELETED); \
+                (map)->hashes[entry_idx_] = EXT_HMAP_TOMB_MARK;                             \
+                (map)->size--;                                                              \
+            }                                                                               \
+        }                                                                                   \
+    } while(0)
+
+#define ext_dmap_put(map, entry) \
+    ext_dmap_put_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_dmap_get(map, entry, out) \
+    ext_dmap_get_ex(map, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_dmap_delete(map, entry) \
+    ext_dmap_delete_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_dmap_put_cstr(map, entry) \
+    ext_dmap_put_ex(map, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_dmap_get_cstr(map, entry, out) \
+    ext_dmap_get_ex(map, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_dmap_delete_cstr(map, entry) \
+    ext_dmap_delete_ex(map, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_dmap_put_ss(map, entry) \
+    ext_dmap_put_ex(map, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_dmap_get_ss(map, entry, out) \
+    ext_dmap_get_ex(map, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_dmap_delete_ss(map, entry) \
+    ext_dmap_delete_ex(map, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+#define ext_dmap_clear(map)                                          \
+    do {                                                             \
+        if((map)->index) {                                           \
+            size_t width_ = ext_dmap_index_width_((map)->capacity);  \
+            memset((map)->index, 0, width_ * ((map)->capacity + 1)); \
+        }                                                            \
+        (map)->size = 0;                                             \
+        (map)->used = 0;                                             \
+    } while(0)
+
+#define ext_dmap_free(map)                                                           \
+    do {                                                                             \
+        if((map)->entries) {                                                         \
+            ext_dmap_free_((map)->entries, sizeof(*(map)->entries), (map)->capacity, \
+                           (map)->allocator);                                        \
+        }                                                                            \
+        memset((map), 0, sizeof(*(map)));                                            \
+    } while(0)
+
+// Iterates the entries in insertion order
+#define ext_dmap_foreach(T, it, map)                                      \
+    for(T *it = ext_dmap_begin(map), *end = ext_dmap_end(map); it != end; \
+        it = ext_dmap_next(map, it))
+
+#define ext_dmap_end(map) ((map)->entries ? (map)->entries + (map)->used : NULL)
+#define ext_dmap_begin(map) \
+    ext_dmap_next_((map)->entries, (map)->hashes, (map)->used, sizeof(*(map)->entries), NULL)
+#define ext_dmap_next(map, it) \
+    ext_dmap_next_((map)->entries, (map)->hashes, (map)->used, sizeof(*(map)->entries), it)
+
+// -----------------------------------------------------------------------------
+// Private dense hashmap implementation
+
+#define EXT_DMAP_EMPTY     0
+#define EXT_DMAP_DELETED   1
+#define EXT_DMAP_NOT_FOUND SIZE_MAX
+
+void ext_dmap_rebuild_(void **entries, size_t entries_sz, size_t **hashes, void **index,
+                       size_t *cap, size_t *used, size_t size, Ext_Allocator **a);
+void ext_dmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a);
+
+// Finds the index slot of `entry`, or the slot where it should be inserted, in `idx_`.
+// `entry_idx_` is set to the position of the entry in the dense array, or EXT_DMAP_NOT_FOUND
+#define ext_dmap_find_index_(map, entry, hash, cmp)                                \
+    size_t idx_ = 0, entry_idx_ = EXT_DMAP_NOT_FOUND;                              \
+    {                                                                              \
+        size_t i_ = (hash) & (map)->capacity;                                      \
+        bool tomb_found_ = false;                                                  \
+        size_t tomb_idx_ = 0;                                                      \
+        for(;;) {                                                                  \
+            size_t slot_ = ext_dmap_index_get_((map)->index, (map)->capacity, i_); \
+            if(slot_ == EXT_DMAP_EMPTY) {                                          \
+                idx_ = tomb_found_ ? tomb_idx_ : i_;                               \
+                break;                                                             \
+            } else if(slot_ == EXT_DMAP_DELETED) {                                 \
+                if(!tomb_found_) {                                                 \
+                    tomb_found_ = true;                                            \
+                    tomb_idx_ = i_;                                                \
+                }                                                                  \
+            } else if((map)->hashes[slot_ - 2] == (hash) &&                        \
+                      cmp((entry), &(map)->entries[slot_ - 2]) == 0) {             \
+                idx_ = i_;                                                         \
+                entry_idx_ = slot_ - 2;                                            \
+                break;                                                             \
+            }                                                                      \
+            i_ = (i_ + 1) & (map)->capacity;                                       \
+        }                                                                          \
+    }
+
+// Width in bytes of the slots of the index table, for a table of capacity `cap + 1`.
+// Slots store the position of the entry + 2, as 0 and 1 are reserved for empty and deleted slots
+static inline size_t ext_dmap_index_width_(size_t cap) {
+    size_t max_slot = EXT_HMAP_MAX_ENTRY_LOAD(cap + 1) + 1;
+    if(max_slot <= UINT8_MAX) return sizeof(uint8_t);
+    if(max_slot <= UINT16_MAX) return sizeof(uint16_t);
+    if(max_slot <= UINT32_MAX) return sizeof(uint32_t);
+    return sizeof(uint64_t);
+}
+
+static inline size_t ext_dmap_index_get_(const void *index, size_t cap, size_t i) {
+    switch(ext_dmap_index_width_(cap)) {
+    case sizeof(uint8_t):
+        return ((const uint8_t *)index)[i];
+    case sizeof(uint16_t):
+        return ((const uint16_t *)index)[i];
+    case sizeof(uint32_t):
+        return ((const uint32_t *)index)[i];
+    default:
+        return (size_t)((const uint64_t *)index)[i];
+    }
+}
+
+static inline void ext_dmap_index_set_(void *index, size_t cap, size_t i, size_t v) {
+    switch(ext_dmap_index_width_(cap)) {
+    case sizeof(uint8_t):
+        ((uint8_t *)index)[i] = (uint8_t)v;
+        break;
+    case sizeof(uint16_t):
+        ((uint16_t *)index)[i] = (uint16_t)v;
+        break;
+    case sizeof(uint32_t):
+        ((uint32_t *)index)[i] = (uint32_t)v;
+        break;
+    default:
+        ((uint64_t *)index)[i] = v;
+        break;
+    }
+}
+
+static inline void *ext_dmap_next_(const void *entries, const size_t *hashes, size_t used,
+                                   size_t sz, const void *it) {
+    if(!entries) return NULL;
+    size_t i = it ? ((char *)it - (char *)entries) / sz + 1 : 0;
+    while(i < used && !EXT_HMAP_IS_VALID(hashes[i])) i++;
+    return (char *)entries + i * sz;
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Typed hashmap
+//
+// Generates a hashmap specialized for a key and value type, along with named functions to operate
+// on it. The `hmap` macros expand the whole probing loop at every call site; the generated
+// functions expand it once per map type instead, keeping call sites small and giving the compiler
+// (and the debugger) a real function to work with.
+//
+// `hash` must take a key by value and return a `size_t`, and `eq` must take two keys by value and
+// return true when they are equal. Both can be either functions or function-like macros.
+//
+// For a map `Name` with prefix `prefix`, the following are generated:
+//   - `Name##Entry`: the entry struct, with `key` and `value` fields
+//   - `Name`: the map struct, with the same layout as an `hmap`
+//   - `void prefix##_put(Name *map, K key, V value)`
+//   - `V *prefix##_get(Name *map, K key)`: pointer to the value, or NULL if the key is missing
+//   - `bool prefix##_delete(Name *map, K key)`: returns whether the key was found
+//   - `void prefix##_reserve(Name *map, size_t n)`
+//   - `void prefix##_clear(Name *map)`
+//   - `void prefix##_free(Name *map)`
+//
+// USAGE
+// ```c
+// typedef struct {
+//     int x, y;
+// } Point;
+//
+// size_t hash_point(Point p) { return ext_hash_bytes_(&p, sizeof(p)); }
+// bool point_eq(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+//
+// EXT_DECLARE_HMAP(PointMap, pointmap, Point, int, hash_point, point_eq)
+// EXT_DECLARE_HMAP_INT(IntIntMap, intmap, int, int)
+//
+// PointMap map = {0};
+// pointmap_put(&map, (Point){1, 2}, 10);
+// int *v = pointmap_get(&map, (Point){1, 2});
+// pointmap_delete(&map, (Point){1, 2});
+// hmap_foreach(PointMapEntry, it, &map) {
+//     // The struct is compatible with the generic `hmap` macros
+// }
+// pointmap_free(&map);
+// ```
+//
+// NOTE
+// `EXT_DECLARE_HMAP` generates `static inline` functions. `EXT_DECLARE_HMAP_EX` takes the function
+// specifiers as its last argument instead, for example `static` to leave inlining decisions
+// entirely to the compiler. The generated functions are marked `EXT_MAYBE_UNUSED`, so that the
+// ones a translation unit doesn't call don't trigger warnings.
+// Lookups must go through the generated functions: the generic `hmap` macros hash the raw bytes of
+// the key, while the map is keyed by `hash`.
+
+#define EXT_DECLARE_HMAP(Name, prefix, K, V, hash, eq) \
+    EXT_DECLARE_HMAP_EX(Name, prefix, K, V, hash, eq, static inline)
+
+// Keys are hashed with the 4 or 8 byte integer hash and compared with `==`
+#define EXT_DECLARE_HMAP_INT(Name, prefix, K, V) \
+    EXT_DECLARE_HMAP_EX(Name, prefix, K, V, ext_hmap_hash_int_, ext_hmap_int_eq_, static inline)
+
+#define EXT_DECLARE_HMAP_EX(Name, prefix, K, V, hash, eq, fn)                           \
+    typedef struct Name##Entry {                                                        \
+        K key;                                                                          \
+        V value;                                                                        \
+    } Name##Entry;                                                                      \
+                                                                                        \
+    typedef struct Name {                                                               \
+        Name##Entry *entries;                                                           \
+        size_t *hashes;                                                                 \
+        size_t size, tombstones, capacity;                                              \
+        Ext_Allocator *allocator;                                                       \
+    } Name;                                                                             \
+                                                                                        \
+    static inline size_t prefix##_hash_key_(const K *key) {                             \
+        return hash(*key);                                                              \
+    }                                                                                   \
+    static inline size_t prefix##_hash_entry_(const Name##Entry *e) {                   \
+        return hash(e->key);                                                            \
+    }                                                                                   \
+    static inline int prefix##_cmp_key_(const K *key, const Name##Entry *e) {           \
+        return !eq(*key, e->key);                                                       \
+    }                                                                                   \
+    static inline int prefix##_cmp_entry_(const Name##Entry *a, const Name##Entry *b) { \
+        return !eq(a->key, b->key);                                                     \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn void prefix##_put(Name *map, K key, V value) {                  \
+        Name##Entry entry = {.key = key, .value = value};                               \
+        ext_hmap_put_ex(map, &entry, prefix##_hash_entry_, prefix##_cmp_entry_);        \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn V *prefix##_get(Name *map, K key) {                             \
+        if(!map->entries) return NULL;                                                  \
+        Name##Entry *e;                                                                 \
+        ext_hmap_get_ex(map, &key, &e, prefix##_hash_key_, prefix##_cmp_key_);          \
+        return e ? &e->value : NULL;                                                    \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn bool prefix##_delete(Name *map, K key) {                        \
+        if(!map->entries) return false;                                                 \
+        size_t size = map->size;                                                        \
+        ext_hmap_delete_ex(map, &key, prefix##_hash_key_, prefix##_cmp_key_);           \
+        return map->size != size;                                                       \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn void prefix##_reserve(Name *map, size_t n) {                    \
+        ext_hmap_reserve(map, n);                                                       \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn void prefix##_clear(Name *map) {                                \
+        if(map->entries) ext_hmap_clear(map);                                           \
+    }                                                                                   \
+                                                                                        \
+    EXT_MAYBE_UNUSED fn void prefix##_free(Name *map) {                                 \
+        ext_hmap_free(map);                                                             \
+    }
+
+// -----------------------------------------------------------------------------
+// Private typed hashmap implementation
+
+#define ext_hmap_hash_int_(k)  ext_hash_int_((uint64_t)(k), sizeof(k))
+#define ext_hmap_int_eq_(a, b) ((a) == (b))
+
+static inline size_t ext_hash_int_(uint64_t k, size_t width) {
+    if(width <= sizeof(uint32_t)) {
+        uint32_t k32 = (uint32_t)k;
+        return ext_hash_bytes_(&k32, sizeof(k32));
+    }
+    return ext_hash_bytes_(&k, sizeof(k));
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Hashset
+//
+// A set of keys, built on the same linear probing table as `hmap`.
+// The elements of the set are the keys themselves instead of entries with a `key` field, so no
+// space is wasted on values. As with `hmap`, the `hashes` field can be declared as `uint32_t *` to
+// halve the memory of the hashes.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     int *entries;
+//     size_t *hashes;
+//     size_t size, tombstones, capacity;
+//     Allocator *allocator;
+// } IntSet;
+//
+// IntSet set = {0};
+// hset_add(&set, &((int){1}));
+// bool found;
+// hset_contains(&set, &((int){1}), &found);
+// hset_remove(&set, &((int){1}));
+// hset_foreach(int, it, &set) {
+//     // ...
+// }
+// hset_free(&set);
+// ```
+//
+// NOTE
+// The set is compatible with the `hmap` macros that don't touch keys, such as `hmap_reserve`,
+// `hmap_compact` and `hmap_stats`.
+
+#define ext_hset_add_ex(set, key, hash, cmp) ext_hmap_put_ex(set, key, hash, cmp)
+
+#define ext_hset_contains_ex(set, key, found, hash, cmp)       \
+    do {                                                       \
+        *(found) = false;                                      \
+        if((set)->entries) {                                   \
+            size_t hash_ = ext_hmap_fix_hash_(set, hash(key)); \
+            ext_hmap_find_index_(set, key, hash_, cmp);        \
+            *(found) = EXT_HMAP_IS_VALID((set)->hashes[idx_]); \
+        }                                                      \
+    } while(0)
+
+#define ext_hset_remove_ex(set, key, hash, cmp)      \
+    do {                                             \
+        if((set)->entries) {                         \
+            ext_hmap_delete_ex(set, key, hash, cmp); \
+        }                                            \
+    } while(0)
+
+// `key` is a pointer to the key
+#define ext_hset_add(set, key) ext_hset_add_ex(set, key, ext_hset_hash_bytes_, ext_hset_memcmp_)
+#define ext_hset_contains(set, key, found) \
+    ext_hset_contains_ex(set, key, found, ext_hset_hash_bytes_, ext_hset_memcmp_)
+#define ext_hset_remove(set, key) \
+    ext_hset_remove_ex(set, key, ext_hset_hash_bytes_, ext_hset_memcmp_)
+
+// `key` is a `const char *`. The pointer is stored as is, not copied
+#define ext_hset_add_cstr(set, key)                                              \
+    do {                                                                         \
+        const char *cstr_ = (key);                                               \
+        ext_hset_add_ex(set, &cstr_, ext_hmap_hash_cstr_ptr_, ext_hset_strcmp_); \
+    } while(0)
+#define ext_hset_contains_cstr(set, key, found)                                              \
+    do {                                                                                     \
+        const char *cstr_ = (key);                                                           \
+        ext_hset_contains_ex(set, &cstr_, found, ext_hmap_hash_cstr_ptr_, ext_hset_strcmp_); \
+    } while(0)
+#define ext_hset_remove_cstr(set, key)                                              \
+    do {                                                                            \
+        const char *cstr_ = (key);                                                  \
+        ext_hset_remove_ex(set, &cstr_, ext_hmap_hash_cstr_ptr_, ext_hset_strcmp_); \
+    } while(0)
+
+// `key` is an `Ext_StringSlice`
+#define ext_hset_add_ss(set, key)                                           \
+    do {                                                                    \
+        Ext_StringSlice ss_ = (key);                                        \
+        ext_hset_add_ex(set, &ss_, ext_hmap_hash_ss_ptr_, ext_hset_sscmp_); \
+    } while(0)
+#define ext_hset_contains_ss(set, key, found)                                           \
+    do {                                                                                \
+        Ext_StringSlice ss_ = (key);                                                    \
+        ext_hset_contains_ex(set, &ss_, found, ext_hmap_hash_ss_ptr_, ext_hset_sscmp_); \
+    } while(0)
+#define ext_hset_remove_ss(set, key)                                           \
+    do {                                                                       \
+        Ext_StringSlice ss_ = (key);                                           \
+        ext_hset_remove_ex(set, &ss_, ext_hmap_hash_ss_ptr_, ext_hset_sscmp_); \
+    } while(0)
+
+#define ext_hset_clear(set)                     \
+    do {                                        \
+        if((set)->entries) ext_hmap_clear(set); \
+    } while(0)
+
+#define ext_hset_reserve(set, n) ext_hmap_reserve(set, n)
+#define ext_hset_free(set)       ext_hmap_free(set)
+
+#define ext_hset_foreach(T, it, set) ext_hmap_foreach(T, it, set)
+#define ext_hset_end(set)            ext_hmap_end(set)
+#define ext_hset_begin(set)          ext_hmap_begin(set)
+#define ext_hset_next(set, it)       ext_hmap_next(set, it)
+
+// -----------------------------------------------------------------------------
+// SECTION: Integer set
+//
+// A set of integer keys that stores nothing but the keys.
+// Instead of keeping a separate array of hashes, empty slots are marked by the zero key, and
+// deleted keys are removed by shifting back the rest of their probe run, so no tombstones are
+// needed. The zero key itself is stored in a dedicated slot past the end of the table, and tracked
+// by the `has_zero` field. Keys can be of any integer type up to 64 bits.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     uint64_t *entries;
+//     size_t size, capacity;
+//     bool has_zero;
+//     Allocator *allocator;
+// } IdSet;
+//
+// IdSet set = {0};
+// iset_add(&set, 42);
+// bool found;
+// iset_contains(&set, 42, &found);
+// iset_remove(&set, 42);
+// iset_foreach(uint64_t, it, &set) {
+//     // ...
+// }
+// iset_free(&set);
+// ```
+//
+// NOTE
+// Since hashes are not stored, growing the set rehashes all keys. For integer keys this is cheap,
+// and it makes the set take half the memory of an `hset` with 64-bit keys and hashes.
+
+#define ext_iset_add(set, key)                                                                   \
+    do {                                                                                         \
+        uint64_t ikey_ = ext_iset_mask_((uint64_t)(key), sizeof(*(set)->entries));               \
+        if(ikey_ == 0) {                                                                         \
+            if(!(set)->has_zero) {                                                               \
+                if(!(set)->entries) ext_iset_grow_(set);                                         \
+                (set)->has_zero = true;                                                          \
+                (set)->size++;                                                                   \
+            }                                                                                    \
+        } else {                                                                                 \
+            if((set)->size >= EXT_HMAP_MAX_ENTRY_LOAD((set)->capacity + 1)) ext_iset_grow_(set); \
+            ext_iset_find_index_(set, ikey_);                                                    \
+            if((set)->entries[idx_] == 0) {                                                      \
+                (set)->entries[idx_] = ikey_;                                                    \
+                (set)->size++;                                                                   \
+            }                                                                                    \
+        }                                                                                        \
+    } while(0)
+
+#define ext_iset_contains(set, key, found)                                         \
+    do {                                                                           \
+        uint64_t ikey_ = ext_iset_mask_((uint64_t)(key), sizeof(*(set)->entries)); \
+        if(ikey_ == 0 || !(set)->entries) {                                        \
+            *(found) = ikey_ == 0 && (set)->has_zero;                              \
+        } else {                                                                   \
+            ext_iset_find_index_(set, ikey_);                                      \
+            *(found) = (set)->entries[idx_] != 0;                                  \
+        }                                                                          \
+    } while(0)
+
+#define ext_iset_remove(set, key)                                                             \
+    do {                                                                                      \
+        uint64_t ikey_ = ext_iset_mask_((uint64_t)(key), sizeof(*(set)->entries));            \
+        if(ikey_ == 0) {                                                                      \
+            if((set)->has_zero) {                                                             \
+                (set)->has_zero = false;                                                      \
+                (set)->size--;                                                                \
+            }                                                                                 \
+        } else if((set)->entries) {                                                           \
+            ext_iset_find_index_(set, ikey_);                                                 \
+            if((set)->entries[idx_] != 0) {                                                   \
+                ext_iset_remove_at_((set)->entries, sizeof(*(set)->entries), (set)->capacity, \
+                                    idx_);                                                    \
+                (set)->size--;                                                                \
+            }                                                                                 \
+        }                                                                                     \
+    } while(0)
+
+// Makes sure the set can hold at least `n` keys without having to grow
+#define ext_iset_reserve(set, n)                                                                  \
+    do {                                                                                          \
+        size_t reserve_n_ = (n);                                                                  \
+        if(!(set)->entries || reserve_n_ > EXT_HMAP_MAX_ENTRY_LOAD((set)->capacity + 1)) {        \
+            ext_iset_rehash_((void **)&(set)->entries, sizeof(*(set)->entries), &(set)->capacity, \
+                             reserve_n_, &(set)->allocator);                                      \
+        }                                                                                         \
+    } while(0)
+
+#define ext_iset_clear(set)                                                             \
+    do {                                                                                \
+        if((set)->entries) {                                                            \
+            memset((set)->entries, 0, sizeof(*(set)->entries) * ((set)->capacity + 1)); \
+        }                                                                               \
+        (set)->size = 0;                                                                \
+        (set)->has_zero = false;                                                        \
+    } while(0)
+
+#define ext_iset_free(set)                                                           \
+    do {                                                                             \
+        if((set)->entries) {                                                         \
+            (set)->allocator->free((set)->allocator, (set)->entries,                 \
+                                   sizeof(*(set)->entries) * ((set)->capacity + 2)); \
+        }                                                                            \
+        memset((set), 0, sizeof(*(set)));                                            \
+    } while(0)
+
+// Visits the zero key last, if present
+#define ext_iset_foreach(T, it, set)                                      \
+    for(T *it = ext_iset_begin(set), *end = ext_iset_end(set); it != end; \
+        it = ext_iset_next(set, it))
+
+#define ext_iset_end(set) ((set)->entries ? (set)->entries + (set)->capacity + 2 : NULL)
+#define ext_iset_begin(set) \
+    ext_iset_next_((set)->entries, sizeof(*(set)->entries), (set)->capacity, (set)->has_zero, NULL)
+#define ext_iset_next(set, it) \
+    ext_iset_next_((set)->entries, sizeof(*(set)->entries), (set)->capacity, (set)->has_zero, it)
+
+// -----------------------------------------------------------------------------
+// Private hashset implementation
+
+#define ext_hset_hash_bytes_(k) ext_hash_bytes_(k, sizeof(*(k)))
+#define ext_hset_memcmp_(a, b)  memcmp(a, b, sizeof(*(a)))
+#define ext_hset_strcmp_(a, b)  strcmp(*(a), *(b))
+#define ext_hset_sscmp_(a, b)   ext_ss_cmp(*(a), *(b))
+
+void ext_iset_rehash_(void **entries, size_t key_sz, size_t *cap, size_t n, Ext_Allocator **a);
+void ext_iset_remove_at_(void *entries, size_t key_sz, size_t cap, size_t idx);
+
+#define ext_iset_grow_(set)                                                                   \
+    ext_iset_rehash_((void **)&(set)->entries, sizeof(*(set)->entries), &(set)->capacity,     \
+                     (set)->entries ? EXT_HMAP_MAX_ENTRY_LOAD(((set)->capacity + 1) * 2) : 0, \
+                     &(set)->allocator)
+
+// Finds the slot of `key`, or the empty slot where it should be inserted, in `idx_`
+#define ext_iset_find_index_(set, key)                                                        \
+    size_t idx_ = ext_hash_int_(key, sizeof(*(set)->entries)) & (set)->capacity;              \
+    while((set)->entries[idx_] != 0 &&                                                        \
+          ext_iset_mask_((uint64_t)(set)->entries[idx_], sizeof(*(set)->entries)) != (key)) { \
+        idx_ = (idx_ + 1) & (set)->capacity;                                                  \
+    }
+
+// Keeps only the low `key_sz` bytes of `key`, so that signed keys are treated the same way no
+// matter how they were converted to 64 bits
+static inline uint64_t ext_iset_mask_(uint64_t key, size_t key_sz) {
+    return key_sz >= sizeof(uint64_t) ? key : key & (((uint64_t)1 << (key_sz * 8)) - 1);
+}
+
+static inline uint64_t ext_iset_load_(const void *entries, size_t key_sz, size_t i) {
+    switch(key_sz) {
+    case sizeof(uint8_t):
+        return ((const uint8_t *)entries)[i];
+    case sizeof(uint16_t):
+        return ((const uint16_t *)entries)[i];
+    case sizeof(uint32_t):
+        return ((const uint32_t *)entries)[i];
+    default:
+        return ((const uint64_t *)entries)[i];
+    }
+}
+
+static inline void *ext_iset_next_(const void *entries, size_t key_sz, size_t cap, bool has_zero,
+                                   const void *it) {
+    if(!entries) return NULL;
+    size_t i = it ? (size_t)((const char *)it - (const char *)entries) / key_sz + 1 : 0;
+    for(; i <= cap; i++) {
+        if(ext_iset_load_(entries, key_sz, i) != 0) return (char *)entries + i * key_sz;
+    }
+    // Slot `cap + 1` holds the zero key
+    if(i == cap + 1 && has_zero) return (char *)entries + i * key_sz;
+    return (char *)entries + (cap + 2) * key_sz;
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Generational hashmap
+//
+// A variant of the hashmap that can be cleared in constant time.
+// Every slot is tagged with the generation of the map it was written in, stored in the high bits
+// of its hash. `clear` just moves the map to the next generation, making all the slots written in
+// the previous ones look empty, instead of zeroing the whole hashes array. A real memset only
+// happens once every `EXT_GHMAP_MAX_GENERATION` clears, when the generation counter wraps around.
+// This suits large scratch maps that are sparsely filled and cleared very often.
+//
+// The struct is the same as `hmap`, plus the current generation:
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     size_t *hashes;
+//     size_t size, tombstones, capacity;
+//     size_t generation;
+//     Allocator *allocator;
+// } IntScratchMap;
+//
+// IntScratchMap map = {0};
+// for(;;) {
+//     ghmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+//     IntEntry *e;
+//     ghmap_get(&map, &((IntEntry){.key = 1}), &e);
+//     ghmap_clear(&map);
+// }
+// ghmap_free(&map);
+// ```
+//
+// NOTE
+// The generation takes the high 16 bits of the stored hashes (8 bits on 32-bit targets), so
+// `hashes` must be declared as `size_t *`.
+
+#if SIZE_MAX > 0xffffffffu
+#define EXT_GHMAP_GENERATION_BITS 16
+#else
+#define EXT_GHMAP_GENERATION_BITS 8
+#endif
+
+// Number of clears between two memsets of the hashes array
+#define EXT_GHMAP_MAX_GENERATION (((size_t)1 << EXT_GHMAP_GENERATION_BITS) - 1)
+
+#define ext_ghmap_put_ex(map, entry, hash, cmp)                                                \
+    do {                                                                                       \
+        if((map)->size + (map)->tombstones >= EXT_HMAP_MAX_ENTRY_LOAD((map)->capacity + 1)) {  \
+            ext_ghmap_grow_((void **)&(map)->entries, sizeof(*(map)->entries), &(map)->hashes, \
+                            &(map)->capacity, (map)->size, &(map)->generation,                 \
+                            &(map)->allocator);                                                \
+            (map)->tombstones = 0;                                                             \
+        }                                                                                      \
+        size_t hash_ = ext_ghmap_fix_hash_(hash(entry));                                       \
+        ext_ghmap_find_index_(map, entry, hash_, cmp);                                         \
+        size_t slot_ = ext_ghmap_untag_((map)->hashes[idx_], (map)->generation);               \
+        if(!EXT_HMAP_IS_VALID(slot_)) {                                                        \
+            if(EXT_HMAP_IS_TOMB(slot_)) (map)->tombstones--;                                   \
+            (map)->size++;                                                                     \
+        }                                                                                      \
+        (map)->hashes[idx_] = ext_ghmap_tag_(hash_, (map)->generation);                        \
+        (map)->entries[idx_] = *(entry);                                                       \
+    } while(0)
+
+#define ext_ghmap_get_ex(map, entry, out, hash, cmp)                              \
+    do {                                                                          \
+        *(out) = NULL;                                                            \
+        if((map)->entries) {                                                      \
+            size_t hash_ = ext_ghmap_fix_hash_(hash(entry));                      \
+            ext_ghmap_find_index_(map, entry, hash_, cmp);                        \
+            if((map)->hashes[idx_] == ext_ghmap_tag_(hash_, (map)->generation)) { \
+                *(out) = &(map)->entries[idx_];                                   \
+            }                                                                     \
+        }                                                                         \
+    } while(0)
+
+#define ext_ghmap_delete_ex(map, entry, hash, cmp)                                \
+    do {                                                                          \
+        if((map)->entries) {                                                      \
+            size_t hash_ = ext_ghmap_fix_hash_(hash(entry));                      \
+            ext_ghmap_find_index_(map, entry, hash_, cmp);                        \
+            if((map)->hashes[idx_] == ext_ghmap_tag_(hash_, (map)->generation)) { \
+                (map)->hashes[idx_] = ext_ghmap_tag_(EXT_HMAP_TOMB_MARK,          \
+                                                     (map)->generation);          \
+                (map)->size--;                                                    \
+                (map)->tombstones++;                                              \
+            }                                                                     \
+        }                                                                         \
+    } while(0)
+
+#define ext_ghmap_put(map, entry) \
+    ext_ghmap_put_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ghmap_get(map, entry, out) \
+    ext_ghmap_get_ex(map, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ghmap_delete(map, entry) \
+    ext_ghmap_delete_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_ghmap_put_cstr(map, entry) \
+    ext_ghmap_put_ex(map, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_ghmap_get_cstr(map, entry, out) \
+    ext_ghmap_get_ex(map, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_ghmap_delete_cstr(map, entry) \
+    ext_ghmap_delete_ex(map, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_ghmap_put_ss(map, entry) \
+    ext_ghmap_put_ex(map, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_ghmap_get_ss(map, entry, out) \
+    ext_ghmap_get_ex(map, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_ghmap_delete_ss(map, entry) \
+    ext_ghmap_delete_ex(map, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+// Removes all entries in constant time, by moving the map to a new generation
+#define ext_ghmap_clear(map)                                                              \
+    do {                                                                                  \
+        if((map)->entries) {                                                              \
+            if(++(map)->generation > EXT_GHMAP_MAX_GENERATION) {                          \
+                memset((map)->hashes, 0, sizeof(*(map)->hashes) * ((map)->capacity + 1)); \
+                (map)->generation = 1;                                                    \
+            }                                                                             \
+        }                                                                                 \
+        (map)->size = 0;                                                                  \
+        (map)->tombstones = 0;                                                            \
+    } while(0)
+
+#define ext_ghmap_free(map)                                                               \
+    do {                                                                                  \
+        if((map)->entries) {                                                              \
+            ext_hmap_free_table_((map)->entries, sizeof(*(map)->entries), sizeof(size_t), \
+                                 (map)->capacity, (map)->allocator);                      \
+        }                                                                                 \
+        memset((map), 0, sizeof(*(map)));                                                 \
+    } while(0)
+
+#define ext_ghmap_foreach(T, it, map)                                       \
+    for(T *it = ext_ghmap_begin(map), *end = ext_ghmap_end(map); it != end; \
+        it = ext_ghmap_next(map, it))
+
+#define ext_ghmap_end(map) ext_hmap_end(map)
+#define ext_ghmap_begin(map) ext_ghmap_next(map, NULL)
+#define ext_ghmap_next(map, it)                                                        \
+    ext_ghmap_next_((map)->entries, (map)->hashes, (map)->capacity, (map)->generation, \
+                    sizeof(*(map)->entries), it)
+
+// -----------------------------------------------------------------------------
+// Private generational hashmap implementation
+
+#define EXT_GHMAP_HASH_BITS_ (sizeof(size_t) * CHAR_BIT - EXT_GHMAP_GENERATION_BITS)
+#define EXT_GHMAP_HASH_MASK_ (((size_t)1 << EXT_GHMAP_HASH_BITS_) - 1)
+
+void ext_ghmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap, size_t size,
+                     size_t *gen, Ext_Allocator **a);
+
+#define ext_ghmap_tag_(hash, gen) (((size_t)(gen) << EXT_GHMAP_HASH_BITS_) | (hash))
+
+// Finds the slot of `entry`, or the slot where it should be inserted, in `idx_`.
+// A slot written in a previous generation is treated as empty
+#define ext_ghmap_find_index_(map, entry, hash, cmp)                 \
+    size_t idx_ = 0;                                                 \
+    {                                                                \
+        size_t tagged_ = ext_ghmap_tag_(hash, (map)->generation);    \
+        size_t i_ = (hash) & (map)->capacity;                        \
+        bool tomb_found_ = false;                                    \
+        size_t tomb_idx_ = 0;                                        \
+        for(;;) {                                                    \
+            size_t buck_ = (map)->hashes[i_];                        \
+            if(buck_ == tagged_) {                                   \
+                if(cmp((entry), &(map)->entries[i_]) == 0) {         \
+                    idx_ = i_;                                       \
+                    break;                                           \
+                }                                                    \
+            } else {                                                 \
+                buck_ = ext_ghmap_untag_(buck_, (map)->generation);  \
+                if(EXT_HMAP_IS_EMPTY(buck_)) {                       \
+                    idx_ = tomb_found_ ? tomb_idx_ : i_;             \
+                    break;                                           \
+                } else if(EXT_HMAP_IS_TOMB(buck_) && !tomb_found_) { \
+                    tomb_found_ = true;                              \
+                    tomb_idx_ = i_;                                  \
+                }                                                    \
+            }                                                        \
+            i_ = (i_ + 1) & (map)->capacity;                         \
+        }                                                            \
+    }
+
+// Truncates the hash to the bits left free by the generation
+static inline size_t ext_ghmap_fix_hash_(size_t hash) {
+    hash &= EXT_GHMAP_HASH_MASK_;
+    return hash < 2 ? hash + 2 : hash;
+}
+
+// Returns the hash stored in a slot, or EXT_HMAP_EMPTY_MARK if the slot was written in another
+// generation
+static inline size_t ext_ghmap_untag_(size_t stored, size_t gen) {
+    return stored >> EXT_GHMAP_HASH_BITS_ == gen ? stored & EXT_GHMAP_HASH_MASK_
+                                                 : EXT_HMAP_EMPTY_MARK;
+}
+
+static inline void *ext_ghmap_next_(const void *entries, const size_t *hashes, size_t cap,
+                                    size_t gen, size_t sz, const void *it) {
+    if(!entries) return NULL;
+    size_t i = it ? ((const char *)it - (const char *)entries) / sz + 1 : 0;
+    for(; i <= cap; i++) {
+        if(EXT_HMAP_IS_VALID(ext_ghmap_untag_(hashes[i], gen))) {
+            return (char *)entries + i * sz;
+        }
+    }
+    return ext_hmap_end_(entries, cap, sz);
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Node hashmap
+//
+// A variant of the hashmap with stable pointers to its entries.
+// The table only holds the hashes and pointers to the entries, while the entries themselves live
+// in slabs of nodes allocated from the map's allocator. Growing the map only rehashes the table
+// of pointers, without moving or copying the entries, so a pointer returned by `get` stays valid
+// until its entry is deleted or the map is cleared or freed. Deleted nodes are kept in a free list
+// and reused by later insertions.
+//
+// This trades an extra indirection on every lookup for cheap growth, and is best suited to maps
+// with large entries, or whose entries are referenced from elsewhere.
+//
+// The `entries` field is an array of pointers to entries, and the map needs two more fields to
+// track its slabs of nodes:
+//
+// USAGE
+// ```c
+// typedef struct {
+//     BigEntry **entries;
+//     size_t *hashes;
+//     size_t size, tombstones, capacity;
+//     void *slabs, *free_nodes;
+//     Allocator *allocator;
+// } BigNodeMap;
+//
+// BigNodeMap map = {0};
+// nmap_put(&map, &((BigEntry){.key = 1, .value = {0}}));
+// BigEntry *e;
+// nmap_get(&map, &((BigEntry){.key = 1}), &e);
+// // Still valid after adding more entries
+// for(int i = 2; i < 1000; i++) nmap_put(&map, &((BigEntry){.key = i}));
+// nmap_foreach(BigEntry, it, &map) {
+//     printf("%d\n", it->key);
+// }
+// nmap_free(&map);
+// ```
+//
+// NOTE
+// `begin`, `next` and `end` return pointers to the slots of the table (`T **`), that have to be
+// dereferenced to get to the entry. `foreach` does this for you.
+
+// Number of nodes in the first slab of a map. Every new slab doubles the size of the previous
+// one, up to `EXT_NMAP_MAX_SLAB_NODES`
+#define EXT_NMAP_INIT_SLAB_NODES 8
+#define EXT_NMAP_MAX_SLAB_NODES  1024
+
+#define ext_nmap_put_ex(map, entry, hash, cmp)                                             \
+    do {                                                                                   \
+        ext_hmap_make_room_(map);                                                          \
+        size_t hash_ = ext_hmap_fix_hash_(map, hash(entry));                               \
+        ext_nmap_find_index_(map, entry, hash_, cmp);                                      \
+        if(!EXT_HMAP_IS_VALID((map)->hashes[idx_])) {                                      \
+            if(EXT_HMAP_IS_TOMB((map)->hashes[idx_])) (map)->tombstones--;                 \
+            (map)->size++;                                                                 \
+            (map)->hashes[idx_] = hash_;                                                   \
+            (map)->entries[idx_] = ext_nmap_alloc_node_(&(map)->slabs, &(map)->free_nodes, \
+                                                        sizeof(**(map)->entries),          \
+                                                        &(map)->allocator);                \
+        }                                                                                  \
+        *(map)->entries[idx_] = *(entry);                                                  \
+    } while(0)
+
+#define ext_nmap_get_ex(map, entry, out, hash, cmp)              \
+    do {                                                         \
+        *(out) = NULL;                                           \
+        if((map)->entries) {                                     \
+            size_t hash_ = ext_hmap_fix_hash_(map, hash(entry)); \
+            ext_nmap_find_index_(map, entry, hash_, cmp);        \
+            if(EXT_HMAP_IS_VALID((map)->hashes[idx_])) {         \
+                *(out) = (map)->entries[idx_];                   \
+            }                                                    \
+        }                                                        \
+    } while(0)
+
+#define ext_nmap_delete_ex(map, entry, hash, cmp)                                 \
+    do {                                                                          \
+        if((map)->entries) {                                                      \
+            size_t hash_ = ext_hmap_fix_hash_(map, hash(entry));                  \
+            ext_nmap_find_index_(map, entry, hash_, cmp);                         \
+            if(EXT_HMAP_IS_VALID((map)->hashes[idx_])) {                          \
+                ext_nmap_release_node_(&(map)->free_nodes, (map)->entries[idx_]); \
+                (map)->hashes[idx_] = EXT_HMAP_TOMB_MARK;                         \
+                (map)->size--;                                                    \
+                (map)->tombstones++;                                              \
+            }                                                                     \
+        }                                                                         \
+    } while(0)
+
+#define ext_nmap_put(map, entry) \
+    ext_nmap_put_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_nmap_get(map, entry, out) \
+    ext_nmap_get_ex(map, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_nmap_delete(map, entry) \
+    ext_nmap_delete_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_nmap_put_cstr(map, entry) \
+    ext_nmap_put_ex(map, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_nmap_get_cstr(map, entry, out) \
+    ext_nmap_get_ex(map, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_nmap_delete_cstr(map, entry) \
+    ext_nmap_delete_ex(map, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_nmap_put_ss(map, entry) \
+    ext_nmap_put_ex(map, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_nmap_get_ss(map, entry, out) \
+    ext_nmap_get_ex(map, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_nmap_delete_ss(map, entry) \
+    ext_nmap_delete_ex(map, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+// Removes all entries. The slabs are kept, and their nodes reused by later insertions
+#define ext_nmap_clear(map)                                                                    \
+    do {                                                                                       \
+        if((map)->entries) {                                                                   \
+            memset((map)->hashes, 0, sizeof(*(map)->hashes) * ((map)->capacity + 1));          \
+            ext_nmap_reset_nodes_((map)->slabs, &(map)->free_nodes, sizeof(**(map)->entries)); \
+        }                                                                                      \
+        (map)->size = 0;                                                                       \
+        (map)->tombstones = 0;                                                                 \
+    } while(0)
+
+#define ext_nmap_free(map)                                                                   \
+    do {                                                                                     \
+        if((map)->entries) {                                                                 \
+            ext_hmap_free_table_((map)->entries, sizeof(*(map)->entries),                    \
+                                 sizeof(*(map)->hashes), (map)->capacity, (map)->allocator); \
+            ext_nmap_free_slabs_((map)->slabs, sizeof(**(map)->entries), (map)->allocator);  \
+        }                                                                                    \
+        memset((map), 0, sizeof(*(map)));                                                    \
+    } while(0)
+
+#define ext_nmap_foreach(T, it, map)                                           \
+    for(T **it##_slot_ = ext_nmap_begin(map), **it##_end_ = ext_nmap_end(map), \
+          *it = it##_slot_ != it##_end_ ? *it##_slot_ : NULL;                  \
+        it##_slot_ != it##_end_; it##_slot_ = ext_nmap_next(map, it##_slot_),  \
+          it = it##_slot_ != it##_end_ ? *it##_slot_ : NULL)
+
+#define ext_nmap_end(map)      ext_hmap_end(map)
+#define ext_nmap_begin(map)    ext_hmap_begin(map)
+#define ext_nmap_next(map, it) ext_hmap_next(map, it)
+
+// -----------------------------------------------------------------------------
+// Private node hashmap implementation
+
+void *ext_nmap_alloc_node_(void **slabs, void **free_nodes, size_t entry_sz, Ext_Allocator **a);
+void ext_nmap_reset_nodes_(void *slabs, void **free_nodes, size_t entry_sz);
+void ext_nmap_free_slabs_(void *slabs, size_t entry_sz, Ext_Allocator *a);
+
+// Same as `ext_hmap_find_index_`, but comparing with the entries the table points to
+#define ext_nmap_find_index_(map, entry, hash, cmp)                               \
+    size_t idx_ = 0;                                                              \
+    {                                                                             \
+        size_t i_ = (hash) & (map)->capacity;                                     \
+        bool tomb_found_ = false;                                                 \
+        size_t tomb_idx_ = 0;                                                     \
+        for(;;) {                                                                 \
+            size_t buck_ = (map)->hashes[i_];                                     \
+            if(!EXT_HMAP_IS_VALID(buck_)) {                                       \
+                if(EXT_HMAP_IS_EMPTY(buck_)) {                                    \
+                    idx_ = tomb_found_ ? tomb_idx_ : i_;                          \
+                    break;                                                        \
+                } else if(!tomb_found_) {                                         \
+                    tomb_found_ = true;                                           \
+                    tomb_idx_ = i_;                                               \
+                }                                                                 \
+            } else if(buck_ == (hash) && cmp((entry), (map)->entries[i_]) == 0) { \
+                idx_ = i_;                                                        \
+                break;                                                            \
+            }                                                                     \
+            i_ = (i_ + 1) & (map)->capacity;                                      \
+        }                                                                         \
+    }
+
+// Free nodes are linked through their first bytes. The link is copied in and out, as nodes are
+// only as aligned as the entry type
+static inline void ext_nmap_release_node_(void **free_nodes, void *node) {
+    memcpy(node, free_nodes, sizeof(void *));
+    *free_nodes = node;
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Cuckoo hashmap
+//
+// A read-optimized variant of the hashmap with bounded lookups.
+// The table is split in buckets of `EXT_CKMAP_BUCKET_SLOTS` slots, and every key can only live
+// in one of two buckets, both derived from its hash. A `get` or `delete` looks at no more than
+// these two buckets, no matter the load of the table or how keys collide, where the linear probing
+// of `hmap` can degrade to long scans.
+// Each bucket is stored as one block, the hashes of its slots followed by its entries, and tables
+// are aligned to cache lines. Buckets that fit in a line are padded so that none straddles two
+// lines, so a lookup reads at most two lines. With the default 4 slots, this holds for entries of
+// up to 8 bytes. Buckets of larger entries, or of entries whose size isn't a power of two, span
+// more lines, and a lookup reads the lines of both buckets up to the slot it's looking for.
+//
+// The cost is moved to insertion: when both buckets of a key are full, an entry is evicted from
+// one of them and moved to its other bucket, possibly evicting another entry in turn, for at most
+// `EXT_CKMAP_MAX_KICKS` moves. If no free slot is found the table is doubled. This makes the map a
+// good fit for tables that are built once and then mostly read.
+//
+// The struct is the same as `hmap`, without the hashes and tombstones fields, as the hashes live
+// in the buckets and deleted entries simply free their slot. `capacity` is the number of buckets
+// minus one. `entries` points to the start of the table, not to the first entry, so entries
+// should only be reached through `get` and the iteration macros.
+//
+// USAGE
+// ```c
+// typedef struct {
+//     IntEntry *entries;
+//     size_t size, capacity;
+//     Allocator *allocator;
+// } IntCuckooMap;
+//
+// IntCuckooMap map = {0};
+// ckmap_put(&map, &((IntEntry){.key = 1, .value = 10}));
+// IntEntry *e;
+// ckmap_get(&map, &((IntEntry){.key = 1}), &e);
+// ckmap_free(&map);
+// ```
+//
+// NOTE
+// As only two buckets are available for a hash, no more than `2 * EXT_CKMAP_BUCKET_SLOTS` keys
+// with the exact same hash can be stored in the map.
+
+// Number of slots of a bucket
+#ifndef EXT_CKMAP_BUCKET_SLOTS
+#define EXT_CKMAP_BUCKET_SLOTS 4
+#endif  // EXT_CKMAP_BUCKET_SLOTS
+
+// Maximum number of entries moved by a single insertion before growing the table
+#ifndef EXT_CKMAP_MAX_KICKS
+#define EXT_CKMAP_MAX_KICKS 500
+#endif  // EXT_CKMAP_MAX_KICKS
+
+// Size of the cache lines tables are aligned to
+#ifndef EXT_CKMAP_LINE_SIZE
+#define EXT_CKMAP_LINE_SIZE 64
+#endif  // EXT_CKMAP_LINE_SIZE
+
+EXT_STATIC_ASSERT((EXT_CKMAP_BUCKET_SLOTS) > 0, "buckets must have at least one slot");
+EXT_STATIC_ASSERT(((EXT_CKMAP_LINE_SIZE) & ((EXT_CKMAP_LINE_SIZE) - 1)) == 0 &&
+                      (EXT_CKMAP_LINE_SIZE) <= 128,
+                  "cache line size must be a power of 2 no greater than 128");
+
+#define EXT_CKMAP_INIT_BUCKETS 4
+// Maximum load of the table, as 4-slot buckets can be filled up to ~95% before insertions fail
+#define EXT_CKMAP_MAX_ENTRY_LOAD(n) (((n) * 7) >> 3)
+
+#define ext_ckmap_put_ex(map, entry, hash, cmp)                                                    \
+    do {                                                                                           \
+        size_t hash_ = ext_ckmap_fix_hash_(hash(entry));                                           \
+        ext_ckmap_find_index_(map, entry, hash_, cmp);                                             \
+        if(idx_ != EXT_CKMAP_NOT_FOUND) {                                                          \
+            (map)->entries[idx_] = *(entry);                                                       \
+        } else {                                                                                   \
+            ext_ckmap_insert_((void **)&(map)->entries, sizeof(*(map)->entries), &(map)->capacity, \
+                              (map)->size, (entry), hash_, &(map)->allocator);                     \
+            (map)->size++;                                                                         \
+        }                                                                                          \
+    } while(0)
+
+#define ext_ckmap_get_ex(map, entry, out, hash, cmp)                         \
+    do {                                                                     \
+        size_t hash_ = ext_ckmap_fix_hash_(hash(entry));                     \
+        ext_ckmap_find_index_(map, entry, hash_, cmp);                       \
+        *(out) = idx_ != EXT_CKMAP_NOT_FOUND ? &(map)->entries[idx_] : NULL; \
+    } while(0)
+
+#define ext_ckmap_delete_ex(map, entry, hash, cmp)                             \
+    do {                                                                       \
+        size_t hash_ = ext_ckmap_fix_hash_(hash(entry));                       \
+        ext_ckmap_find_index_(map, entry, hash_, cmp);                         \
+        if(idx_ != EXT_CKMAP_NOT_FOUND) {                                      \
+            ext_ckmap_release_((map)->entries, sizeof(*(map)->entries), idx_); \
+            (map)->size--;                                                     \
+        }                                                                      \
+    } while(0)
+
+#define ext_ckmap_put(map, entry) \
+    ext_ckmap_put_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ckmap_get(map, entry, out) \
+    ext_ckmap_get_ex(map, entry, out, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+#define ext_ckmap_delete(map, entry) \
+    ext_ckmap_delete_ex(map, entry, ext_hmap_hash_bytes_, ext_hmap_memcmp_)
+
+#define ext_ckmap_put_cstr(map, entry) \
+    ext_ckmap_put_ex(map, entry, ext_hmap_hash_cstr_entry_, ext_hmap_strcmp_entry_)
+#define ext_ckmap_get_cstr(map, entry, out) \
+    ext_ckmap_get_ex(map, entry, out, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+#define ext_ckmap_delete_cstr(map, entry) \
+    ext_ckmap_delete_ex(map, entry, ext_hmap_hash_cstr_, ext_hmap_strcmp_)
+
+#define ext_ckmap_put_ss(map, entry) \
+    ext_ckmap_put_ex(map, entry, ext_hmap_hash_ss_entry_, ext_hmap_sscmp_entry_)
+#define ext_ckmap_get_ss(map, entry, out) \
+    ext_ckmap_get_ex(map, entry, out, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+#define ext_ckmap_delete_ss(map, entry) \
+    ext_ckmap_delete_ex(map, entry, ext_hmap_hash_ss_, ext_hmap_sscmp_)
+
+// Makes sure the map can hold at least `n` entries without having to grow
+#define ext_ckmap_reserve(map, n)                                                           \
+    ext_ckmap_reserve_((void **)&(map)->entries, sizeof(*(map)->entries), &(map)->capacity, \
+                       n, &(map)->allocator)
+
+#define ext_ckmap_clear(map)                                                            \
+    do {                                                                                \
+        if((map)->entries) {                                                            \
+            ext_ckmap_clear_((map)->entries, sizeof(*(map)->entries), (map)->capacity); \
+        }                                                                               \
+        (map)->size = 0;                                                                \
+    } while(0)
+
+#define ext_ckmap_free(map)                                                           \
+    do {                                                                              \
+        if((map)->entries) {                                                          \
+            ext_ckmap_free_((map)->entries, sizeof(*(map)->entries), (map)->capacity, \
+                            (map)->allocator);                                        \
+        }                                                                             \
+        memset((map), 0, sizeof(*(map)));                                             \
+    } while(0)
+
+#define ext_ckmap_foreach(T, it, map)                                       \
+    for(T *it = ext_ckmap_begin(map), *end = ext_ckmap_end(map); it != end; \
+        it = ext_ckmap_next(map, it))
+
+#define ext_ckmap_end(map)                                                    \
+    ext_ckmap_scan_((map)->entries, sizeof(*(map)->entries), (map)->capacity, \
+                    EXT_CKMAP_SLOTS_((map)->capacity))
+#define ext_ckmap_begin(map) \
+    ext_ckmap_scan_((map)->entries, sizeof(*(map)->entries), (map)->capacity, 0)
+#define ext_ckmap_next(map, it) \
+    ext_ckmap_next_((map)->entries, sizeof(*(map)->entries), (map)->capacity, it)
+
+// -----------------------------------------------------------------------------
+// Private cuckoo hashmap implementation
+
+#define EXT_CKMAP_NOT_FOUND SIZE_MAX
+
+// Number of slots of a table of `cap + 1` buckets
+#define EXT_CKMAP_SLOTS_(cap) (((cap) + 1) * EXT_CKMAP_BUCKET_SLOTS)
+
+void ext_ckmap_insert_(void **entries, size_t entries_sz, size_t *cap, size_t size,
+                       const void *entry, size_t hash, Ext_Allocator **a);
+void ext_ckmap_reserve_(void **entries, size_t entries_sz, size_t *cap, size_t n,
+                        Ext_Allocator **a);
+void ext_ckmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a);
+
+// Looks for `entry` in its two buckets, setting `idx_` to its index in `entries` or to
+// EXT_CKMAP_NOT_FOUND
+#define ext_ckmap_find_index_(map, entry, hash, cmp)                         \
+    size_t idx_ = EXT_CKMAP_NOT_FOUND;                                       \
+    if((map)->entries) {                                                     \
+        size_t units_ = ext_ckmap_bucket_units_(sizeof(*(map)->entries));    \
+        size_t first_ = ext_ckmap_hash_units_(sizeof(*(map)->entries));      \
+        size_t bucket_ = (hash) & (map)->capacity;                           \
+        for(int n_ = 0; n_ < 2 && idx_ == EXT_CKMAP_NOT_FOUND; n_++) {       \
+            size_t i_ = bucket_ * units_;                                    \
+            size_t *hashes_ = (size_t *)((map)->entries + i_);               \
+            for(size_t s_ = 0; s_ < EXT_CKMAP_BUCKET_SLOTS; s_++) {          \
+                if(hashes_[s_] == (hash) &&                                  \
+                   cmp((entry), &(map)->entries[i_ + first_ + s_]) == 0) {   \
+                    idx_ = i_ + first_ + s_;                                 \
+                    break;                                                   \
+                }                                                            \
+            }                                                                \
+            bucket_ = ext_ckmap_alt_bucket_(bucket_, hash, (map)->capacity); \
+        }                                                                    \
+    }
+
+static inline size_t ext_ckmap_fix_hash_(size_t hash) {
+    return hash < 2 ? hash + 2 : hash;
+}
+
+// Returns the other bucket of a key, given one of its buckets. The offset between the two buckets
+// only depends on the high half of the hash, so that either one can be derived from the other.
+// It's always odd, so that the two buckets are never the same
+static inline size_t ext_ckmap_alt_bucket_(size_t bucket, size_t hash, size_t cap) {
+    size_t h = (hash >> (sizeof(size_t) * CHAR_BIT / 2)) * (size_t)0x9e3779b97f4a7c15ull;
+    h ^= h >> (sizeof(size_t) * CHAR_BIT / 2);
+    return (bucket ^ (h | 1)) & cap;
+}
+
+// Number of entries taken by the hashes at the start of a bucket
+static inline size_t ext_ckmap_hash_units_(size_t entries_sz) {
+    return (EXT_CKMAP_BUCKET_SLOTS * sizeof(size_t) + entries_sz - 1) / entries_sz;
+}
+
+// Size of a bucket in entries, so that buckets and slots can be reached with pointer arithmetic
+// on the typed `entries` of the map. Buckets that fit in a cache line are padded to a power of 2,
+// so that none straddles two lines, and larger ones to whole lines. When the entry size isn't a
+// power of 2, buckets are only padded to keep their hashes aligned
+static inline size_t ext_ckmap_bucket_units_(size_t entries_sz) {
+    size_t units = ext_ckmap_hash_units_(entries_sz) + EXT_CKMAP_BUCKET_SLOTS;
+    if(entries_sz & (entries_sz - 1)) {
+        size_t align = entries_sz & (~entries_sz + 1);
+        size_t step = align < sizeof(size_t) ? sizeof(size_t) / align : 1;
+        return (units + step - 1) / step * step;
+    }
+    size_t sz = units * entries_sz;
+    if(sz > EXT_CKMAP_LINE_SIZE) {
+        sz += EXT_ALIGN(sz, EXT_CKMAP_LINE_SIZE);
+        return sz / entries_sz;
+    }
+    size_t pow2 = entries_sz;
+    while(pow2 < sz) pow2 *= 2;
+    return pow2 / entries_sz;
+}
+
+static inline void ext_ckmap_clear_(void *entries, size_t entries_sz, size_t cap) {
+    size_t bucket_sz = ext_ckmap_bucket_units_(entries_sz) * entries_sz;
+    for(size_t i = 0; i <= cap; i++) {
+        memset((char *)entries + i * bucket_sz, 0, EXT_CKMAP_BUCKET_SLOTS * sizeof(size_t));
+    }
+}
+
+// Frees the slot of the entry at index `idx` of `entries`
+static inline void ext_ckmap_release_(void *entries, size_t entries_sz, size_t idx) {
+    size_t units = ext_ckmap_bucket_units_(entries_sz);
+    size_t *hashes = (size_t *)((char *)entries + idx / units * units * entries_sz);
+    hashes[idx % units - ext_ckmap_hash_units_(entries_sz)] = EXT_HMAP_EMPTY_MARK;
+}
+
+// Returns the entry of the first used slot from `slot` on, or the end of the table
+static inline void *ext_ckmap_scan_(const void *entries, size_t entries_sz, size_t cap,
+                                    size_t slot) {
+    if(!entries) return NULL;
+    size_t bucket_sz = ext_ckmap_bucket_units_(entries_sz) * entries_sz;
+    size_t first = ext_ckmap_hash_units_(entries_sz) * entries_sz;
+    for(; slot < EXT_CKMAP_SLOTS_(cap); slot++) {
+        const char *bucket = (const char *)entries + slot / EXT_CKMAP_BUCKET_SLOTS * bucket_sz;
+        size_t i = slot % EXT_CKMAP_BUCKET_SLOTS;
+        if(EXT_HMAP_IS_VALID(((const size_t *)bucket)[i])) {
+            return (char *)bucket + first + i * entries_sz;
+        }
+    }
+    return (char *)entries + (cap + 1) * bucket_sz + first;
+}
+
+static inline void *ext_ckmap_next_(const void *entries, size_t entries_sz, size_t cap,
+                                    const void *it) {
+    size_t units = ext_ckmap_bucket_units_(entries_sz);
+    size_t idx = ((const char *)it - (const char *)entries) / entries_sz;
+    size_t slot = idx / units * EXT_CKMAP_BUCKET_SLOTS + idx % units -
+                  ext_ckmap_hash_units_(entries_sz);
+    return ext_ckmap_scan_(entries, entries_sz, cap, slot + 1);
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Parallel hashmap build
+//
+// Builds a `hmap` or a sharded map from a large array of entries using multiple threads.
+// The entries are first hashed and partitioned by the high bits of their home slot (or by their
+// shard, for sharded maps), so that each partition owns a contiguous range of the table. Every
+// thread then fills the ranges of its own partitions without any locking. The few entries whose
+// probe sequence would run past the end of their range are set aside and inserted by the calling
+// thread at the end.
+//
+// As with `put_all`, if the same key appears more than once the last entry wins, and the map can
+// already contain entries. `merge_parallel` inserts all the entries of a map in another map with
+// the same entry type, reusing the hashes stored in the source table when possible.
+//
+// USAGE
+// ```c
+// IntMap map = {0};
+// hmap_put_all_parallel(&map, entries, n, 8);
+//
+// IntShardedMap shmap = {0};
+// shmap_init(&shmap, 64);
+// shmap_put_all_parallel(&shmap, entries, n, 8);
+//
+// IntMap other = {0};
+// hmap_merge_parallel(&other, &map, 8);
+// ```
+//
+// The `_ex` variants take the hash and comparison functions as function pointers instead of
+// macros, as they are called from the worker threads:
+// ```c
+// size_t point_hash(const void *e) { ... }
+// int point_cmp(const void *a, const void *b) { ... }
+// hmap_put_all_parallel_ex(&map, points, n, 8, point_hash, point_cmp);
+// ```
+//
+// NOTE
+// The map must not be used by other threads while it is being built, and its allocator must be
+// thread safe, as sharded maps grow their shards from the worker threads. Threads are only
+// actually spawned when compiling with EXTLIB_THREADSAFE.
+
+// Hash and comparison functions for the `_ex` variants. Both take pointers to entries
+typedef size_t (*Ext_HmapHashFn)(const void *entry);
+typedef int (*Ext_HmapCmpFn)(const void *a, const void *b);
+
+#define ext_hmap_put_all_parallel(hmap, arr, n, nthreads) \
+    ext_hmap_put_all_parallel_key_(hmap, arr, n, nthreads, ext_hmap_key_bytes_(arr))
+#define ext_hmap_put_all_parallel_cstr(hmap, arr, n, nthreads) \
+    ext_hmap_put_all_parallel_key_(hmap, arr, n, nthreads, ext_hmap_key_cstr_(arr))
+#define ext_hmap_put_all_parallel_ss(hmap, arr, n, nthreads) \
+    ext_hmap_put_all_parallel_key_(hmap, arr, n, nthreads, ext_hmap_key_ss_(arr))
+#define ext_hmap_put_all_parallel_ex(hmap, arr, n, nthreads, hash_fn, cmp_fn) \
+    ext_hmap_put_all_parallel_key_(hmap, arr, n, nthreads, ext_hmap_key_fn_(hash_fn, cmp_fn))
+
+// Inserts all entries of `src` in `dst`. Entries of `src` replace the ones with the same key
+#define ext_hmap_merge_parallel(dst, src, nthreads) \
+    ext_hmap_merge_parallel_key_(dst, src, nthreads, ext_hmap_key_bytes_((src)->entries))
+#define ext_hmap_merge_parallel_cstr(dst, src, nthreads) \
+    ext_hmap_merge_parallel_key_(dst, src, nthreads, ext_hmap_key_cstr_((src)->entries))
+#define ext_hmap_merge_parallel_ss(dst, src, nthreads) \
+    ext_hmap_merge_parallel_key_(dst, src, nthreads, ext_hmap_key_ss_((src)->entries))
+#define ext_hmap_merge_parallel_ex(dst, src, nthreads, hash_fn, cmp_fn) \
+    ext_hmap_merge_parallel_key_(dst, src, nthreads, ext_hmap_key_fn_(hash_fn, cmp_fn))
+
+#define ext_shmap_put_all_parallel(shmap, arr, n, nthreads) \
+    ext_shmap_put_all_parallel_key_(shmap, arr, n, nthreads, ext_hmap_key_bytes_(arr))
+#define ext_shmap_put_all_parallel_cstr(shmap, arr, n, nthreads) \
+    ext_shmap_put_all_parallel_key_(shmap, arr, n, nthreads, ext_hmap_key_cstr_(arr))
+#define ext_shmap_put_all_parallel_ss(shmap, arr, n, nthreads) \
+    ext_shmap_put_all_parallel_key_(shmap, arr, n, nthreads, ext_hmap_key_ss_(arr))
+#define ext_shmap_put_all_parallel_ex(shmap, arr, n, nthreads, hash_fn, cmp_fn) \
+    ext_shmap_put_all_parallel_key_(shmap, arr, n, nthreads, ext_hmap_key_fn_(hash_fn, cmp_fn))
+
+// -----------------------------------------------------------------------------
+// Private parallel hashmap build implementation
+
+// Pointers to the fields of a map. For sharded maps, the ones of the first shard
+typedef struct {
+    void **entries, **hashes;
+    size_t *size, *tombstones, *capacity;
+    Ext_Allocator **allocator;
+} Ext_HmapFields_;
+
+typedef enum {
+    EXT_HMAP_KEY_BYTES_,
+    EXT_HMAP_KEY_CSTR_,
+    EXT_HMAP_KEY_SS_,
+    EXT_HMAP_KEY_FN_,
+} Ext_HmapKeyKind_;
+
+// How to hash and compare entries without knowing their type
+typedef struct {
+    Ext_HmapKeyKind_ kind;
+    size_t offset, size;
+    Ext_HmapHashFn hash;
+    Ext_HmapCmpFn cmp;
+} Ext_HmapKey_;
+
+// Inserts the `n` entries of `arr` in the map(s). If `src_hashes` is not NULL, `arr` is the table
+// of another map, and only the `nvalid` entries whose slot is valid are inserted
+void ext_hmap_build_parallel_(Ext_HmapFields_ maps, size_t nmaps, size_t stride, bool sharded,
+                              size_t entries_sz, size_t hash_sz, const void *arr, size_t n,
+                              size_t nvalid, const void *src_hashes, size_t src_hash_sz,
+                              Ext_HmapKey_ key, size_t nthreads);
+
+#define ext_hmap_fields_(hmap)                                                             \
+    ((Ext_HmapFields_){(void **)&(hmap)->entries, (void **)&(hmap)->hashes, &(hmap)->size, \
+                       &(hmap)->tombstones, &(hmap)->capacity, &(hmap)->allocator})
+
+#define ext_hmap_key_offset_(e) ((size_t)((char *)&(e)->key - (char *)(e)))
+#define ext_hmap_key_bytes_(e) \
+    ((Ext_HmapKey_){EXT_HMAP_KEY_BYTES_, ext_hmap_key_offset_(e), sizeof((e)->key), NULL, NULL})
+#define ext_hmap_key_cstr_(e) \
+    ((Ext_HmapKey_){EXT_HMAP_KEY_CSTR_, ext_hmap_key_offset_(e), sizeof((e)->key), NULL, NULL})
+#define ext_hmap_key_ss_(e) \
+    ((Ext_HmapKey_){EXT_HMAP_KEY_SS_, ext_hmap_key_offset_(e), sizeof((e)->key), NULL, NULL})
+#define ext_hmap_key_fn_(hash_fn, cmp_fn) \
+    ((Ext_HmapKey_){EXT_HMAP_KEY_FN_, 0, 0, hash_fn, cmp_fn})
+
+#define ext_hmap_put_all_parallel_key_(hmap, arr, n, nthreads, key)                            \
+    do {                                                                                       \
+        size_t n_ = (n);                                                                       \
+        if(n_ > 0) {                                                                           \
+            ext_hmap_build_parallel_(ext_hmap_fields_(hmap), 1, 0, false,                      \
+                                     sizeof(*(hmap)->entries), sizeof(*(hmap)->hashes), (arr), \
+                                     n_, n_, NULL, 0, key, nthreads);                          \
+        }                                                                                      \
+    } while(0)
+
+#define ext_hmap_merge_parallel_key_(dst, src, nthreads, key)                                     \
+    do {                                                                                          \
+        if((src)->entries && (src)->size > 0) {                                                   \
+            ext_hmap_build_parallel_(ext_hmap_fields_(dst), 1, 0, false, sizeof(*(dst)->entries), \
+                                     sizeof(*(dst)->hashes), (src)->entries,                      \
+                                     (src)->capacity + 1, (src)->size, (src)->hashes,             \
+                                     sizeof(*(src)->hashes), key, nthreads);                      \
+        }                                                                                         \
+    } while(0)
+
+#define ext_shmap_put_all_parallel_key_(shmap, arr, n, nthreads, key)                       \
+    do {                                                                                    \
+        size_t n_ = (n);                                                                    \
+        EXT_ASSERT((shmap)->shards, "sharded map is not initialized");                      \
+        if(n_ > 0) {                                                                        \
+            ext_hmap_build_parallel_(ext_hmap_fields_(&(shmap)->shards[0].map),             \
+                                     (shmap)->shard_count, sizeof(*(shmap)->shards), true,  \
+                                     sizeof(*(shmap)->shards[0].map.entries),               \
+                                     sizeof(*(shmap)->shards[0].map.hashes), (arr), n_, n_, \
+                                     NULL, 0, key, nthreads);                               \
+        }                                                                                   \
+    } while(0)
+
+#ifdef EXTLIB_IMPL
+// -----------------------------------------------------------------------------
+// SECTION: Logging
+//
+void ext_log(Ext_LogLevel lvl, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    ext_logvf(lvl, fmt, ap);
+    va_end(ap);
+}
+
+void ext_logvf(Ext_LogLevel lvl, const char *fmt, va_list ap) {
+    if(!ext_context->log_fn || lvl == EXT_NO_LOGGING || lvl < ext_context->log_level) return;
+    ext_context->log_fn(lvl, ext_context->log_data, fmt, ap);
+}
+
+#ifndef EXTLIB_NO_STD
+static void ext_default_log(Ext_LogLevel lvl, void *data, const char *fmt, va_list ap) {
+    (void)data;
+    switch(lvl) {
+    case EXT_INFO:
+        fprintf(stdout, "[INFO] ");
+        break;
+    case EXT_WARNING:
+        fprintf(stdout, "[WARNING] ");
+        break;
+    case EXT_ERROR:
+        fprintf(stderr, "[ERROR] ");
+        break;
+    case EXT_NO_LOGGING:
+        EXT_UNREACHABLE();
+    }
+    vfprintf(lvl == EXT_ERROR ? stderr : stdout, fmt, ap);
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// SECTION: Context
+//
+EXT_TLS Ext_Context *ext_context = &(Ext_Context){
+    .alloc = &ext_default_allocator.base,
+    .log_level = EXT_INFO,
+    .log_data = NULL,
+#ifndef EXTLIB_NO_STD
+    .log_fn = &ext_default_log,
+#else
+    .log_fn = NULL,
+#endif
+};
+
+void ext_push_context(Ext_Context *ctx) {
+    ctx->prev = ext_context;
+    ext_context = ctx;
+}
+
+Ext_Context *ext_pop_context(void) {
+    EXT_ASSERT(ext_context->prev, "Trying to pop default allocator");
+    Ext_Context *old_ctx = ext_context;
+    ext_context = old_ctx->prev;
+    return old_ctx;
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Mutex
+//
+#if defined(EXT_MUTEX_PTHREAD)
+void ext_mutex_init(Ext_Mutex *m) {
+    int res = pthread_mutex_init(&m->handle, NULL);
+    EXT_ASSERT(res == 0, "couldn't initialize mutex");
+}
+
+void ext_mutex_destroy(Ext_Mutex *m) {
+    pthread_mutex_destroy(&m->handle);
+}
+
+void ext_mutex_lock(Ext_Mutex *m) {
+    int res = pthread_mutex_lock(&m->handle);
+    EXT_ASSERT(res == 0, "couldn't lock mutex");
+}
+
+void ext_mutex_unlock(Ext_Mutex *m) {
+    int res = pthread_mutex_unlock(&m->handle);
+    EXT_ASSERT(res == 0, "couldn't unlock mutex");
+}
+#elif defined(EXT_MUTEX_C11)
+void ext_mutex_init(Ext_Mutex *m) {
+    int res = mtx_init(&m->handle, mtx_plain);
+    EXT_ASSERT(res == thrd_success, "couldn't initialize mutex");
+}
+
+void ext_mutex_destroy(Ext_Mutex *m) {
+    mtx_destroy(&m->handle);
+}
+
+void ext_mutex_lock(Ext_Mutex *m) {
+    int res = mtx_lock(&m->handle);
+    EXT_ASSERT(res == thrd_success, "couldn't lock mutex");
+}
+
+void ext_mutex_unlock(Ext_Mutex *m) {
+    int res = mtx_unlock(&m->handle);
+    EXT_ASSERT(res == thrd_success, "couldn't unlock mutex");
+}
+#else
+void ext_mutex_init(Ext_Mutex *m) {
+    (void)m;
+}
+
+void ext_mutex_destroy(Ext_Mutex *m) {
+    (void)m;
+}
+
+void ext_mutex_lock(Ext_Mutex *m) {
+    (void)m;
+}
+
+void ext_mutex_unlock(Ext_Mutex *m) {
+    (void)m;
+}
+#endif  // defined(EXT_MUTEX_PTHREAD)
+
+// -----------------------------------------------------------------------------
+// SECTION: Threads
+//
+#if defined(EXT_MUTEX_PTHREAD)
+static void *ext_thread_start_(void *arg) {
+    Ext_Thread *t = arg;
+    t->fn(t->arg);
+    return NULL;
+}
+
+void ext_thread_create(Ext_Thread *t, Ext_ThreadFn fn, void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    int res = pthread_create(&t->handle, NULL, ext_thread_start_, t);
+    EXT_ASSERT(res == 0, "couldn't create thread");
+}
+
+void ext_thread_join(Ext_Thread *t) {
+    int res = pthread_join(t->handle, NULL);
+    EXT_ASSERT(res == 0, "couldn't join thread");
+}
+#elif defined(EXT_MUTEX_C11)
+static int ext_thread_start_(void *arg) {
+    Ext_Thread *t = arg;
+    t->fn(t->arg);
+    return 0;
+}
+
+void ext_thread_create(Ext_Thread *t, Ext_ThreadFn fn, void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    int res = thrd_create(&t->handle, ext_thread_start_, t);
+    EXT_ASSERT(res == thrd_success, "couldn't create thread");
+}
+
+void ext_thread_join(Ext_Thread *t) {
+    int res = thrd_join(t->handle, NULL);
+    EXT_ASSERT(res == thrd_success, "couldn't join thread");
+}
+#else
+void ext_thread_create(Ext_Thread *t, Ext_ThreadFn fn, void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    fn(arg);
+}
+
+void ext_thread_join(Ext_Thread *t) {
+    (void)t;
+}
+#endif  // defined(EXT_MUTEX_PTHREAD)
+
+// -----------------------------------------------------------------------------
+// SECTION: Allocators
+//
+
+
+void* ext_alloc(size_t size) {
+    return ext_context->alloc->alloc(ext_context->alloc, size);
+}
+
+void* ext_realloc(void* ptr, size_t old_sz, size_t new_sz) {
+    return ext_context->alloc->realloc(ext_context->alloc, ptr, old_sz, new_sz);
+}
+
+void ext_free(void* ptr, size_t size) {
+    return ext_context->alloc->free(ext_context->alloc, ptr, size);
+}
+
+char *ext_strdup(const char *s) {
+    return ext_strdup_alloc(s, ext_context->alloc);
+}
+
+void *ext_memdup(const void *mem, size_t size) {
+    return ext_memdup_alloc(mem, size, ext_context->alloc);
+}
+
+char *ext_strdup_alloc(const char *s, Ext_Allocator *a) {
+    size_t len = strlen(s);
+    char *res = a->alloc(a, len + 1);
+    memcpy(res, s, len);
+    res[len] = '\0';
+    return res;
+}
+
+void *ext_memdup_alloc(const void *mem, size_t size, Ext_Allocator *a) {
+    void *res = a->alloc(a, size);
+    memcpy(res, mem, size);
+    return res;
+}
+
+#ifdef EXTLIB_WASM
+extern char __heap_base[];
+static void *ext_heap_start = (void *)__heap_base;
+#endif  // EXTLIB_WASM
+
+#ifndef EXT_DEFAULT_ALIGNMENT
+#define EXT_DEFAULT_ALIGNMENT (16)
+#endif  // EXT_DEFAULT_ALIGNMENT
+EXT_STATIC_ASSERT(((EXT_DEFAULT_ALIGNMENT) & ((EXT_DEFAULT_ALIGNMENT)-1)) == 0,
+                  "default alignment must be a power of 2");
+
+#ifndef EXT_DEFAULT_TEMP_SIZE
+#define EXT_DEFAULT_TEMP_SIZE (8 * 1024 * 1024)
+#endif
+
+static void *ext_default_alloc(Ext_Allocator *a, size_t size) {
+    (void)a;
+#ifndef EXTLIB_NO_STD
+    void *mem = malloc(size);
+    EXT_ASSERT(mem, "out of memory");
+    return mem;
+#elif defined(EXTLIB_WASM)
+    size += EXT_ALIGN(size, EXT_DEFAULT_ALIGNMENT);
+    char* mem_end = (char *)(__builtin_wasm_memory_size(0) << 16);
+    if((char*)ext_heap_start + size > mem_end) {
+        size_t pages = (size + 0xFFFFU) >> 16;  // round up
+        ext_heap_start = (void*)__builtin_wasm_memory_grow(0, pages);
+    }
+    void *mem = ext_heap_start;
+    ext_heap_start = (char *)ext_heap_start + size;
+    return mem;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+static void *ext_default_realloc(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+#ifndef EXTLIB_NO_STD
+    (void)a;
+    (void)old_size;
+    void *mem = realloc(ptr, new_size);
+    EXT_ASSERT(mem, "out of memory");
+    return mem;
+#elif defined EXTLIB_WASM
+    void *mem = ext_default_alloc(a, new_size);
+    memcpy(mem, ptr, old_size);
+    return mem;
+#else
+    (void)ptr;
+    (void)new_size;
+    return NULL
+#endif
+}
+
+static void ext_default_free(Ext_Allocator *a, void *ptr, size_t size) {
+    (void)a;
+    (void)size;
+#ifndef EXTLIB_NO_STD
+    free(ptr);
+#else
+    (void)ptr;
+#endif
+}
+
+Ext_DefaultAllocator ext_default_allocator = {
+    {
+        .alloc = ext_default_alloc,
+        .realloc = ext_default_realloc,
+        .free = ext_default_free,
+    },
+};
+
+static void *ext_temp_alloc_wrap(Ext_Allocator *a, size_t size);
+static void *ext_temp_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size);
+static void ext_temp_free_wrap(Ext_Allocator *a, void *ptr, size_t size);
+
+static char ext_temp_mem[EXT_DEFAULT_TEMP_SIZE];
+EXT_TLS Ext_TempAllocator ext_temp_allocator = {
+    {
+        .alloc = ext_temp_alloc_wrap,
+        .realloc = ext_temp_realloc_wrap,
+        .free = ext_temp_free_wrap,
+        .flags = EXT_ALLOCATOR_LIFO,
+    },
+    .start = ext_temp_mem,
+    .end = ext_temp_mem + EXT_DEFAULT_TEMP_SIZE,
+    .mem_size = EXT_DEFAULT_TEMP_SIZE,
+    .mem = ext_temp_mem,
+};
+
+static void *ext_temp_alloc_wrap(Ext_Allocator *a, size_t size) {
+    (void)a;
+    return ext_temp_alloc(size);
+}
+
+static void *ext_temp_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    (void)a;
+    return ext_temp_realloc(ptr, old_size, new_size);
+}
+
+static void ext_temp_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    (void)a;
+    (void)ptr;
+    (void)size;
+    // No-op, temp allocator does not free memory
+}
+
+void ext_temp_set_mem(void *mem, size_t size) {
+    ext_temp_allocator.mem_size = size;
+    ext_temp_allocator.mem = mem;
+    ext_temp_reset();
+}
+
+void *ext_temp_alloc(size_t size) {
+    size_t alignment = EXT_ALIGN(size, EXT_DEFAULT_ALIGNMENT);
+    intptr_t available = ext_temp_allocator.end - ext_temp_allocator.start - alignment;
+    if(available < (intptr_t)size) {
+#ifndef EXTLIB_NO_STD
+        ext_log(EXT_ERROR,
+                "%s:%d: temp allocation failed: %zu bytes requested, %zd bytes "
+                "available\n",
+                __FILE__, __LINE__, size, available < 0 ? 0 : available);
+        abort();
+#else
+        EXT_ASSERT(false, "temp allocation failed");
+#endif
+    }
+    void *p = ext_temp_allocator.start;
+    ext_temp_allocator.start += size + alignment;
+    return p;
+}
+
+void *ext_temp_realloc(void *ptr, size_t old_size, size_t new_size) {
+    ptrdiff_t alignment = EXT_ALIGN(old_size, EXT_DEFAULT_ALIGNMENT);
+    // Reallocating last allocated memory, can grow/shrink in-place
+    if(ext_temp_allocator.start - old_size - alignment == ptr) {
+        ext_temp_allocator.start -= old_size + alignment;
+        return ext_temp_alloc(new_size);
+    } else if(new_size > old_size) {
+        void *new_ptr = ext_temp_alloc(new_size);
+        memcpy(new_ptr, ptr, old_size);
+        return new_ptr;
+    } else {
+        return ptr;
+    }
+}
+
+size_t ext_temp_available(void) {
+    return ext_temp_allocator.end - ext_temp_allocator.start;
+}
+
+void ext_temp_reset(void) {
+    ext_temp_allocator.start = ext_temp_allocator.mem;
+    ext_temp_allocator.end = (char *)ext_temp_allocator.mem + ext_temp_allocator.mem_size;
+}
+
+void *ext_temp_checkpoint(void) {
+    return ext_temp_allocator.start;
+}
+
+void ext_temp_rewind(void *checkpoint) {
+    ext_temp_allocator.start = checkpoint;
+}
+
+char *ext_temp_strdup(const char *s) {
+    return ext_strdup_alloc(s, &ext_temp_allocator.base);
+}
+
+void *ext_temp_memdup(void *mem, size_t size) {
+    return ext_memdup_alloc(mem, size, &ext_temp_allocator.base);
+}
+
+#ifndef EXTLIB_NO_STD
+char *ext_temp_sprintf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char *res = ext_temp_vsprintf(fmt, ap);
+    va_end(ap);
+    return res;
+}
+
+char *ext_temp_vsprintf(const char *fmt, va_list ap) {
+    va_list cpy;
+    va_copy(cpy, ap);
+    int n = vsnprintf(NULL, 0, fmt, cpy);
+    va_end(cpy);
+
+    EXT_ASSERT(n >= 0, "error in vsnprintf");
+    char *res = ext_temp_alloc(n + 1);
+
+    va_copy(cpy, ap);
+    vsnprintf(res, n + 1, fmt, cpy);
+    va_end(cpy);
+
+    return res;
+}
+#endif  // EXTLIB_NO_STD
+
+// -----------------------------------------------------------------------------
+// SECTION: Arena allocator
+//
+#ifndef EXT_ARENA_PAGE_SZ
+#define EXT_ARENA_PAGE_SZ (8 * 1024)  // 8 KiB
+#endif                                // EXT_ARENA_PAGE_SZ
+
+#if defined(EXT_POSIX) && !defined(EXTLIB_NO_STD)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define EXT_ARENA_VM_
+#endif
+
+#ifdef EXT_ARENA_VM_
+// Default size of the virtual range reserved by an arena with `EXT_ARENA_VIRTUAL`
+#ifndef EXT_ARENA_VM_RESERVE
+#if SIZE_MAX > UINT32_MAX
+#define EXT_ARENA_VM_RESERVE ((size_t)16 * 1024 * 1024 * 1024)  // 16 GiB
+#else
+#define EXT_ARENA_VM_RESERVE ((size_t)256 * 1024 * 1024)  // 256 MiB
+#endif
+#endif  // EXT_ARENA_VM_RESERVE
+
+// Minimum amount of memory committed at once by an arena with `EXT_ARENA_VIRTUAL`. Must be a power
+// of 2. The actual granularity is never smaller than the OS page size
+#ifndef EXT_ARENA_VM_COMMIT_SZ
+#define EXT_ARENA_VM_COMMIT_SZ (64 * 1024)  // 64 KiB
+#endif                                      // EXT_ARENA_VM_COMMIT_SZ
+
+static size_t ext_arena_vm_granularity_(void) {
+    size_t os_page = (size_t)sysconf(_SC_PAGESIZE);
+    return os_page > EXT_ARENA_VM_COMMIT_SZ ? os_page : EXT_ARENA_VM_COMMIT_SZ;
+}
+
+// Maps `size` bytes of inaccessible memory. If `addr` is not NULL, the new mapping replaces the
+// pages at `addr`, returning them to the OS
+static void *ext_arena_vm_map_(void *addr, size_t size) {
+    int flags = MAP_PRIVATE | (addr ? MAP_FIXED : 0);
+#ifdef MAP_ANONYMOUS
+    void *p = mmap(addr, size, PROT_NONE, flags | MAP_ANONYMOUS, -1, 0);
+#else
+    // Strict ISO C builds hide MAP_ANONYMOUS, a private mapping of /dev/zero is equivalent
+    int fd = open("/dev/zero", O_RDWR);
+    if(fd < 0) return NULL;
+    void *p = mmap(addr, size, PROT_NONE, flags, fd, 0);
+    close(fd);
+#endif
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// Commits the memory between `commit_end` and at least `required_end`, without going past
+// `reserve_end`. Returns the new end of the committed memory, or NULL on failure
+static char *ext_arena_vm_commit_(char *commit_end, char *reserve_end, char *required_end) {
+    if(required_end > reserve_end) return NULL;
+    size_t granularity = ext_arena_vm_granularity_();
+    size_t size = required_end - commit_end;
+    size += EXT_ALIGN(size, granularity);
+    if(size > (size_t)(reserve_end - commit_end)) size = reserve_end - commit_end;
+    if(mprotect(commit_end, size, PROT_READ | PROT_WRITE) != 0) return NULL;
+    return commit_end + size;
+}
+
+// Decommits the memory of the page past its current start
+static void ext_arena_vm_decommit_(Ext_ArenaPage *page) {
+    size_t granularity = ext_arena_vm_granularity_();
+    char *from = page->start + EXT_ALIGN(page->start, granularity);
+    if(from >= page->end) return;
+    void *res = ext_arena_vm_map_(from, page->end - from);
+    EXT_ASSERT(res == from, "failed to decommit arena memory");
+    (void)res;
+    page->end = from;
+}
+
+static Ext_ArenaPage *ext_arena_vm_new_page_(Ext_Arena *arena, size_t header_sz,
+                                             size_t requested_size) {
+    char *base = ext_arena_vm_map_(NULL, arena->page_size);
+    EXT_ASSERT(base, "failed to reserve arena memory");
+    char *end = ext_arena_vm_commit_(base, base + arena->page_size,
+                                     base + header_sz + requested_size);
+    EXT_ASSERT(end, "requested size exceeds the arena reserved size");
+    Ext_ArenaPage *page = (Ext_ArenaPage *)base;
+    page->next = NULL;
+    page->start = page->data + EXT_ALIGN(page->data, arena->alignment);
+    page->end = end;
+    return page;
+}
+#endif  // EXT_ARENA_VM_
+
+static Ext_ArenaPage *ext_arena_new_page(Ext_Arena *arena, size_t requested_size) {
+    size_t header_sz = sizeof(Ext_ArenaPage) + EXT_ALIGN(sizeof(Ext_ArenaPage), arena->alignment);
+    size_t actual_size = requested_size + header_sz;
+
+#ifdef EXT_ARENA_VM_
+    if(arena->flags & EXT_ARENA_VIRTUAL) {
+        return ext_arena_vm_new_page_(arena, header_sz, requested_size);
+    }
+#endif
+
+    size_t page_size = arena->page_size;
+    if(actual_size > page_size) {
+        if(arena->flags & EXT_ARENA_FLEXIBLE_PAGE) {
+            // TODO: maybe put flexible pages on another linked list?
+            // this way we risk wasting space in pages coming before it in the linked list.
+            page_size = actual_size;
+        } else {
+#ifndef EXTLIB_NO_STD
+            ext_log(EXT_ERROR,
+                    "Error: requested size %zu exceeds max allocatable size in page "
+                    "(%zu)\n",
+                    requested_size, arena->page_size - header_sz);
+            abort();
+#else
+            EXT_ASSERT(false, "reuqested size exceeds max allocatable size in page");
+#endif
+        }
+    }
+
+    Ext_ArenaPage *page = arena->page_allocator->alloc(arena->page_allocator, page_size);
+    EXT_ASSERT(page, "out of memory");
+    page->next = NULL;
+    // Account for alignment of first allocation; the arena assumes every pointer
+    // starts aligned to the arena's alignment.
+    page->start = page->data + EXT_ALIGN(page->data, arena->alignment);
+    page->end = (char *)page + page_size;
+    return page;
+}
+
+static void *ext_arena_alloc_wrap(Ext_Allocator *a, size_t size) {
+    return ext_arena_alloc((Ext_Arena *)a, size);
+}
+
+static void *ext_arena_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    return ext_arena_realloc((Ext_Arena *)a, ptr, old_size, new_size);
+}
+
+static void ext_arena_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    ext_arena_free((Ext_Arena *)a, ptr, size);
+}
+
+Ext_Arena ext_new_arena(Ext_Allocator *page_alloc, size_t alignment, size_t page_size,
+                        Ext_ArenaFlags flags) {
+    if(!alignment) alignment = EXT_DEFAULT_ALIGNMENT;
+#ifdef EXT_ARENA_VM_
+    if(flags & EXT_ARENA_VIRTUAL) {
+        if(!page_size) page_size = EXT_ARENA_VM_RESERVE;
+        size_t granularity = ext_arena_vm_granularity_();
+        page_size += EXT_ALIGN(page_size, granularity);
+    }
+#else
+    flags &= ~(EXT_ARENA_VIRTUAL | EXT_ARENA_DECOMMIT);
+#endif
+    if(!page_size) page_size = EXT_ARENA_PAGE_SZ;
+    EXT_ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
+    EXT_ASSERT(page_size > sizeof(Ext_ArenaPage) + EXT_ALIGN(sizeof(Ext_ArenaPage), alignment),
+               "Page size must be greater the size of Ext_ArenaPage + alignment bytes");
+    return (Ext_Arena){
+        .base = {
+            .alloc = ext_arena_alloc_wrap,
+            .realloc = ext_arena_realloc_wrap,
+            .free = ext_arena_free_wrap,
+            .flags = EXT_ALLOCATOR_LIFO,
+        },
+        .alignment = alignment,
+        .page_size = page_size,
+        .page_allocator = page_alloc ? page_alloc : ext_context->alloc,
+        .flags = flags,
+    };
+}
+
+void *ext_arena_alloc(Ext_Arena *a, size_t size) {
+    Ext_Arena *arena = (Ext_Arena *)a;
+    size += EXT_ALIGN(size, arena->alignment);
+
+    if(!arena->last_page) {
+        EXT_ASSERT(arena->first_page == NULL && arena->allocated == 0,
+                   "should be first allocation");
+        Ext_ArenaPage *page = ext_arena_new_page(arena, size);
+        arena->first_page = page;
+        arena->last_page = page;
+    }
+
+    intptr_t available = arena->last_page->end - arena->last_page->start;
+    while(available < (intptr_t)size) {
+#ifdef EXT_ARENA_VM_
+        if(arena->flags & EXT_ARENA_VIRTUAL) {
+            // Single contiguous page, commit more of the reserved range
+            Ext_ArenaPage *page = arena->last_page;
+            char *end = ext_arena_vm_commit_(page->end, (char *)page + arena->page_size,
+                                             page->start + size);
+            if(!end) {
+                ext_log(EXT_ERROR,
+                        "Error: requested size %zu exceeds the arena reserved size (%zu)\n",
+                        size, arena->page_size);
+                abort();
+            }
+            page->end = end;
+            available = page->end - page->start;
+            break;
+        }
+#endif
+        Ext_ArenaPage *next_page = arena->last_page->next;
+        if(!next_page) {
+            arena->last_page->next = ext_arena_new_page(arena, size);
+            arena->last_page = arena->last_page->next;
+            available = arena->last_page->end - arena->last_page->start;
+            break;
+        } else {
+            arena->last_page = next_page;
+            available = next_page->end - next_page->start;
+        }
+    }
+
+    EXT_ASSERT(available >= (intptr_t)size, "Not enough space in arena");
+
+    void *p = arena->last_page->start;
+    EXT_ASSERT(EXT_ALIGN(p, arena->alignment) == 0,
+               "Pointer is not aligned to the arena's alignment");
+    arena->last_page->start += size;
+    arena->allocated += size;
+
+    if(arena->flags & EXT_ARENA_ZERO_ALLOC) {
+        memset(p, 0, size);
+    }
+
+    return p;
+}
+
+void *ext_arena_realloc(Ext_Arena *a, void *ptr, size_t old_size, size_t new_size) {
+    Ext_Arena *arena = (Ext_Arena *)a;
+    EXT_ASSERT(EXT_ALIGN(ptr, arena->alignment) == 0,
+               "ptr is not aligned to the arena's alignment");
+
+    Ext_ArenaPage *page = arena->last_page;
+    EXT_ASSERT(page, "No pages in arena");
+
+    size_t alignment = EXT_ALIGN(old_size, arena->alignment);
+    if(page->start - old_size - alignment == ptr) {
+        // Reallocating last allocated memory, can grow/shrink in-place
+        page->start -= old_size + alignment;
+        arena->allocated -= old_size + alignment;
+        void *new_ptr = ext_arena_alloc(a, new_size);
+        if(new_ptr != ptr) {
+            memcpy(new_ptr, ptr, old_size);
+        }
+        return new_ptr;
+    } else if(new_size > old_size) {
+        void *new_ptr = ext_arena_alloc(a, new_size);
+        memcpy(new_ptr, ptr, old_size);
+        return new_ptr;
+    } else {
+        return ptr;
+    }
+}
+
+void ext_arena_free(Ext_Arena *a, void *ptr, size_t size) {
+    Ext_Arena *arena = (Ext_Arena *)a;
+    EXT_ASSERT(EXT_ALIGN(ptr, arena->alignment) == 0,
+               "ptr is not aligned to the arena's alignment");
+
+    Ext_ArenaPage *page = arena->last_page;
+    EXT_ASSERT(page, "No pages in arena");
+
+    size_t alignment = EXT_ALIGN(size, arena->alignment);
+    if(page->start - size - alignment == ptr) {
+        // Deallocating last allocated memory, can shrink in-place
+        page->start -= size + alignment;
+        arena->allocated -= size + alignment;
+        return;
+    }
+
+    // In stack allocator mode force LIFO order
+    if(arena->flags & EXT_ARENA_STACK_ALLOC) {
+#ifndef EXTLIB_NO_STD
+        ext_log(EXT_ERROR, "Deallocating memory in non-LIFO order: got %p, expected %p\n", ptr,
+                (void *)(page->start - size - alignment));
+        abort();
+#else
+        EXT_ASSERT(false, "Deallocating memory in non-LIFO order");
+#endif
+    }
+}
+
+Ext_ArenaCheckpoint ext_arena_checkpoint(const Ext_Arena *a) {
+    if(!a->last_page) {
+        EXT_ASSERT(a->first_page == NULL, "arena should be empty");
+        return (Ext_ArenaCheckpoint){0};
+    } else {
+        return (Ext_ArenaCheckpoint){
+            a->last_page,
+            a->last_page->start,
+            a->allocated,
+        };
+    }
+}
+
+void ext_arena_rewind(Ext_Arena *a, Ext_ArenaCheckpoint checkpoint) {
+    if(!checkpoint.page) {
+        ext_arena_reset(a);
+        return;
+    }
+    checkpoint.page->start = checkpoint.page_start;
+    Ext_ArenaPage *page = checkpoint.page->next;
+    while(page) {
+        page->start = page->data + EXT_ALIGN(page->data, a->alignment);
+        page = page->next;
+    }
+    a->last_page = checkpoint.page;
+    a->allocated = checkpoint.allocated;
+#ifdef EXT_ARENA_VM_
+    if((a->flags & EXT_ARENA_VIRTUAL) && (a->flags & EXT_ARENA_DECOMMIT)) {
+        ext_arena_vm_decommit_(checkpoint.page);
+    }
+#endif
+}
+
+void ext_arena_reset(Ext_Arena *a) {
+    Ext_ArenaPage *page = a->first_page;
+    while(page) {
+        page->start = page->data + EXT_ALIGN(page->data, a->alignment);
+        page = page->next;
+    }
+    a->last_page = a->first_page;
+    a->allocated = 0;
+#ifdef EXT_ARENA_VM_
+    if(a->first_page && (a->flags & EXT_ARENA_VIRTUAL) && (a->flags & EXT_ARENA_DECOMMIT)) {
+        ext_arena_vm_decommit_(a->first_page);
+    }
+#endif
+}
+
+void ext_arena_destroy(Ext_Arena *a) {
+    Ext_ArenaPage *page = a->first_page;
+#ifdef EXT_ARENA_VM_
+    if(page && (a->flags & EXT_ARENA_VIRTUAL)) {
+        munmap(page, a->page_size);
+        page = NULL;
+    }
+#endif
+    while(page) {
+        Ext_ArenaPage *next = page->next;
+        a->page_allocator->free(a->page_allocator, page, page->end - (char *)page);
+        page = next;
+    }
+    a->first_page = NULL;
+    a->last_page = NULL;
+    a->allocated = 0;
+}
+
+char *ext_arena_strdup(Ext_Arena *a, const char *str) {
+    return ext_strdup_alloc(str, &a->base);
+}
+
+void *ext_arena_memdup(Ext_Arena *a, const void *mem, size_t size) {
+    return ext_memdup_alloc(mem, size, &a->base);
+}
+
+#ifndef EXTLIB_NO_STD
+char *ext_arena_sprintf(Ext_Arena *a, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    char *res = ext_arena_vsprintf(a, fmt, ap);
+    va_end(ap);
+    return res;
+}
+
+char *ext_arena_vsprintf(Ext_Arena *a, const char *fmt, va_list ap) {
+    va_list cpy;
+    va_copy(cpy, ap);
+    int n = vsnprintf(NULL, 0, fmt, cpy);
+    va_end(cpy);
+
+    EXT_ASSERT(n >= 0, "error in vsnprintf");
+    char *res = ext_arena_alloc(a, n + 1);
+
+    va_copy(cpy, ap);
+    vsnprintf(res, n + 1, fmt, cpy);
+    va_end(cpy);
+
+    return res;
+}
+#endif  // EXTLIB_NO_STD
+
+// -----------------------------------------------------------------------------
+// SECTION: Concurrent arena
+//
+#if defined(EXTLIB_THREADSAFE) && (defined(__GNUC__) || defined(__clang__))
+#define EXT_ATOMIC_GNUC_
+#elif defined(EXTLIB_THREADSAFE)
+#warning "atomics are not supported on this compiler. The concurrent arena is not thread safe."
+#endif
+
+static inline void *ext_atomic_load_ptr_(void **p) {
+#ifdef EXT_ATOMIC_GNUC_
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return *p;
+#endif
+}
+
+static inline size_t ext_atomic_fetch_add_(size_t *p, size_t v) {
+#ifdef EXT_ATOMIC_GNUC_
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#else
+    size_t old = *p;
+    *p += v;
+    return old;
+#endif
+}
+
+static inline bool ext_atomic_cas_size_(size_t *p, size_t *expected, size_t desired) {
+#ifdef EXT_ATOMIC_GNUC_
+    return __atomic_compare_exchange_n(p, expected, desired, false, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED);
+#else
+    if(*p != *expected) {
+        *expected = *p;
+        return false;
+    }
+    *p = desired;
+    return true;
+#endif
+}
+
+// Publishes `desired`, making the writes to the memory it points to visible to the threads that
+// load it
+static inline bool ext_atomic_cas_ptr_(void **p, void **expected, void *desired) {
+#ifdef EXT_ATOMIC_GNUC_
+    return __atomic_compare_exchange_n(p, expected, desired, false, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_ACQUIRE);
+#else
+    if(*p != *expected) {
+        *expected = *p;
+        return false;
+    }
+    *p = desired;
+    return true;
+#endif
+}
+
+static size_t ext_concurrent_arena_page_size_(Ext_ConcurrentArena *a, size_t capacity) {
+    return sizeof(Ext_ConcurrentArenaPage) + a->alignment + capacity;
+}
+
+// Allocates a page that fits at least `size` bytes, with the first `size` bytes already taken
+static Ext_ConcurrentArenaPage *ext_concurrent_arena_new_page_(Ext_ConcurrentArena *a,
+                                                               size_t size) {
+    size_t capacity = size > a->page_size ? size : a->page_size;
+    Ext_ConcurrentArenaPage *page = a->page_allocator->alloc(
+        a->page_allocator, ext_concurrent_arena_page_size_(a, capacity));
+    EXT_ASSERT(page, "out of memory");
+    char *data = (char *)(page + 1);
+    page->next = NULL;
+    page->start = data + EXT_ALIGN(data, a->alignment);
+    page->offset = size;
+    page->capacity = capacity;
+    return page;
+}
+
+static void ext_concurrent_arena_free_page_(Ext_ConcurrentArena *a,
+                                            Ext_ConcurrentArenaPage *page) {
+    a->page_allocator->free(a->page_allocator, page,
+                            ext_concurrent_arena_page_size_(a, page->capacity));
+}
+
+static void *ext_concurrent_arena_alloc_wrap(Ext_Allocator *a, size_t size) {
+    return ext_concurrent_arena_alloc((Ext_ConcurrentArena *)a, size);
+}
+
+static void *ext_concurrent_arena_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size,
+                                               size_t new_size) {
+    return ext_concurrent_arena_realloc((Ext_ConcurrentArena *)a, ptr, old_size, new_size);
+}
+
+static void ext_concurrent_arena_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    ext_concurrent_arena_free((Ext_ConcurrentArena *)a, ptr, size);
+}
+
+Ext_ConcurrentArena ext_new_concurrent_arena(Ext_Allocator *page_alloc, size_t alignment,
+                                             size_t page_size) {
+    if(!alignment) alignment = EXT_DEFAULT_ALIGNMENT;
+    if(!page_size) page_size = EXT_ARENA_PAGE_SZ;
+    EXT_ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
+    return (Ext_ConcurrentArena){
+        .base = {
+            .alloc = ext_concurrent_arena_alloc_wrap,
+            .realloc = ext_concurrent_arena_realloc_wrap,
+            .free = ext_concurrent_arena_free_wrap,
+            .flags = EXT_ALLOCATOR_LIFO,
+        },
+        .alignment = alignment,
+        .page_size = page_size,
+        .page_allocator = page_alloc ? page_alloc : ext_context->alloc,
+    };
+}
+
+void *ext_concurrent_arena_alloc(Ext_ConcurrentArena *a, size_t size) {
+    size += EXT_ALIGN(size, a->alignment);
+
+    if(size > a->page_size) {
+        // Large allocations get their own page, so that they don't waste the current one
+        Ext_ConcurrentArenaPage *page = ext_concurrent_arena_new_page_(a, size);
+        page->next = ext_atomic_load_ptr_((void **)&a->large_pages);
+        while(!ext_atomic_cas_ptr_((void **)&a->large_pages, (void **)&page->next, page)) {
+        }
+        ext_atomic_fetch_add_(&a->allocated, size);
+        return page->start;
+    }
+
+    Ext_ConcurrentArenaPage *page = ext_atomic_load_ptr_((void **)&a->page);
+    for(;;) {
+        if(page) {
+            // Fast path: bump the offset of the current page. A failed bump leaves the offset past
+            // the capacity, so that all subsequent bumps on the page fail as well
+            size_t offset = ext_atomic_fetch_add_(&page->offset, size);
+            if(offset + size <= page->capacity) {
+                ext_atomic_fetch_add_(&a->allocated, size);
+                return page->start + offset;
+            }
+        }
+
+        // Slow path: the page is full, try to install a new one
+        Ext_ConcurrentArenaPage *new_page = ext_concurrent_arena_new_page_(a, size);
+        new_page->next = page;
+        if(ext_atomic_cas_ptr_((void **)&a->page, (void **)&page, new_page)) {
+            ext_atomic_fetch_add_(&a->allocated, size);
+            return new_page->start;
+        }
+        // Another thread installed a page first, `page` now holds it
+        ext_concurrent_arena_free_page_(a, new_page);
+    }
+}
+
+// Tries to resize `ptr` in-place, from `old_size` to `new_size` bytes (both already aligned)
+static bool ext_concurrent_arena_resize_(Ext_ConcurrentArena *a, void *ptr, size_t old_size,
+                                         size_t new_size) {
+    Ext_ConcurrentArenaPage *page = ext_atomic_load_ptr_((void **)&a->page);
+    if(!page || (char *)ptr < page->start) return false;
+    size_t offset = (size_t)((char *)ptr - page->start);
+    if(offset >= page->capacity || offset + new_size > page->capacity) return false;
+    size_t expected = offset + old_size;
+    if(!ext_atomic_cas_size_(&page->offset, &expected, offset + new_size)) return false;
+    if(new_size > old_size) {
+        ext_atomic_fetch_add_(&a->allocated, new_size - old_size);
+    } else {
+        ext_atomic_fetch_add_(&a->allocated, -(old_size - new_size));
+    }
+    return true;
+}
+
+void *ext_concurrent_arena_realloc(Ext_ConcurrentArena *a, void *ptr, size_t old_size,
+                                   size_t new_size) {
+    EXT_ASSERT(EXT_ALIGN(ptr, a->alignment) == 0, "ptr is not aligned to the arena's alignment");
+    size_t old_aligned = old_size + EXT_ALIGN(old_size, a->alignment);
+    size_t new_aligned = new_size + EXT_ALIGN(new_size, a->alignment);
+    if(ext_concurrent_arena_resize_(a, ptr, old_aligned, new_aligned)) {
+        return ptr;
+    } else if(new_size > old_size) {
+        void *new_ptr = ext_concurrent_arena_alloc(a, new_size);
+        memcpy(new_ptr, ptr, old_size);
+        return new_ptr;
+    } else {
+        return ptr;
+    }
+}
+
+void ext_concurrent_arena_free(Ext_ConcurrentArena *a, void *ptr, size_t size) {
+    EXT_ASSERT(EXT_ALIGN(ptr, a->alignment) == 0, "ptr is not aligned to the arena's alignment");
+    ext_concurrent_arena_resize_(a, ptr, size + EXT_ALIGN(size, a->alignment), 0);
+}
+
+void ext_concurrent_arena_reset(Ext_ConcurrentArena *a) {
+    Ext_ConcurrentArenaPage *page = a->page;
+    if(page) {
+        Ext_ConcurrentArenaPage *full = page->next;
+        while(full) {
+            Ext_ConcurrentArenaPage *next = full->next;
+            ext_concurrent_arena_free_page_(a, full);
+            full = next;
+        }
+        page->next = NULL;
+        page->offset = 0;
+    }
+    Ext_ConcurrentArenaPage *large = a->large_pages;
+    while(large) {
+        Ext_ConcurrentArenaPage *next = large->next;
+        ext_concurrent_arena_free_page_(a, large);
+        large = next;
+    }
+    a->large_pages = NULL;
+    a->allocated = 0;
+}
+
+void ext_concurrent_arena_destroy(Ext_ConcurrentArena *a) {
+    ext_concurrent_arena_reset(a);
+    if(a->page) {
+        ext_concurrent_arena_free_page_(a, a->page);
+        a->page = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Pool allocator
+//
+#ifndef EXT_POOL_SLAB_SZ
+#define EXT_POOL_SLAB_SZ (64 * 1024)  // 64 KiB
+#endif                                // EXT_POOL_SLAB_SZ
+
+static size_t ext_pool_slab_size_(const Ext_Pool *p) {
+    return sizeof(Ext_PoolSlab) + p->alignment + p->slab_objects * p->object_size;
+}
+
+static char *ext_pool_slab_objects_(const Ext_Pool *p, Ext_PoolSlab *slab) {
+    char *data = (char *)(slab + 1);
+    return data + EXT_ALIGN(data, p->alignment);
+}
+
+static void *ext_pool_alloc_wrap(Ext_Allocator *a, size_t size) {
+    return ext_pool_alloc((Ext_Pool *)a, size);
+}
+
+static void *ext_pool_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    return ext_pool_realloc((Ext_Pool *)a, ptr, old_size, new_size);
+}
+
+static void ext_pool_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    ext_pool_free((Ext_Pool *)a, ptr, size);
+}
+
+Ext_Pool ext_new_pool(Ext_Allocator *parent, size_t object_size, size_t alignment,
+                      size_t slab_objects) {
+    if(!alignment) alignment = EXT_DEFAULT_ALIGNMENT;
+    EXT_ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
+    EXT_ASSERT(object_size > 0, "Object size must be greater than 0");
+    // Objects must be able to hold the free list link
+    if(object_size < sizeof(void *)) object_size = sizeof(void *);
+    object_size += EXT_ALIGN(object_size, alignment);
+    if(!slab_objects) {
+        slab_objects = EXT_POOL_SLAB_SZ / object_size;
+        if(slab_objects < 8) slab_objects = 8;
+    }
+    return (Ext_Pool){
+        .base = {
+            .alloc = ext_pool_alloc_wrap,
+            .realloc = ext_pool_realloc_wrap,
+            .free = ext_pool_free_wrap,
+        },
+        .object_size = object_size,
+        .alignment = alignment,
+        .slab_objects = slab_objects,
+        .parent = parent ? parent : ext_context->alloc,
+    };
+}
+
+void *ext_pool_alloc(Ext_Pool *p, size_t size) {
+    if(size > p->object_size) {
+        return p->parent->alloc(p->parent, size);
+    }
+    p->count++;
+    if(p->free_list) {
+        void *obj = p->free_list;
+        p->free_list = *(void **)obj;
+        return obj;
+    }
+    Ext_PoolSlab *slab = p->slabs;
+    if(!slab || slab->used == p->slab_objects) {
+        slab = p->parent->alloc(p->parent, ext_pool_slab_size_(p));
+        EXT_ASSERT(slab, "out of memory");
+        slab->next = p->slabs;
+        slab->used = 0;
+        p->slabs = slab;
+    }
+    return ext_pool_slab_objects_(p, slab) + slab->used++ * p->object_size;
+}
+
+void *ext_pool_realloc(Ext_Pool *p, void *ptr, size_t old_size, size_t new_size) {
+    if(!ptr) return ext_pool_alloc(p, new_size);
+    bool old_in_pool = old_size <= p->object_size, new_in_pool = new_size <= p->object_size;
+    if(old_in_pool && new_in_pool) {
+        return ptr;
+    } else if(!old_in_pool && !new_in_pool) {
+        return p->parent->realloc(p->parent, ptr, old_size, new_size);
+    } else {
+        void *new_ptr = ext_pool_alloc(p, new_size);
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        ext_pool_free(p, ptr, old_size);
+        return new_ptr;
+    }
+}
+
+void ext_pool_free(Ext_Pool *p, void *ptr, size_t size) {
+    if(!ptr) return;
+    if(size > p->object_size) {
+        p->parent->free(p->parent, ptr, size);
+        return;
+    }
+    EXT_ASSERT(p->count > 0, "freeing an object not allocated from the pool");
+    EXT_ASSERT(EXT_ALIGN(ptr, p->alignment) == 0, "ptr is not aligned to the pool's alignment");
+    *(void **)ptr = p->free_list;
+    p->free_list = ptr;
+    p->count--;
+}
+
+void ext_pool_reset(Ext_Pool *p) {
+    if(p->slabs) {
+        Ext_PoolSlab *slab = p->slabs->next;
+        while(slab) {
+            Ext_PoolSlab *next = slab->next;
+            p->parent->free(p->parent, slab, ext_pool_slab_size_(p));
+            slab = next;
+        }
+        p->slabs->next = NULL;
+        p->slabs->used = 0;
+    }
+    p->free_list = NULL;
+    p->count = 0;
+}
+
+void ext_pool_destroy(Ext_Pool *p) {
+    ext_pool_reset(p);
+    if(p->slabs) {
+        p->parent->free(p->parent, p->slabs, ext_pool_slab_size_(p));
+        p->slabs = NULL;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Slab allocator
+//
+static inline size_t ext_floor_log2_(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(x);
+#else
+    size_t n = 0;
+    while(x >>= 1) n++;
+    return n;
+#endif
+}
+
+// Size class serving allocations of `size` bytes, `size` must be at most `EXT_SLAB_MAX_SIZE`
+static inline size_t ext_slab_class_(size_t size) {
+    if(size <= 128) return size ? (size - 1) >> 4 : 0;
+    // Four classes between each power of two: (2^k, 2^k + 2^(k-2)], ..., (2^k + 3*2^(k-2), 2^(k+1)]
+    size_t k = ext_floor_log2_(size - 1);
+    return 8 + (k - 7) * 4 + ((size - 1 - ((size_t)1 << k)) >> (k - 2));
+}
+
+static inline size_t ext_slab_class_size_(size_t cls) {
+    if(cls < 8) return (cls + 1) * 16;
+    size_t k = 7 + (cls - 8) / 4;
+    return ((size_t)1 << k) + ((cls - 8) % 4 + 1) * ((size_t)1 << (k - 2));
+}
+
+static void *ext_slab_alloc_wrap(Ext_Allocator *a, size_t size) {
+    return ext_slab_alloc((Ext_SlabAllocator *)a, size);
+}
+
+static void *ext_slab_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    return ext_slab_realloc((Ext_SlabAllocator *)a, ptr, old_size, new_size);
+}
+
+static void ext_slab_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    ext_slab_free((Ext_SlabAllocator *)a, ptr, size);
+}
+
+Ext_SlabAllocator ext_new_slab_allocator(Ext_Allocator *parent) {
+    Ext_SlabAllocator s = {
+        .base = {
+            .alloc = ext_slab_alloc_wrap,
+            .realloc = ext_slab_realloc_wrap,
+            .free = ext_slab_free_wrap,
+        },
+        .parent = parent ? parent : ext_context->alloc,
+    };
+    for(size_t i = 0; i < EXT_SLAB_CLASSES; i++) {
+        s.classes[i] = ext_new_pool(s.parent, ext_slab_class_size_(i), 0, 0);
+    }
+    return s;
+}
+
+void *ext_slab_alloc(Ext_SlabAllocator *s, size_t size) {
+    if(size > EXT_SLAB_MAX_SIZE) {
+        return s->parent->alloc(s->parent, size);
+    }
+    return ext_pool_alloc(&s->classes[ext_slab_class_(size)], size);
+}
+
+void *ext_slab_realloc(Ext_SlabAllocator *s, void *ptr, size_t old_size, size_t new_size) {
+    if(!ptr) return ext_slab_alloc(s, new_size);
+    bool old_large = old_size > EXT_SLAB_MAX_SIZE, new_large = new_size > EXT_SLAB_MAX_SIZE;
+    if(old_large && new_large) {
+        return s->parent->realloc(s->parent, ptr, old_size, new_size);
+    } else if(!old_large && !new_large && ext_slab_class_(old_size) == ext_slab_class_(new_size)) {
+        return ptr;
+    } else {
+        void *new_ptr = ext_slab_alloc(s, new_size);
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        ext_slab_free(s, ptr, old_size);
+        return new_ptr;
+    }
+}
+
+void ext_slab_free(Ext_SlabAllocator *s, void *ptr, size_t size) {
+    if(!ptr) return;
+    if(size > EXT_SLAB_MAX_SIZE) {
+        s->parent->free(s->parent, ptr, size);
+        return;
+    }
+    ext_pool_free(&s->classes[ext_slab_class_(size)], ptr, size);
+}
+
+void ext_slab_allocator_destroy(Ext_SlabAllocator *s) {
+    for(size_t i = 0; i < EXT_SLAB_CLASSES; i++) {
+        ext_pool_destroy(&s->classes[i]);
+    }
+}
+
+size_t ext_slab_block_size(size_t size) {
+    if(size > EXT_SLAB_MAX_SIZE) return size;
+    return ext_slab_class_size_(ext_slab_class_(size));
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: Thread cache allocator
+//
+static void *ext_central_heap_alloc_wrap(Ext_Allocator *a, size_t size) {
+    Ext_CentralHeap *h = (Ext_CentralHeap *)a;
+    if(size > EXT_SLAB_MAX_SIZE) return ext_slab_alloc(&h->slab, size);
+    ext_mutex_lock(&h->lock);
+    void *p = ext_slab_alloc(&h->slab, size);
+    ext_mutex_unlock(&h->lock);
+    return p;
+}
+
+static void *ext_central_heap_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size,
+                                           size_t new_size) {
+    Ext_CentralHeap *h = (Ext_CentralHeap *)a;
+    if(old_size > EXT_SLAB_MAX_SIZE && new_size > EXT_SLAB_MAX_SIZE) {
+        return ext_slab_realloc(&h->slab, ptr, old_size, new_size);
+    }
+    ext_mutex_lock(&h->lock);
+    void *p = ext_slab_realloc(&h->slab, ptr, old_size, new_size);
+    ext_mutex_unlock(&h->lock);
+    return p;
+}
+
+static void ext_central_heap_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    Ext_CentralHeap *h = (Ext_CentralHeap *)a;
+    if(size > EXT_SLAB_MAX_SIZE) {
+        ext_slab_free(&h->slab, ptr, size);
+        return;
+    }
+    ext_mutex_lock(&h->lock);
+    ext_slab_free(&h->slab, ptr, size);
+    ext_mutex_unlock(&h->lock);
+}
+
+void ext_central_heap_init(Ext_CentralHeap *h, Ext_Allocator *parent) {
+    h->base = (Ext_Allocator){
+        .alloc = ext_central_heap_alloc_wrap,
+        .realloc = ext_central_heap_realloc_wrap,
+        .free = ext_central_heap_free_wrap,
+    };
+    h->slab = ext_new_slab_allocator(parent);
+    ext_mutex_init(&h->lock);
+}
+
+void ext_central_heap_destroy(Ext_CentralHeap *h) {
+    ext_slab_allocator_destroy(&h->slab);
+    ext_mutex_destroy(&h->lock);
+}
+
+static void *ext_thread_cache_alloc_wrap(Ext_Allocator *a, size_t size) {
+    return ext_thread_cache_alloc((Ext_ThreadCache *)a, size);
+}
+
+static void *ext_thread_cache_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size,
+                                           size_t new_size) {
+    return ext_thread_cache_realloc((Ext_ThreadCache *)a, ptr, old_size, new_size);
+}
+
+static void ext_thread_cache_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
+    ext_thread_cache_free((Ext_ThreadCache *)a, ptr, size);
+}
+
+void ext_thread_cache_init(Ext_ThreadCache *c, Ext_CentralHeap *heap) {
+    memset(c, 0, sizeof(*c));
+    c->base = (Ext_Allocator){
+        .alloc = ext_thread_cache_alloc_wrap,
+        .realloc = ext_thread_cache_realloc_wrap,
+        .free = ext_thread_cache_free_wrap,
+    };
+    c->heap = heap;
+}
+
+// Moves `n` blocks from the bottom of the magazine of class `cls` back to the central heap
+static void ext_thread_cache_drain_(Ext_ThreadCache *c, size_t cls, size_t n) {
+    Ext_TcacheMagazine *mag = &c->magazines[cls];
+    Ext_Pool *pool = &c->heap->slab.classes[cls];
+    ext_mutex_lock(&c->heap->lock);
+    for(size_t i = 0; i < n; i++) {
+        ext_pool_free(pool, mag->blocks[i], pool->object_size);
+    }
+    ext_mutex_unlock(&c->heap->lock);
+    // Keep the most recently freed blocks, that are more likely to be in cache
+    for(size_t i = n; i < mag->count; i++) {
+        mag->blocks[i - n] = mag->blocks[i];
+    }
+    mag->count -= n;
+}
+
+void *ext_thread_cache_alloc(Ext_ThreadCache *c, size_t size) {
+    if(size > EXT_SLAB_MAX_SIZE) {
+        return ext_slab_alloc(&c->heap->slab, size);
+    }
+    size_t cls = ext_slab_class_(size);
+    Ext_TcacheMagazine *mag = &c->magazines[cls];
+    if(!mag->count) {
+        Ext_Pool *pool = &c->heap->slab.classes[cls];
+        ext_mutex_lock(&c->heap->lock);
+        for(size_t i = 0; i < EXT_TCACHE_BATCH; i++) {
+            mag->blocks[i] = ext_pool_alloc(pool, pool->object_size);
+        }
+        ext_mutex_unlock(&c->heap->lock);
+        mag->count = EXT_TCACHE_BATCH;
+    }
+    return mag->blocks[--mag->count];
+}
+
+void *ext_thread_cache_realloc(Ext_ThreadCache *c, void *ptr, size_t old_size, size_t new_size) {
+    if(!ptr) return ext_thread_cache_alloc(c, new_size);
+    bool old_large = old_size > EXT_SLAB_MAX_SIZE, new_large = new_size > EXT_SLAB_MAX_SIZE;
+    if(old_large && new_large) {
+        return ext_slab_realloc(&c->heap->slab, ptr, old_size, new_size);
+    } else if(!old_large && !new_large && ext_slab_class_(old_size) == ext_slab_class_(new_size)) {
+        return ptr;
+    } else {
+        void *new_ptr = ext_thread_cache_alloc(c, new_size);
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        ext_thread_cache_free(c, ptr, old_size);
+        return new_ptr;
+    }
+}
+
+void ext_thread_cache_free(Ext_ThreadCache *c, void *ptr, size_t size) {
+    if(!ptr) return;
+    if(size > EXT_SLAB_MAX_SIZE) {
+        ext_slab_free(&c->heap->slab, ptr, size);
+        return;
+    }
+    size_t cls = ext_slab_class_(size);
+    Ext_TcacheMagazine *mag = &c->magazines[cls];
+    if(mag->count == EXT_TCACHE_MAGAZINE_SIZE) {
+        ext_thread_cache_drain_(c, cls, EXT_TCACHE_BATCH);
+    }
+    mag->blocks[mag->count++] = ptr;
+}
+
+void ext_thread_cache_flush(Ext_ThreadCache *c) {
+    for(size_t cls = 0; cls < EXT_SLAB_CLASSES; cls++) {
+        if(c->magazines[cls].count) {
+            ext_thread_cache_drain_(c, cls, c->magazines[cls].count);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// SECTION: String buffer
+//
+void ext_sb_replace(Ext_StringBuffer *sb, size_t start, const char *to_replace, char replacment) {
+    EXT_ASSERT(start < sb->size, "start out of bounds");
+    size_t to_replace_len = strlen(to_replace);
+    for(size_t i = start; i < sb->size; i++) {
+        for(size_t j = 0; j < to_replace_len; j++) {
+            if(sb->items[i] == to_replace[j]) {
+                sb->items[i] = replacment;
+                break;
+            }
+        }
+    }
+}
+
+char *ext_sb_to_cstr(Ext_StringBuffer *sb) {
+    ext_sb_append_char(sb, '\0');
+    ext_array_shrink_to_fit(sb);
+    char *res = sb->items;
+    *sb = (Ext_StringBuffer){0};
+    return res;
+}
+
+#ifndef EXTLIB_NO_STD
+int ext_sb_appendf(Ext_StringBuffer *sb, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int res = ext_sb_appendvf(sb, fmt, ap);
+    va_end(ap);
+    return res;
+}
+
+int ext_sb_appendvf(Ext_StringBuffer *sb, const char *fmt, va_list ap) {
+    va_list cpy;
     va_copy(cpy, ap);
     int n = vsnprintf(NULL, 0, fmt, cpy);
     va_end(cpy);
 
-    EXT_ASSERT(n >= 0, "error in vsnprintf");
-    char *res = ext_temp_alloc(n + 1);
+    EXT_ASSERT(n >= 0, "error in vsnprintf");
+    ext_array_reserve(sb, sb->size + n + 1);
+
+    va_copy(cpy, ap);
+    vsnprintf(sb->items + sb->size, n + 1, fmt, cpy);
+    va_end(cpy);
+
+    sb->size += n;
+    return n;
+}
+
+#endif  // EXTLIB_NO_STD
+
+// -----------------------------------------------------------------------------
+// SECTION: String slice
+//
+#ifndef EXTLIB_NO_STD
+#include <ctype.h>
+#else
+static inline int isspace(int c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+#endif  // EXTLIB_NO_STD
+
+Ext_StringSlice ext_ss_from(const void *mem, size_t size) {
+    return (Ext_StringSlice){size, mem};
+}
+
+Ext_StringSlice ext_ss_from_cstr(const char *str) {
+    return ext_ss_from(str, strlen(str));
+}
+
+Ext_StringSlice ext_ss_split_once(Ext_StringSlice *ss, char delim) {
+    Ext_StringSlice split = {0, ss->data};
+    while(ss->size) {
+        ss->size--;
+        if(*ss->data++ == delim) break;
+        else split.size++;
+    }
+    return split;
+}
+
+Ext_StringSlice ext_ss_rsplit_once(Ext_StringSlice *ss, char delim) {
+    Ext_StringSlice split = {0, ss->data + ss->size};
+    while(ss->size) {
+        ss->size--;
+        if(ss->data[ss->size] == delim) break;
+        else split.size++, split.data--;
+    }
+    return split;
+}
+
+Ext_StringSlice ext_ss_split_once_ws(Ext_StringSlice *ss) {
+    Ext_StringSlice split = {0, ss->data};
+    while(ss->size) {
+        ss->size--;
+        if(isspace(*ss->data++)) break;
+        else split.size++;
+    }
+    while(ss->size && isspace(*ss->data)) {
+        ss->data++;
+        ss->size--;
+    }
+    return split;
+}
+
+Ext_StringSlice ext_ss_trim_start(Ext_StringSlice ss) {
+    while(ss.size && isspace(*ss.data)) ss.data++, ss.size--;
+    return ss;
+}
+
+Ext_StringSlice ext_ss_trim_end(Ext_StringSlice ss) {
+    while(ss.size && isspace(ss.data[ss.size - 1])) ss.size--;
+    return ss;
+}
+
+Ext_StringSlice ext_ss_trim(Ext_StringSlice ss) {
+    return ext_ss_trim_end(ext_ss_trim_start(ss));
+}
+
+Ext_StringSlice ext_ss_cut(Ext_StringSlice ss, size_t n) {
+    if(n > ss.size) n = ss.size;
+    ss.data += n;
+    ss.size -= n;
+    return ss;
+}
+
+Ext_StringSlice ext_ss_trunc(Ext_StringSlice ss, size_t n) {
+    if(n > ss.size) n = ss.size;
+    ss.size -= ss.size - n;
+    return ss;
+}
+
+bool ext_ss_starts_with(Ext_StringSlice ss, Ext_StringSlice prefix) {
+    return prefix.size <= ss.size && memcmp(ss.data, prefix.data, prefix.size) == 0;
+}
+
+bool ext_ss_ends_with(Ext_StringSlice ss, Ext_StringSlice suffix) {
+    return suffix.size <= ss.size &&
+           memcmp(&ss.data[ss.size - suffix.size], suffix.data, suffix.size) == 0;
+}
+
+int ext_ss_cmp(Ext_StringSlice s1, Ext_StringSlice s2) {
+    size_t min_sz = s1.size < s2.size ? s1.size : s2.size;
+    int res = memcmp(s1.data, s2.data, min_sz);
+    if(res != 0 || s1.size == s2.size) return res;
+    return s1.size < s2.size ? -1 : 1;
+}
+
+bool ext_ss_eq(Ext_StringSlice s1, Ext_StringSlice s2) {
+    return s1.size == s2.size && memcmp(s1.data, s2.data, s1.size) == 0;
+}
+
+char *ext_ss_to_cstr(Ext_StringSlice ss) {
+    return ext_ss_to_cstr_alloc(ss, ext_context->alloc);
+}
 
-    va_copy(cpy, ap);
-    vsnprintf(res, n + 1, fmt, cpy);
-    va_end(cpy);
+char *ext_ss_to_cstr_temp(Ext_StringSlice ss) {
+    return ext_ss_to_cstr_alloc(ss, &ext_temp_allocator.base);
+}
 
+char *ext_ss_to_cstr_alloc(Ext_StringSlice ss, Ext_Allocator *a) {
+    char *res = a->alloc(a, ss.size + 1);
+    memcpy(res, ss.data, ss.size);
+    res[ss.size] = '\0';
     return res;
 }
-#endif  // EXTLIB_NO_STD
 
 // -----------------------------------------------------------------------------
-// SECTION: Arena allocator
+// SECTION: IO
 //
-#ifndef EXT_ARENA_PAGE_SZ
-#define EXT_ARENA_PAGE_SZ (8 * 1024)  // 8 KiB
-#endif                                // EXT_ARENA_PAGE_SZ
-
-static Ext_ArenaPage *ext_arena_new_page(Ext_Arena *arena, size_t requested_size) {
-    size_t header_sz = sizeof(Ext_ArenaPage) + EXT_ALIGN(sizeof(Ext_ArenaPage), arena->alignment);
-    size_t actual_size = requested_size + header_sz;
-
-    size_t page_size = arena->page_size;
-    if(actual_size > page_size) {
-        if(arena->flags & EXT_ARENA_FLEXIBLE_PAGE) {
-            // TODO: maybe put flexible pages on another linked list?
-            // this way we risk wasting space in pages coming before it in the linked list.
-            page_size = actual_size;
-        } else {
 #ifndef EXTLIB_NO_STD
-            ext_log(EXT_ERROR,
-                    "Error: requested size %zu exceeds max allocatable size in page "
-                    "(%zu)\n",
-                    requested_size, arena->page_size - header_sz);
-            abort();
+bool ext_read_entire_file(const char *path, Ext_StringBuffer *sb) {
+    FILE *f = fopen(path, "rb");
+    if(!f) goto error;
+    if(fseek(f, 0, SEEK_END) < 0) goto error;
+
+    long long size;
+#ifdef EXT_WINDOWS
+     size = _ftelli64(f);
 #else
-            EXT_ASSERT(false, "reuqested size exceeds max allocatable size in page");
-#endif
-        }
-    }
+     size = ftell(f);
+#endif  // EXT_WINDOWS
+    if(size < 0) goto error;
+    if(fseek(f, 0, SEEK_SET) < 0) goto error;
 
-    Ext_ArenaPage *page = arena->page_allocator->alloc(arena->page_allocator, page_size);
-    EXT_ASSERT(page, "out of memory");
-    page->next = NULL;
-    // Account for alignment of first allocation; the arena assumes every pointer
-    // starts aligned to the arena's alignment.
-    page->start = page->data + EXT_ALIGN(page->data, arena->alignment);
-    page->end = (char *)page + page_size;
-    return page;
-}
+    ext_array_reserve_exact(sb, sb->size + size);
+    fread(sb->items + sb->size, 1, size, f);
+    if(ferror(f)) goto error;
+    sb->size = size;
 
-static void *ext_arena_alloc_wrap(Ext_Allocator *a, size_t size) {
-    return ext_arena_alloc((Ext_Arena *)a, size);
+    fclose(f);
+    return true;
+error:
+    ext_log(EXT_ERROR, "couldn't read file %s: %s\n", path, strerror(errno));
+    int saved_errno = errno;
+    if(f) fclose(f);
+    errno = saved_errno;
+    return false;
 }
 
-static void *ext_arena_realloc_wrap(Ext_Allocator *a, void *ptr, size_t old_size, size_t new_size) {
-    return ext_arena_realloc((Ext_Arena *)a, ptr, old_size, new_size);
-}
+bool ext_write_entire_file(const char *path, const void *mem, size_t size) {
+    FILE* f = fopen(path, "wb");
+    if(!f) goto error;
 
-static void ext_arena_free_wrap(Ext_Allocator *a, void *ptr, size_t size) {
-    ext_arena_free((Ext_Arena *)a, ptr, size);
-}
+    const char* data = mem;
+    while(size > 0) {
+        size_t written = fwrite(data, 1, size, f);
+        if (ferror(f)) goto error;
+        size -= written;
+        data += written;
+    }
 
-Ext_Arena ext_new_arena(Ext_Allocator *page_alloc, size_t alignment, size_t page_size,
-                        Ext_ArenaFlags flags) {
-    if(!alignment) alignment = EXT_DEFAULT_ALIGNMENT;
-    if(!page_size) page_size = EXT_ARENA_PAGE_SZ;
-    EXT_ASSERT((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
-    EXT_ASSERT(page_size > sizeof(Ext_ArenaPage) + EXT_ALIGN(sizeof(Ext_ArenaPage), alignment),
-               "Page size must be greater the size of Ext_ArenaPage + alignment bytes");
-    return (Ext_Arena){
-        .base = {
-            .alloc = ext_arena_alloc_wrap,
-            .realloc = ext_arena_realloc_wrap,
-            .free = ext_arena_free_wrap,
-        },
-        .alignment = alignment,
-        .page_size = page_size,
-        .page_allocator = page_alloc ? page_alloc : ext_context->alloc,
-        .flags = flags,
-    };
+    fclose(f);
+    return true;
+error:
+    ext_log(EXT_ERROR, "couldn't write file %s: %s\n", path, strerror(errno));
+    int saved_errno = errno;
+    if(f) fclose(f);
+    errno = saved_errno;
+    return false;
+}
+int ext_cmd(const char* cmd) {
+    EXT_ASSERT(cmd, "cmd is NULL");
+    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
+    int res = system(cmd);
+    if(res < 0) {
+        ext_log(EXT_ERROR, "couldn't exec cmd '%s': %s", cmd, strerror(errno));
+        return res;
+    }
+    return res;
 }
 
-void *ext_arena_alloc(Ext_Arena *a, size_t size) {
-    Ext_Arena *arena = (Ext_Arena *)a;
-    size += EXT_ALIGN(size, arena->alignment);
+int ext_cmd_read(const char* cmd, Ext_StringBuffer* sb) {
+    EXT_ASSERT(cmd, "cmd is NULL");
+    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
 
-    if(!arena->last_page) {
-        EXT_ASSERT(arena->first_page == NULL && arena->allocated == 0,
-                   "should be first allocation");
-        Ext_ArenaPage *page = ext_arena_new_page(arena, size);
-        arena->first_page = page;
-        arena->last_page = page;
+    int res = 0;
+#ifdef EXT_WINDOWS
+    const char* mode = "rb";
+#else
+    const char* mode = "r";
+#endif  // EXT_WINDOWS
+    FILE* p = popen(cmd, mode);
+    if(!p) {
+        res = -1;
+        goto error;
     }
 
-    intptr_t available = arena->last_page->end - arena->last_page->start;
-    while(available < (intptr_t)size) {
-        Ext_ArenaPage *next_page = arena->last_page->next;
-        if(!next_page) {
-            arena->last_page->next = ext_arena_new_page(arena, size);
-            arena->last_page = arena->last_page->next;
-            available = arena->last_page->end - arena->last_page->start;
-            break;
-        } else {
-            arena->last_page = next_page;
-            available = next_page->end - next_page->start;
+    const size_t chunk_size = 512;
+    for(;;) {
+        ext_array_reserve(sb, sb->size + chunk_size);
+        size_t read = fread(sb->items + sb->size, 1, sb->capacity - sb->size, p);
+        sb->size += read;
+        if(ferror(p)) {
+            res = -1;
+            goto error;
         }
+        if(feof(p)) break;
     }
 
-    EXT_ASSERT(available >= (intptr_t)size, "Not enough space in arena");
+    res = pclose(p);
+    if(res < 0) goto error;
+    return res;
+error:
+    ext_log(EXT_ERROR, "couldn't exec cmd '%s' for read: %s\n", cmd, strerror(errno));
+    int saved_errno = errno;
+    if(p) pclose(p);
+    errno = saved_errno;
+    return -1;
+}
 
-    void *p = arena->last_page->start;
-    EXT_ASSERT(EXT_ALIGN(p, arena->alignment) == 0,
-               "Pointer is not aligned to the arena's alignment");
-    arena->last_page->start += size;
-    arena->allocated += size;
+int ext_cmd_write(const char* cmd, const void* mem, size_t size) {
+    EXT_ASSERT(cmd, "cmd is NULL");
+    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
 
-    if(arena->flags & EXT_ARENA_ZERO_ALLOC) {
-        memset(p, 0, size);
+    int res = 0;
+#ifdef EXT_WINDOWS
+    const char* mode = "wb";
+#else
+    const char* mode = "w";
+#endif  // EXT_WINDOWS
+    FILE* p = popen(cmd, mode);
+    if(!p)  {
+        res = -1;
+        goto error;
+    }
+    
+    const char* data = mem;
+    while(size > 0) {
+        size_t written = fwrite(data, 1, size, p);
+        if (ferror(p)) {
+            res = -1;
+            goto error;
+        }
+        size -= written;
+        data += written;
     }
 
-    return p;
+    res = pclose(p);
+    if (res < 0) goto error;
+    return res;
+error:
+    ext_log(EXT_ERROR, "couldn't exec cmd '%s' for write: %s\n", cmd, strerror(errno));
+    int saved_errno = errno;
+    if(p) pclose(p);
+    errno = saved_errno;
+    return -1;
 }
+#endif  // EXTLIB_NO_STD
 
-void *ext_arena_realloc(Ext_Arena *a, void *ptr, size_t old_size, size_t new_size) {
-    Ext_Arena *arena = (Ext_Arena *)a;
-    EXT_ASSERT(EXT_ALIGN(ptr, arena->alignment) == 0,
-               "ptr is not aligned to the arena's alignment");
-
-    Ext_ArenaPage *page = arena->last_page;
-    EXT_ASSERT(page, "No pages in arena");
+// -----------------------------------------------------------------------------
+// SECTION: Hashmap
+//
+static size_t ext_hmap_table_size_(size_t entries_sz, size_t hash_sz, size_t cap,
+                                   size_t *hashes_offset) {
+    size_t sz = cap * entries_sz;
+    size_t pad = EXT_ALIGN(sz, hash_sz);
+    *hashes_offset = sz + pad;
+    return sz + pad + hash_sz * cap;
+}
 
-    size_t alignment = EXT_ALIGN(old_size, arena->alignment);
-    if(page->start - old_size - alignment == ptr) {
-        // Reallocating last allocated memory, can grow/shrink in-place
-        page->start -= old_size + alignment;
-        arena->allocated -= old_size + alignment;
-        void *new_ptr = ext_arena_alloc(a, new_size);
-        if(new_ptr != ptr) {
-            memcpy(new_ptr, ptr, old_size);
-        }
-        return new_ptr;
-    } else if(new_size > old_size) {
-        void *new_ptr = ext_arena_alloc(a, new_size);
-        memcpy(new_ptr, ptr, old_size);
-        return new_ptr;
-    } else {
-        return ptr;
+// Inserts all entries of the old table in the new one, that must be empty
+static void ext_hmap_reinsert_(const void *entries, const void *hashes, size_t cap,
+                               void *newentries, void *newhashes, size_t newcap, size_t entries_sz,
+                               size_t hash_sz) {
+    for(size_t i = 0; i <= cap; i++) {
+        size_t hash = ext_hmap_get_hash_(hashes, hash_sz, i);
+        if(EXT_HMAP_IS_VALID(hash)) {
+            size_t newidx = hash & (newcap - 1);
+            while(!EXT_HMAP_IS_EMPTY(ext_hmap_get_hash_(newhashes, hash_sz, newidx))) {
+                newidx = (newidx + 1) & (newcap - 1);
+            }
+            memcpy((char *)newentries + newidx * entries_sz, (const char *)entries + i * entries_sz,
+                   entries_sz);
+            ext_hmap_set_hash_(newhashes, hash_sz, newidx, hash);
+        }
     }
 }
 
-void ext_arena_free(Ext_Arena *a, void *ptr, size_t size) {
-    Ext_Arena *arena = (Ext_Arena *)a;
-    EXT_ASSERT(EXT_ALIGN(ptr, arena->alignment) == 0,
-               "ptr is not aligned to the arena's alignment");
+// Allocates a table of `newsz` bytes that will replace `*old`, a table of `oldsz` bytes or NULL.
+// With LIFO allocators, allocating a new table and freeing the old one would leave the old table
+// behind as dead memory. Instead, the old table is extended (in place if it's the last allocation)
+// with room for the new one right after it, and `*old` is updated in case it moved.
+static void *ext_hmap_new_table_(Ext_Allocator *a, void **old, size_t oldsz, size_t newsz) {
+    if(*old && (a->flags & EXT_ALLOCATOR_LIFO)) {
+        size_t off = oldsz + EXT_ALIGN(oldsz, EXT_DEFAULT_ALIGNMENT);
+        *old = a->realloc(a, *old, oldsz, off + newsz);
+        return (char *)*old + off;
+    }
+    return a->alloc(a, newsz);
+}
 
-    Ext_ArenaPage *page = arena->last_page;
-    EXT_ASSERT(page, "No pages in arena");
+// Frees the old table once its entries have been moved to the one returned by
+// `ext_hmap_new_table_`. Returns the final location of the new table, that with LIFO allocators
+// is moved down over the old one.
+static void *ext_hmap_replace_table_(Ext_Allocator *a, void *old, size_t oldsz, void *new,
+                                     size_t newsz) {
+    if(!old) return new;
+    if(a->flags & EXT_ALLOCATOR_LIFO) {
+        size_t off = (char *)new - (char *)old;
+        memmove(old, new, newsz);
+        return a->realloc(a, old, off + newsz, newsz);
+    }
+    a->free(a, old, oldsz);
+    return new;
+}
 
-    size_t alignment = EXT_ALIGN(size, arena->alignment);
-    if(page->start - size - alignment == ptr) {
-        // Deallocating last allocated memory, can shrink in-place
-        page->start -= size + alignment;
-        arena->allocated -= size + alignment;
-        return;
+static void ext_hmap_rehash_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz,
+                             size_t *cap, size_t newcap, Ext_Allocator **a) {
+    size_t hashes_offset, old_hashes_offset = 0, oldsz = 0;
+    size_t totalsz = ext_hmap_table_size_(entries_sz, hash_sz, newcap, &hashes_offset);
+    if(*entries) oldsz = ext_hmap_table_size_(entries_sz, hash_sz, *cap + 1, &old_hashes_offset);
+    if(!*a) *a = ext_context->alloc;
+    char *newentries = ext_hmap_new_table_(*a, entries, oldsz, totalsz);
+    EXT_ASSERT(((uintptr_t)(newentries + hashes_offset) & (hash_sz - 1)) == 0,
+               "newhashes allocation is not aligned");
+    memset(newentries + hashes_offset, 0, hash_sz * newcap);
+    if(*entries) {
+        ext_hmap_reinsert_(*entries, (char *)*entries + old_hashes_offset, *cap, newentries,
+                           newentries + hashes_offset, newcap, entries_sz, hash_sz);
+        newentries = ext_hmap_replace_table_(*a, *entries, oldsz, newentries, totalsz);
     }
+    *entries = newentries;
+    *hashes = newentries + hashes_offset;
+    *cap = newcap - 1;
+}
 
-    // In stack allocator mode force LIFO order
-    if(arena->flags & EXT_ARENA_STACK_ALLOC) {
-#ifndef EXTLIB_NO_STD
-        ext_log(EXT_ERROR, "Deallocating memory in non-LIFO order: got %p, expected %p\n", ptr,
-                (void *)(page->start - size - alignment));
-        abort();
-#else
-        EXT_ASSERT(false, "Deallocating memory in non-LIFO order");
-#endif
+void ext_hmap_grow_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz, size_t *cap,
+                    Ext_Allocator **a) {
+    size_t newcap = *cap ? (*cap + 1) * 2 : EXT_HMAP_INIT_CAPACITY;
+    ext_hmap_rehash_(entries, entries_sz, hashes, hash_sz, cap, newcap, a);
+}
+
+void ext_hmap_reserve_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz,
+                       size_t *cap, size_t n, Ext_Allocator **a) {
+    size_t newcap = *cap ? *cap + 1 : EXT_HMAP_INIT_CAPACITY;
+    while(EXT_HMAP_MAX_ENTRY_LOAD(newcap) < n) {
+        newcap *= 2;
     }
+    ext_hmap_rehash_(entries, entries_sz, hashes, hash_sz, cap, newcap, a);
 }
 
-Ext_ArenaCheckpoint ext_arena_checkpoint(const Ext_Arena *a) {
-    if(!a->last_page) {
-        EXT_ASSERT(a->first_page == NULL, "arena should be empty");
-        return (Ext_ArenaCheckpoint){0};
-    } else {
-        return (Ext_ArenaCheckpoint){
-            a->last_page,
-            a->last_page->start,
-            a->allocated,
-        };
+void ext_hmap_free_table_(void *entries, size_t entries_sz, size_t hash_sz, size_t cap,
+                          Ext_Allocator *a) {
+    size_t hashes_offset;
+    a->free(a, entries, ext_hmap_table_size_(entries_sz, hash_sz, cap + 1, &hashes_offset));
+}
+
+void ext_hmap_compact_(void *entries, size_t entries_sz, void *hashes, size_t hash_sz, size_t cap) {
+    // Start right after a slot that was empty before the purge: no probe sequence crosses it, so
+    // every entry has its home slot between the start and its current position. Visiting entries
+    // in this order, each one can only move back towards its home, into a slot that was freed
+    // before it and that isn't part of the probe sequence of any entry still to be visited.
+    size_t start = 0;
+    while(!EXT_HMAP_IS_EMPTY(ext_hmap_get_hash_(hashes, hash_sz, start))) {
+        start++;
+        EXT_ASSERT(start <= cap, "hashmap has no empty slots");
+    }
+    for(size_t i = 0; i <= cap; i++) {
+        if(EXT_HMAP_IS_TOMB(ext_hmap_get_hash_(hashes, hash_sz, i))) {
+            ext_hmap_set_hash_(hashes, hash_sz, i, EXT_HMAP_EMPTY_MARK);
+        }
+    }
+    for(size_t n = 1; n <= cap; n++) {
+        size_t i = (start + n) & cap;
+        size_t hash = ext_hmap_get_hash_(hashes, hash_sz, i);
+        if(!EXT_HMAP_IS_VALID(hash)) continue;
+        size_t newidx = hash & cap;
+        while(newidx != i && !EXT_HMAP_IS_EMPTY(ext_hmap_get_hash_(hashes, hash_sz, newidx))) {
+            newidx = (newidx + 1) & cap;
+        }
+        if(newidx != i) {
+            memcpy((char *)entries + newidx * entries_sz, (char *)entries + i * entries_sz,
+                   entries_sz);
+            ext_hmap_set_hash_(hashes, hash_sz, newidx, hash);
+            ext_hmap_set_hash_(hashes, hash_sz, i, EXT_HMAP_EMPTY_MARK);
+        }
     }
 }
 
-void ext_arena_rewind(Ext_Arena *a, Ext_ArenaCheckpoint checkpoint) {
-    if(!checkpoint.page) {
-        ext_arena_reset(a);
-        return;
+void ext_hmap_shrink_(void **entries, size_t entries_sz, void **hashes, size_t hash_sz, size_t *cap,
+                      size_t n, Ext_Allocator **a) {
+    size_t newcap = EXT_HMAP_INIT_CAPACITY;
+    while(EXT_HMAP_MAX_ENTRY_LOAD(newcap) < n) {
+        newcap *= 2;
     }
-    checkpoint.page->start = checkpoint.page_start;
-    Ext_ArenaPage *page = checkpoint.page->next;
-    while(page) {
-        page->start = page->data + EXT_ALIGN(page->data, a->alignment);
-        page = page->next;
+    if(newcap < *cap + 1) {
+        ext_hmap_rehash_(entries, entries_sz, hashes, hash_sz, cap, newcap, a);
+    } else {
+        ext_hmap_compact_(*entries, entries_sz, *hashes, hash_sz, *cap);
     }
-    a->last_page = checkpoint.page;
-    a->allocated = checkpoint.allocated;
 }
 
-void ext_arena_reset(Ext_Arena *a) {
-    Ext_ArenaPage *page = a->first_page;
-    while(page) {
-        page->start = page->data + EXT_ALIGN(page->data, a->alignment);
-        page = page->next;
+void ext_hmap_stats_(const void *hashes, size_t hash_sz, size_t cap, size_t size,
+                     size_t tombstones, size_t entries_sz, Ext_HmapStats *out) {
+    memset(out, 0, sizeof(*out));
+    if(!hashes) return;
+    out->size = size;
+    out->capacity = cap + 1;
+    out->tombstones = tombstones;
+    out->load_factor = (double)(size + tombstones) / (double)(cap + 1);
+    out->entries_bytes = (cap + 1) * entries_sz;
+    out->hashes_bytes = (cap + 1) * hash_sz;
+    size_t total_probe = 0;
+    for(size_t i = 0; i <= cap; i++) {
+        size_t hash = ext_hmap_get_hash_(hashes, hash_sz, i);
+        if(!EXT_HMAP_IS_VALID(hash)) continue;
+        size_t probe = (i - (hash & cap)) & cap;
+        total_probe += probe;
+        if(probe > out->max_probe) out->max_probe = probe;
+        size_t bucket = probe < EXT_HMAP_STATS_HISTOGRAM_SIZE ? probe
+                                                              : EXT_HMAP_STATS_HISTOGRAM_SIZE - 1;
+        out->probe_histogram[bucket]++;
     }
-    a->last_page = a->first_page;
-    a->allocated = 0;
+    if(size) out->avg_probe = (double)total_probe / (double)size;
 }
 
-void ext_arena_destroy(Ext_Arena *a) {
-    Ext_ArenaPage *page = a->first_page;
-    while(page) {
-        Ext_ArenaPage *next = page->next;
-        a->page_allocator->free(a->page_allocator, page, page->end - (char *)page);
-        page = next;
+#ifdef EXT_HMAP_PROBE_COUNTERS
+EXT_TLS Ext_HmapCounters ext_hmap_counters = {0};
+
+void ext_hmap_reset_counters(void) {
+    memset(&ext_hmap_counters, 0, sizeof(ext_hmap_counters));
+}
+#endif  // EXT_HMAP_PROBE_COUNTERS
+
+// -----------------------------------------------------------------------------
+// SECTION: Robin Hood hashmap
+//
+static void ext_rhmap_move_slot_(void *entries, size_t entries_sz, size_t *hashes, size_t dst,
+                                 size_t src) {
+    memcpy((char *)entries + dst * entries_sz, (char *)entries + src * entries_sz, entries_sz);
+    hashes[dst] = hashes[src];
+}
+
+void ext_rhmap_make_room_(void *entries, size_t entries_sz, size_t *hashes, size_t cap,
+                          size_t idx) {
+    // Entries in a cluster are ordered by home slot, so displacing the richer entries one by one is
+    // equivalent to shifting the whole run right by one slot, up to the first empty one.
+    size_t empty = idx;
+    while(!EXT_HMAP_IS_EMPTY(hashes[empty])) {
+        empty = (empty + 1) & cap;
     }
-    a->first_page = NULL;
-    a->last_page = NULL;
-    a->allocated = 0;
+    while(empty != idx) {
+        size_t prev = (empty - 1) & cap;
+        ext_rhmap_move_slot_(entries, entries_sz, hashes, empty, prev);
+        empty = prev;
+    }
+    hashes[idx] = EXT_HMAP_EMPTY_MARK;
 }
 
-char *ext_arena_strdup(Ext_Arena *a, const char *str) {
-    return ext_strdup_alloc(str, &a->base);
+void ext_rhmap_remove_(void *entries, size_t entries_sz, size_t *hashes, size_t cap, size_t idx) {
+    size_t next = (idx + 1) & cap;
+    while(!EXT_HMAP_IS_EMPTY(hashes[next]) && EXT_RHMAP_PROBE_DIST(hashes[next], next, cap) > 0) {
+        ext_rhmap_move_slot_(entries, entries_sz, hashes, idx, next);
+        idx = next;
+        next = (next + 1) & cap;
+    }
+    hashes[idx] = EXT_HMAP_EMPTY_MARK;
 }
 
-void *ext_arena_memdup(Ext_Arena *a, const void *mem, size_t size) {
-    return ext_memdup_alloc(mem, size, &a->base);
+void ext_rhmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
+                     Ext_Allocator **a) {
+    size_t newcap = *cap ? (*cap + 1) * 2 : EXT_HMAP_INIT_CAPACITY;
+    size_t hashes_offset, old_hashes_offset = 0, oldsz = 0;
+    size_t totalsz = ext_hmap_table_size_(entries_sz, sizeof(size_t), newcap, &hashes_offset);
+    if(*entries) {
+        oldsz = ext_hmap_table_size_(entries_sz, sizeof(size_t), *cap + 1, &old_hashes_offset);
+    }
+    if(!*a) *a = ext_context->alloc;
+    void *newentries = ext_hmap_new_table_(*a, entries, oldsz, totalsz);
+    size_t *newhashes = (size_t *)((char *)newentries + hashes_offset);
+    memset(newhashes, 0, sizeof(size_t) * newcap);
+    if(*entries) {
+        const size_t *oldhashes = (size_t *)((char *)*entries + old_hashes_offset);
+        for(size_t i = 0; i <= *cap; i++) {
+            size_t hash = oldhashes[i];
+            if(!EXT_HMAP_IS_VALID(hash)) continue;
+            size_t idx = hash & (newcap - 1);
+            for(size_t dist = 0; !EXT_HMAP_IS_EMPTY(newhashes[idx]); dist++) {
+                if(dist > EXT_RHMAP_PROBE_DIST(newhashes[idx], idx, newcap - 1)) {
+                    ext_rhmap_make_room_(newentries, entries_sz, newhashes, newcap - 1, idx);
+                    break;
+                }
+                idx = (idx + 1) & (newcap - 1);
+            }
+            memcpy((char *)newentries + idx * entries_sz, (char *)*entries + i * entries_sz,
+                   entries_sz);
+            newhashes[idx] = hash;
+        }
+        newentries = ext_hmap_replace_table_(*a, *entries, oldsz, newentries, totalsz);
+    }
+    *entries = newentries;
+    *hashes = (size_t *)((char *)newentries + hashes_offset);
+    *cap = newcap - 1;
 }
 
-#ifndef EXTLIB_NO_STD
-char *ext_arena_sprintf(Ext_Arena *a, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    char *res = ext_arena_vsprintf(a, fmt, ap);
-    va_end(ap);
-    return res;
+// -----------------------------------------------------------------------------
+// SECTION: Swiss hashmap
+//
+static size_t ext_swmap_table_size_(size_t entries_sz, size_t cap, size_t *ctrl_offset) {
+    size_t sz = cap * entries_sz;
+    size_t pad = EXT_ALIGN(sz, EXT_SWMAP_GROUP);
+    *ctrl_offset = sz + pad;
+    return sz + pad + cap;
 }
 
-char *ext_arena_vsprintf(Ext_Arena *a, const char *fmt, va_list ap) {
-    va_list cpy;
-    va_copy(cpy, ap);
-    int n = vsnprintf(NULL, 0, fmt, cpy);
-    va_end(cpy);
+// Allocates a table of `cap` slots that will replace the old one, if any. The old table is updated
+// in case it moves, see `ext_hmap_new_table_`
+void ext_swmap_alloc_(void **entries, size_t entries_sz, uint8_t **ctrl, size_t cap,
+                      void **old_entries, uint8_t **old_ctrl, size_t old_cap, Ext_Allocator **a) {
+    EXT_ASSERT((cap & (cap - 1)) == 0 && cap >= EXT_SWMAP_GROUP,
+               "capacity must be a power of two of at least EXT_SWMAP_GROUP");
+    size_t ctrl_offset, old_ctrl_offset = 0, oldsz = 0;
+    size_t totalsz = ext_swmap_table_size_(entries_sz, cap, &ctrl_offset);
+    if(*old_entries) oldsz = ext_swmap_table_size_(entries_sz, old_cap, &old_ctrl_offset);
+    if(!*a) *a = ext_context->alloc;
+    *entries = ext_hmap_new_table_(*a, old_entries, oldsz, totalsz);
+    if(*old_entries) *old_ctrl = (uint8_t *)*old_entries + old_ctrl_offset;
+    *ctrl = (uint8_t *)*entries + ctrl_offset;
+    memset(*ctrl, EXT_SWMAP_EMPTY, cap);
+}
 
-    EXT_ASSERT(n >= 0, "error in vsnprintf");
-    char *res = ext_arena_alloc(a, n + 1);
+// Frees the old table once all entries have been moved to the new one, that might move as well
+void ext_swmap_replace_(void **entries, size_t entries_sz, uint8_t **ctrl, size_t cap,
+                        void *old_entries, size_t old_cap, Ext_Allocator *a) {
+    size_t ctrl_offset, old_ctrl_offset;
+    size_t totalsz = ext_swmap_table_size_(entries_sz, cap, &ctrl_offset);
+    size_t oldsz = ext_swmap_table_size_(entries_sz, old_cap, &old_ctrl_offset);
+    *entries = ext_hmap_replace_table_(a, old_entries, oldsz, *entries, totalsz);
+    *ctrl = (uint8_t *)*entries + ctrl_offset;
+}
 
-    va_copy(cpy, ap);
-    vsnprintf(res, n + 1, fmt, cpy);
-    va_end(cpy);
+void ext_swmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a) {
+    size_t ctrl_offset;
+    size_t totalsz = ext_swmap_table_size_(entries_sz, cap, &ctrl_offset);
+    a->free(a, entries, totalsz);
+}
 
-    return res;
+size_t ext_swmap_insert_slot_(const uint8_t *ctrl, size_t cap, size_t hash) {
+    size_t groups_mask = cap / EXT_SWMAP_GROUP;
+    size_t g = EXT_SWMAP_H1(hash) & groups_mask;
+    for(size_t step = 1;; step++) {
+        uint32_t mask = ext_swmap_match_free_(ctrl + g * EXT_SWMAP_GROUP);
+        if(mask) return g * EXT_SWMAP_GROUP + ext_ctz32_(mask);
+        g = (g + step) & groups_mask;
+    }
 }
-#endif  // EXTLIB_NO_STD
 
 // -----------------------------------------------------------------------------
-// SECTION: String buffer
+// SECTION: Incremental hashmap
 //
-void ext_sb_replace(Ext_StringBuffer *sb, size_t start, const char *to_replace, char replacment) {
-    EXT_ASSERT(start < sb->size, "start out of bounds");
-    size_t to_replace_len = strlen(to_replace);
-    for(size_t i = start; i < sb->size; i++) {
-        for(size_t j = 0; j < to_replace_len; j++) {
-            if(sb->items[i] == to_replace[j]) {
-                sb->items[i] = replacment;
-                break;
-            }
+void ext_ihmap_start_rehash_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
+                             size_t size, size_t *tombstones, void **old_entries,
+                             size_t **old_hashes, size_t *old_cap, size_t *migrated,
+                             Ext_Allocator **a) {
+    EXT_ASSERT(*old_entries == NULL, "a rehash is already in progress");
+    // Like `hmap`, rehash at the same capacity if tombstones take up a good part of the load
+    size_t newcap = EXT_HMAP_INIT_CAPACITY;
+    if(*entries) {
+        size_t max_load = EXT_HMAP_MAX_ENTRY_LOAD(*cap + 1);
+        newcap = size < EXT_HMAP_MAX_ENTRY_LOAD(max_load) ? *cap + 1 : (*cap + 1) * 2;
+    }
+    size_t hashes_offset;
+    size_t totalsz = ext_hmap_table_size_(entries_sz, sizeof(size_t), newcap, &hashes_offset);
+    if(!*a) *a = ext_context->alloc;
+    void *newentries = (*a)->alloc(*a, totalsz);
+    size_t *newhashes = (size_t *)((char *)newentries + hashes_offset);
+    EXT_ASSERT(((uintptr_t)newhashes & (sizeof(size_t) - 1)) == 0,
+               "newhashes allocation is not aligned");
+    memset(newhashes, 0, sizeof(size_t) * newcap);
+    if(*entries) {
+        *old_entries = *entries;
+        *old_hashes = *hashes;
+        *old_cap = *cap;
+        *migrated = 0;
+    }
+    *entries = newentries;
+    *hashes = newhashes;
+    *cap = newcap - 1;
+    *tombstones = 0;
+}
+
+void ext_ihmap_migrate_(void **old_entries, size_t **old_hashes, size_t *old_cap, size_t *migrated,
+                        void *entries, size_t *hashes, size_t cap, size_t *tombstones,
+                        size_t entries_sz, size_t steps, Ext_Allocator *a) {
+    size_t remaining = *old_cap + 1 - *migrated;
+    size_t end = *migrated + (steps < remaining ? steps : remaining);
+    for(size_t i = *migrated; i < end; i++) {
+        size_t hash = (*old_hashes)[i];
+        if(!EXT_HMAP_IS_VALID(hash)) continue;
+        // The key cannot be in the new table, so the first free slot will do
+        size_t newidx = hash & cap;
+        while(EXT_HMAP_IS_VALID(hashes[newidx])) {
+            newidx = (newidx + 1) & cap;
         }
+        if(EXT_HMAP_IS_TOMB(hashes[newidx])) (*tombstones)--;
+        memcpy((char *)entries + newidx * entries_sz, (char *)(*old_entries) + i * entries_sz,
+               entries_sz);
+        hashes[newidx] = hash;
+        // Leave a tombstone, so that probing for entries yet to be migrated still works
+        (*old_hashes)[i] = EXT_HMAP_TOMB_MARK;
+    }
+    *migrated = end;
+    if(end > *old_cap) {
+        ext_hmap_free_table_(*old_entries, entries_sz, sizeof(size_t), *old_cap, a);
+        *old_entries = NULL;
+        *old_hashes = NULL;
+        *old_cap = 0;
+        *migrated = 0;
     }
 }
 
-char *ext_sb_to_cstr(Ext_StringBuffer *sb) {
-    ext_sb_append_char(sb, '\0');
-    ext_array_shrink_to_fit(sb);
-    char *res = sb->items;
-    *sb = (Ext_StringBuffer){0};
-    return res;
+void *ext_ihmap_next_(const void *old_entries, const size_t *old_hashes, size_t old_cap,
+                      const void *entries, const size_t *hashes, size_t cap, size_t sz,
+                      const void *it) {
+    const char *old_end = ext_hmap_end_(old_entries, old_cap, sz);
+    bool in_old = !it || ((const char *)it >= (const char *)old_entries &&
+                          (const char *)it < old_end);
+    if(!in_old) return ext_hmap_next_(entries, hashes, sizeof(size_t), it, cap, sz);
+    if(old_entries) {
+        size_t i = it ? ((const char *)it - (const char *)old_entries) / sz + 1 : 0;
+        for(; i <= old_cap; i++) {
+            if(EXT_HMAP_IS_VALID(old_hashes[i])) {
+                return (char *)old_entries + i * sz;
+            }
+        }
+    }
+    return ext_hmap_begin_(entries, hashes, sizeof(size_t), cap, sz);
 }
 
-#ifndef EXTLIB_NO_STD
-int ext_sb_appendf(Ext_StringBuffer *sb, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    int res = ext_sb_appendvf(sb, fmt, ap);
-    va_end(ap);
-    return res;
+// -----------------------------------------------------------------------------
+// SECTION: Dense hashmap
+//
+static size_t ext_dmap_table_size_(size_t entries_sz, size_t cap, size_t *hashes_offset,
+                                   size_t *index_offset) {
+    size_t usable = EXT_HMAP_MAX_ENTRY_LOAD(cap);
+    size_t sz = usable * entries_sz;
+    size_t pad = EXT_ALIGN(sz, sizeof(size_t));
+    *hashes_offset = sz + pad;
+    *index_offset = *hashes_offset + usable * sizeof(size_t);
+    return *index_offset + cap * ext_dmap_index_width_(cap - 1);
 }
 
-int ext_sb_appendvf(Ext_StringBuffer *sb, const char *fmt, va_list ap) {
-    va_list cpy;
-    va_copy(cpy, ap);
-    int n = vsnprintf(NULL, 0, fmt, cpy);
-    va_end(cpy);
+void ext_dmap_rebuild_(void **entries, size_t entries_sz, size_t **hashes, void **index,
+                       size_t *cap, size_t *used, size_t size, Ext_Allocator **a) {
+    // Grow only if live entries take up more than half the dense array, otherwise the rebuild
+    // just compacts away the holes left by deletions
+    size_t newcap;
+    if(!*entries) {
+        newcap = EXT_HMAP_INIT_CAPACITY;
+    } else if(size >= EXT_HMAP_MAX_ENTRY_LOAD(*cap + 1) / 2) {
+        newcap = (*cap + 1) * 2;
+    } else {
+        newcap = *cap + 1;
+    }
 
-    EXT_ASSERT(n >= 0, "error in vsnprintf");
-    ext_array_reserve(sb, sb->size + n + 1);
+    size_t hashes_offset, index_offset;
+    size_t old_hashes_offset = 0, old_index_offset = 0, oldsz = 0;
+    size_t totalsz = ext_dmap_table_size_(entries_sz, newcap, &hashes_offset, &index_offset);
+    if(*entries) {
+        oldsz = ext_dmap_table_size_(entries_sz, *cap + 1, &old_hashes_offset, &old_index_offset);
+    }
+    if(!*a) *a = ext_context->alloc;
+    char *newentries = ext_hmap_new_table_(*a, entries, oldsz, totalsz);
+    size_t *newhashes = (size_t *)(newentries + hashes_offset);
+    void *newindex = newentries + index_offset;
+    memset(newindex, 0, newcap * ext_dmap_index_width_(newcap - 1));
+
+    // Reload the old hashes, as the old table might have moved
+    const size_t *oldhashes = *entries ? (size_t *)((char *)*entries + old_hashes_offset) : NULL;
+    size_t newused = 0;
+    for(size_t i = 0; i < *used; i++) {
+        size_t hash = oldhashes[i];
+        if(!EXT_HMAP_IS_VALID(hash)) continue;
+        memcpy(newentries + newused * entries_sz, (char *)*entries + i * entries_sz, entries_sz);
+        newhashes[newused] = hash;
+        size_t idx = hash & (newcap - 1);
+        while(ext_dmap_index_get_(newindex, newcap - 1, idx) != EXT_DMAP_EMPTY) {
+            idx = (idx + 1) & (newcap - 1);
+        }
+        ext_dmap_index_set_(newindex, newcap - 1, idx, newused + 2);
+        newused++;
+    }
+    EXT_ASSERT(newused == size, "dense hashmap size mismatch");
 
-    va_copy(cpy, ap);
-    vsnprintf(sb->items + sb->size, n + 1, fmt, cpy);
-    va_end(cpy);
+    newentries = ext_hmap_replace_table_(*a, *entries, oldsz, newentries, totalsz);
+    *entries = newentries;
+    *hashes = (size_t *)(newentries + hashes_offset);
+    *index = newentries + index_offset;
+    *cap = newcap - 1;
+    *used = newused;
+}
 
-    sb->size += n;
-    return n;
+void ext_dmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a) {
+    size_t hashes_offset, index_offset;
+    a->free(a, entries, ext_dmap_table_size_(entries_sz, cap + 1, &hashes_offset, &index_offset));
 }
 
-#endif  // EXTLIB_NO_STD
+// -----------------------------------------------------------------------------
+// SECTION: Integer set
+//
+void ext_iset_rehash_(void **entries, size_t key_sz, size_t *cap, size_t n, Ext_Allocator **a) {
+    size_t newcap = *entries && *cap + 1 > EXT_HMAP_INIT_CAPACITY ? *cap + 1
+                                                                   : EXT_HMAP_INIT_CAPACITY;
+    while(EXT_HMAP_MAX_ENTRY_LOAD(newcap) < n) {
+        newcap *= 2;
+    }
+    if(!*a) *a = ext_context->alloc;
+    // One more slot past the end of the table for the zero key
+    size_t oldsz = *entries ? (*cap + 2) * key_sz : 0;
+    char *newentries = ext_hmap_new_table_(*a, entries, oldsz, (newcap + 1) * key_sz);
+    memset(newentries, 0, (newcap + 1) * key_sz);
+    if(*entries) {
+        for(size_t i = 0; i <= *cap; i++) {
+            uint64_t key = ext_iset_load_(*entries, key_sz, i);
+            if(key == 0) continue;
+            size_t newidx = ext_hash_int_(key, key_sz) & (newcap - 1);
+            while(ext_iset_load_(newentries, key_sz, newidx) != 0) {
+                newidx = (newidx + 1) & (newcap - 1);
+            }
+            memcpy(newentries + newidx * key_sz, (char *)*entries + i * key_sz, key_sz);
+        }
+        newentries = ext_hmap_replace_table_(*a, *entries, oldsz, newentries,
+                                             (newcap + 1) * key_sz);
+    }
+    *entries = newentries;
+    *cap = newcap - 1;
+}
+
+void ext_iset_remove_at_(void *entries, size_t key_sz, size_t cap, size_t idx) {
+    // Move back the keys following the removed one in the probe run, so that lookups never stop at
+    // the hole before reaching them. A key can fill the hole only if its home slot doesn't lie
+    // between the hole and its current position.
+    size_t hole = idx;
+    for(size_t i = (idx + 1) & cap;; i = (i + 1) & cap) {
+        uint64_t key = ext_iset_load_(entries, key_sz, i);
+        if(key == 0) break;
+        size_t home = ext_hash_int_(key, key_sz) & cap;
+        if(((i - home) & cap) >= ((i - hole) & cap)) {
+            memcpy((char *)entries + hole * key_sz, (char *)entries + i * key_sz, key_sz);
+            hole = i;
+        }
+    }
+    memset((char *)entries + hole * key_sz, 0, key_sz);
+}
 
 // -----------------------------------------------------------------------------
-// SECTION: String slice
+// SECTION: Generational hashmap
 //
-#ifndef EXTLIB_NO_STD
-#include <ctype.h>
-#else
-static inline int isspace(int c) {
-    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+void ext_ghmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap, size_t size,
+                     size_t *gen, Ext_Allocator **a) {
+    // Like `hmap`, compact at the same capacity if tombstones take up a good part of the load
+    size_t newcap = EXT_HMAP_INIT_CAPACITY;
+    if(*entries) {
+        size_t max_load = EXT_HMAP_MAX_ENTRY_LOAD(*cap + 1);
+        newcap = size < EXT_HMAP_MAX_ENTRY_LOAD(max_load) ? *cap + 1 : (*cap + 1) * 2;
+    }
+    size_t hashes_offset, old_hashes_offset = 0, oldsz = 0;
+    size_t totalsz = ext_hmap_table_size_(entries_sz, sizeof(size_t), newcap, &hashes_offset);
+    if(*entries) {
+        oldsz = ext_hmap_table_size_(entries_sz, sizeof(size_t), *cap + 1, &old_hashes_offset);
+    }
+    if(!*a) *a = ext_context->alloc;
+    char *newentries = ext_hmap_new_table_(*a, entries, oldsz, totalsz);
+    size_t *newhashes = (size_t *)(newentries + hashes_offset);
+    EXT_ASSERT(((uintptr_t)newhashes & (sizeof(size_t) - 1)) == 0,
+               "newhashes allocation is not aligned");
+    memset(newhashes, 0, sizeof(size_t) * newcap);
+    if(*entries) {
+        const size_t *oldhashes = (size_t *)((char *)*entries + old_hashes_offset);
+        for(size_t i = 0; i <= *cap; i++) {
+            size_t hash = ext_ghmap_untag_(oldhashes[i], *gen);
+            if(!EXT_HMAP_IS_VALID(hash)) continue;
+            size_t newidx = hash & (newcap - 1);
+            while(!EXT_HMAP_IS_EMPTY(newhashes[newidx])) {
+                newidx = (newidx + 1) & (newcap - 1);
+            }
+            memcpy(newentries + newidx * entries_sz, (char *)*entries + i * entries_sz,
+                   entries_sz);
+            newhashes[newidx] = oldhashes[i];
+        }
+        newentries = ext_hmap_replace_table_(*a, *entries, oldsz, newentries, totalsz);
+    } else {
+        // Generation 0 is the one of the zeroed slots, so that they start out empty
+        *gen = 1;
+    }
+    *entries = newentries;
+    *hashes = (size_t *)(newentries + hashes_offset);
+    *cap = newcap - 1;
 }
-#endif  // EXTLIB_NO_STD
 
-Ext_StringSlice ext_ss_from(const void *mem, size_t size) {
-    return (Ext_StringSlice){size, mem};
+// -----------------------------------------------------------------------------
+// SECTION: Node hashmap
+//
+typedef struct Ext_NmapSlab_ {
+    struct Ext_NmapSlab_ *next;
+    size_t count, used;
+} Ext_NmapSlab_;
+
+#define EXT_NMAP_SLAB_HEADER_ \
+    (sizeof(Ext_NmapSlab_) + EXT_ALIGN(sizeof(Ext_NmapSlab_), EXT_DEFAULT_ALIGNMENT))
+
+// Nodes must be able to hold the free list link
+static size_t ext_nmap_node_size_(size_t entry_sz) {
+    return entry_sz < sizeof(void *) ? sizeof(void *) : entry_sz;
 }
 
-Ext_StringSlice ext_ss_from_cstr(const char *str) {
-    return ext_ss_from(str, strlen(str));
+static char *ext_nmap_slab_nodes_(Ext_NmapSlab_ *slab) {
+    return (char *)slab + EXT_NMAP_SLAB_HEADER_;
 }
 
-Ext_StringSlice ext_ss_split_once(Ext_StringSlice *ss, char delim) {
-    Ext_StringSlice split = {0, ss->data};
-    while(ss->size) {
-        ss->size--;
-        if(*ss->data++ == delim) break;
-        else split.size++;
+void *ext_nmap_alloc_node_(void **slabs, void **free_nodes, size_t entry_sz, Ext_Allocator **a) {
+    if(*free_nodes) {
+        void *node = *free_nodes;
+        memcpy(free_nodes, node, sizeof(void *));
+        return node;
     }
-    return split;
+    size_t node_sz = ext_nmap_node_size_(entry_sz);
+    Ext_NmapSlab_ *slab = *slabs;
+    if(!slab || slab->used == slab->count) {
+        size_t count = EXT_NMAP_INIT_SLAB_NODES;
+        if(slab) count = slab->count * 2 < EXT_NMAP_MAX_SLAB_NODES ? slab->count * 2
+                                                                   : EXT_NMAP_MAX_SLAB_NODES;
+        if(!*a) *a = ext_context->alloc;
+        Ext_NmapSlab_ *newslab = (*a)->alloc(*a, EXT_NMAP_SLAB_HEADER_ + count * node_sz);
+        newslab->next = slab;
+        newslab->count = count;
+        newslab->used = 0;
+        *slabs = slab = newslab;
+    }
+    return ext_nmap_slab_nodes_(slab) + slab->used++ * node_sz;
 }
 
-Ext_StringSlice ext_ss_rsplit_once(Ext_StringSlice *ss, char delim) {
-    Ext_StringSlice split = {0, ss->data + ss->size};
-    while(ss->size) {
-        ss->size--;
-        if(ss->data[ss->size] == delim) break;
-        else split.size++, split.data--;
+void ext_nmap_reset_nodes_(void *slabs, void **free_nodes, size_t entry_sz) {
+    size_t node_sz = ext_nmap_node_size_(entry_sz);
+    *free_nodes = NULL;
+    for(Ext_NmapSlab_ *slab = slabs; slab; slab = slab->next) {
+        char *nodes = ext_nmap_slab_nodes_(slab);
+        for(size_t i = 0; i < slab->used; i++) {
+            ext_nmap_release_node_(free_nodes, nodes + i * node_sz);
+        }
     }
-    return split;
 }
 
-Ext_StringSlice ext_ss_split_once_ws(Ext_StringSlice *ss) {
-    Ext_StringSlice split = {0, ss->data};
-    while(ss->size) {
-        ss->size--;
-        if(isspace(*ss->data++)) break;
-        else split.size++;
-    }
-    while(ss->size && isspace(*ss->data)) {
-        ss->data++;
-        ss->size--;
+void ext_nmap_free_slabs_(void *slabs, size_t entry_sz, Ext_Allocator *a) {
+    size_t node_sz = ext_nmap_node_size_(entry_sz);
+    Ext_NmapSlab_ *slab = slabs;
+    while(slab) {
+        Ext_NmapSlab_ *next = slab->next;
+        a->free(a, slab, EXT_NMAP_SLAB_HEADER_ + slab->count * node_sz);
+        slab = next;
     }
-    return split;
 }
 
-Ext_StringSlice ext_ss_trim_start(Ext_StringSlice ss) {
-    while(ss.size && isspace(*ss.data)) ss.data++, ss.size--;
-    return ss;
+// -----------------------------------------------------------------------------
+// SECTION: Cuckoo hashmap
+//
+// A table is aligned to a cache line inside its block, that has an extra line for the padding.
+// The byte right before the table holds its offset in the block.
+// After the buckets, the table has room for two extra slots: the first holds the entry being
+// inserted, and the second is scratch space to swap it with the entry it evicts.
+
+#define EXT_CKMAP_EXTRA_BUCKETS_ ((2 + EXT_CKMAP_BUCKET_SLOTS - 1) / EXT_CKMAP_BUCKET_SLOTS)
+
+// Sizes in bytes of the buckets of a table, and of the hashes that precede their entries
+typedef struct {
+    size_t entries_sz, bucket_sz, entries_offset;
+} Ext_CkmapLayout_;
+
+static Ext_CkmapLayout_ ext_ckmap_layout_(size_t entries_sz) {
+    Ext_CkmapLayout_ l;
+    l.entries_sz = entries_sz;
+    l.bucket_sz = ext_ckmap_bucket_units_(entries_sz) * entries_sz;
+    l.entries_offset = ext_ckmap_hash_units_(entries_sz) * entries_sz;
+    return l;
 }
 
-Ext_StringSlice ext_ss_trim_end(Ext_StringSlice ss) {
-    while(ss.size && isspace(ss.data[ss.size - 1])) ss.size--;
-    return ss;
+static inline size_t *ext_ckmap_slot_hash_(char *table, const Ext_CkmapLayout_ *l, size_t slot) {
+    return (size_t *)(table + slot / EXT_CKMAP_BUCKET_SLOTS * l->bucket_sz) +
+           slot % EXT_CKMAP_BUCKET_SLOTS;
 }
 
-Ext_StringSlice ext_ss_trim(Ext_StringSlice ss) {
-    return ext_ss_trim_end(ext_ss_trim_start(ss));
+static inline char *ext_ckmap_slot_entry_(char *table, const Ext_CkmapLayout_ *l, size_t slot) {
+    return table + slot / EXT_CKMAP_BUCKET_SLOTS * l->bucket_sz + l->entries_offset +
+           slot % EXT_CKMAP_BUCKET_SLOTS * l->entries_sz;
 }
 
-Ext_StringSlice ext_ss_cut(Ext_StringSlice ss, size_t n) {
-    if(n > ss.size) n = ss.size;
-    ss.data += n;
-    ss.size -= n;
-    return ss;
+static size_t ext_ckmap_block_size_(const Ext_CkmapLayout_ *l, size_t cap) {
+    return (cap + 1 + EXT_CKMAP_EXTRA_BUCKETS_) * l->bucket_sz + EXT_CKMAP_LINE_SIZE;
 }
 
-Ext_StringSlice ext_ss_trunc(Ext_StringSlice ss, size_t n) {
-    if(n > ss.size) n = ss.size;
-    ss.size -= ss.size - n;
-    return ss;
+static char *ext_ckmap_block_(void *table) {
+    return (char *)table - ((unsigned char *)table)[-1];
 }
 
-bool ext_ss_starts_with(Ext_StringSlice ss, Ext_StringSlice prefix) {
-    return prefix.size <= ss.size && memcmp(ss.data, prefix.data, prefix.size) == 0;
+// Aligns a table of `table_sz` bytes inside `block`, moving it there from `offset` if it was
+// already filled, or 0 if it wasn't
+static char *ext_ckmap_align_table_(char *block, size_t offset, size_t table_sz) {
+    size_t pad = EXT_CKMAP_LINE_SIZE - ((uintptr_t)block & (EXT_CKMAP_LINE_SIZE - 1));
+    if(offset && offset != pad) memmove(block + pad, block + offset, table_sz);
+    ((unsigned char *)block)[pad - 1] = (unsigned char)pad;
+    return block + pad;
 }
 
-bool ext_ss_ends_with(Ext_StringSlice ss, Ext_StringSlice suffix) {
-    return suffix.size <= ss.size &&
-           memcmp(&ss.data[ss.size - suffix.size], suffix.data, suffix.size) == 0;
+static bool ext_ckmap_take_free_slot_(char *table, const Ext_CkmapLayout_ *l, size_t bucket,
+                                      size_t spare) {
+    for(size_t i = bucket * EXT_CKMAP_BUCKET_SLOTS; i < (bucket + 1) * EXT_CKMAP_BUCKET_SLOTS;
+        i++) {
+        size_t *hash = ext_ckmap_slot_hash_(table, l, i);
+        if(EXT_HMAP_IS_EMPTY(*hash)) {
+            size_t *spare_hash = ext_ckmap_slot_hash_(table, l, spare);
+            memcpy(ext_ckmap_slot_entry_(table, l, i), ext_ckmap_slot_entry_(table, l, spare),
+                   l->entries_sz);
+            *hash = *spare_hash;
+            *spare_hash = EXT_HMAP_EMPTY_MARK;
+            return true;
+        }
+    }
+    return false;
 }
 
-int ext_ss_cmp(Ext_StringSlice s1, Ext_StringSlice s2) {
-    size_t min_sz = s1.size < s2.size ? s1.size : s2.size;
-    return memcmp(s1.data, s2.data, min_sz);
+// Places the entry in the spare slot in the table, moving other entries around if needed.
+// On failure the spare slot is left holding an entry that couldn't find a place
+static bool ext_ckmap_place_(char *table, const Ext_CkmapLayout_ *l, size_t cap) {
+    size_t spare = EXT_CKMAP_SLOTS_(cap);
+    size_t *spare_hash = ext_ckmap_slot_hash_(table, l, spare);
+    char *spare_entry = ext_ckmap_slot_entry_(table, l, spare);
+    char *tmp_entry = ext_ckmap_slot_entry_(table, l, spare + 1);
+    size_t bucket = *spare_hash & cap;
+    uint32_t rng = (uint32_t)*spare_hash | 1;
+    for(size_t kicks = 0;; kicks++) {
+        size_t hash = *spare_hash;
+        size_t alt = ext_ckmap_alt_bucket_(bucket, hash, cap);
+        if(ext_ckmap_take_free_slot_(table, l, bucket, spare) ||
+           ext_ckmap_take_free_slot_(table, l, alt, spare)) {
+            return true;
+        }
+        if(kicks == EXT_CKMAP_MAX_KICKS) return false;
+        // Evict a random entry of the bucket, and carry it to its other bucket
+        rng ^= rng << 13, rng ^= rng >> 17, rng ^= rng << 5;
+        size_t victim = bucket * EXT_CKMAP_BUCKET_SLOTS + rng % EXT_CKMAP_BUCKET_SLOTS;
+        size_t *victim_hash = ext_ckmap_slot_hash_(table, l, victim);
+        char *victim_entry = ext_ckmap_slot_entry_(table, l, victim);
+        memcpy(tmp_entry, victim_entry, l->entries_sz);
+        memcpy(victim_entry, spare_entry, l->entries_sz);
+        memcpy(spare_entry, tmp_entry, l->entries_sz);
+        *spare_hash = *victim_hash;
+        *victim_hash = hash;
+        bucket = ext_ckmap_alt_bucket_(bucket, *spare_hash, cap);
+    }
 }
 
-bool ext_ss_eq(Ext_StringSlice s1, Ext_StringSlice s2) {
-    return s1.size == s2.size && memcmp(s1.data, s2.data, s1.size) == 0;
+// Moves all entries, including the one in the spare slot, to a new table of `buckets` buckets.
+// The table is doubled again on the unlikely event that an entry doesn't fit
+static void ext_ckmap_rehash_(void **entries, size_t entries_sz, size_t *cap, size_t buckets,
+                              Ext_Allocator **a) {
+    if(!*a) *a = ext_context->alloc;
+    Ext_CkmapLayout_ l = ext_ckmap_layout_(entries_sz);
+    size_t slots = *entries ? EXT_CKMAP_SLOTS_(*cap) + 1 : 0;
+    size_t old_offset = 0, oldsz = 0;
+    void *old = NULL;
+    if(*entries) {
+        old = ext_ckmap_block_(*entries);
+        old_offset = (char *)*entries - (char *)old;
+        oldsz = ext_ckmap_block_size_(&l, *cap);
+    }
+    // Random failures are already very unlikely at the first try. If the table keeps failing
+    // after many doublings, too many keys share the same hash and no size will do
+    size_t max_buckets = buckets * 64;
+    for(;; buckets *= 2) {
+        EXT_ASSERT(buckets < max_buckets, "too many keys with the same hash in cuckoo hashmap");
+        size_t newcap = buckets - 1, spare = EXT_CKMAP_SLOTS_(newcap);
+        size_t totalsz = ext_ckmap_block_size_(&l, newcap);
+        size_t tablesz = totalsz - EXT_CKMAP_LINE_SIZE;
+        char *newblock = ext_hmap_new_table_(*a, &old, oldsz, totalsz);
+        char *oldtable = old ? (char *)old + old_offset : NULL;
+        char *newtable = ext_ckmap_align_table_(newblock, 0, tablesz);
+        for(size_t i = 0; i < buckets + EXT_CKMAP_EXTRA_BUCKETS_; i++) {
+            memset(newtable + i * l.bucket_sz, 0, EXT_CKMAP_BUCKET_SLOTS * sizeof(size_t));
+        }
+        bool placed = true;
+        for(size_t i = 0; i < slots && placed; i++) {
+            size_t hash = *ext_ckmap_slot_hash_(oldtable, &l, i);
+            if(!EXT_HMAP_IS_VALID(hash)) continue;
+            memcpy(ext_ckmap_slot_entry_(newtable, &l, spare),
+                   ext_ckmap_slot_entry_(oldtable, &l, i), entries_sz);
+            *ext_ckmap_slot_hash_(newtable, &l, spare) = hash;
+            placed = ext_ckmap_place_(newtable, &l, newcap);
+        }
+        if(placed) {
+            size_t offset = newtable - newblock;
+            newblock = ext_hmap_replace_table_(*a, old, oldsz, newblock, totalsz);
+            // With LIFO allocators the table was moved down, and may no longer be aligned
+            *entries = ext_ckmap_align_table_(newblock, offset, tablesz);
+            *cap = newcap;
+            return;
+        }
+        if(old && ((*a)->flags & EXT_ALLOCATOR_LIFO)) {
+            // Give back the room taken after the old table
+            old = (*a)->realloc(*a, old, newblock + totalsz - (char *)old, oldsz);
+            *entries = (char *)old + old_offset;
+        } else {
+            (*a)->free(*a, newblock, totalsz);
+        }
+    }
 }
 
-char *ext_ss_to_cstr(Ext_StringSlice ss) {
-    return ext_ss_to_cstr_alloc(ss, ext_context->alloc);
+void ext_ckmap_insert_(void **entries, size_t entries_sz, size_t *cap, size_t size,
+                       const void *entry, size_t hash, Ext_Allocator **a) {
+    if(!*entries) {
+        ext_ckmap_rehash_(entries, entries_sz, cap, EXT_CKMAP_INIT_BUCKETS, a);
+    } else if(size >= EXT_CKMAP_MAX_ENTRY_LOAD(EXT_CKMAP_SLOTS_(*cap))) {
+        ext_ckmap_rehash_(entries, entries_sz, cap, (*cap + 1) * 2, a);
+    }
+    Ext_CkmapLayout_ l = ext_ckmap_layout_(entries_sz);
+    size_t spare = EXT_CKMAP_SLOTS_(*cap);
+    memcpy(ext_ckmap_slot_entry_(*entries, &l, spare), entry, entries_sz);
+    *ext_ckmap_slot_hash_(*entries, &l, spare) = hash;
+    if(!ext_ckmap_place_(*entries, &l, *cap)) {
+        // The rehash takes care of the entry left in the spare slot
+        ext_ckmap_rehash_(entries, entries_sz, cap, (*cap + 1) * 2, a);
+    }
 }
 
-char *ext_ss_to_cstr_temp(Ext_StringSlice ss) {
-    return ext_ss_to_cstr_alloc(ss, &ext_temp_allocator.base);
+void ext_ckmap_reserve_(void **entries, size_t entries_sz, size_t *cap, size_t n,
+                        Ext_Allocator **a) {
+    size_t buckets = *entries ? *cap + 1 : EXT_CKMAP_INIT_BUCKETS;
+    while(EXT_CKMAP_MAX_ENTRY_LOAD(buckets * EXT_CKMAP_BUCKET_SLOTS) < n) {
+        buckets *= 2;
+    }
+    if(!*entries || buckets > *cap + 1) {
+        ext_ckmap_rehash_(entries, entries_sz, cap, buckets, a);
+    }
 }
 
-char *ext_ss_to_cstr_alloc(Ext_StringSlice ss, Ext_Allocator *a) {
-    char *res = a->alloc(a, ss.size + 1);
-    memcpy(res, ss.data, ss.size);
-    res[ss.size] = '\0';
-    return res;
+void ext_ckmap_free_(void *entries, size_t entries_sz, size_t cap, Ext_Allocator *a) {
+    Ext_CkmapLayout_ l = ext_ckmap_layout_(entries_sz);
+    a->free(a, ext_ckmap_block_(entries), ext_ckmap_block_size_(&l, cap));
 }
 
 // -----------------------------------------------------------------------------
-// SECTION: IO
+// SECTION: Parallel hashmap build
 //
-#ifndef EXTLIB_NO_STD
-bool ext_read_entire_file(const char *path, Ext_StringBuffer *sb) {
-    FILE *f = fopen(path, "rb");
-    if(!f) goto error;
-    if(fseek(f, 0, SEEK_END) < 0) goto error;
+// Each partition is handled by the thread `partition % nthreads`, and the array is split in
+// `nthreads` contiguous chunks for hashing and partitioning.
+// Partitioning is a stable counting sort, so that duplicate keys, which always end up in the
+// same partition, are inserted in the order they appear in the input.
 
-    long long size;
-#ifdef EXT_WINDOWS
-     size = _ftelli64(f);
-#else
-     size = ftell(f);
-#endif  // EXT_WINDOWS
-    if(size < 0) goto error;
-    if(fseek(f, 0, SEEK_SET) < 0) goto error;
+// Minimum number of slots of the table range owned by a partition
+#define EXT_HMAP_PARALLEL_MIN_RANGE 1024
 
-    ext_array_reserve_exact(sb, sb->size + size);
-    fread(sb->items + sb->size, 1, size, f);
-    if(ferror(f)) goto error;
-    sb->size = size;
+typedef struct {
+    Ext_HmapFields_ maps;
+    size_t nmaps, stride;
+    bool sharded;
+    size_t entries_sz, hash_sz;
+    const char *arr;
+    size_t n;
+    const void *src_hashes;
+    size_t src_hash_sz;
+    Ext_HmapKey_ key;
+    size_t nthreads, nparts, part_shift;
+    // Hash of each entry of `arr`
+    size_t *hashes;
+    // Indices of the entries of `arr`, sorted by partition
+    size_t *order;
+    // Number of entries of each partition in each chunk, then their offset in `order`
+    size_t *counts;
+    // Start of each partition in `order`
+    size_t *part_start;
+    // Number of entries of each partition that must be inserted at the end, stored at the start
+    // of the partition in `order`
+    size_t *deferred;
+} Ext_HmapBuild_;
 
-    fclose(f);
-    return true;
-error:
-    ext_log(EXT_ERROR, "couldn't read file %s: %s\n", path, strerror(errno));
-    int saved_errno = errno;
-    if(f) fclose(f);
-    errno = saved_errno;
-    return false;
-}
+typedef enum {
+    EXT_HMAP_BUILD_HASH_,
+    EXT_HMAP_BUILD_SCATTER_,
+    EXT_HMAP_BUILD_INSERT_,
+} Ext_HmapBuildPhase_;
 
-bool ext_write_entire_file(const char *path, const void *mem, size_t size) {
-    FILE* f = fopen(path, "wb");
-    if(!f) goto error;
+typedef struct {
+    Ext_HmapBuild_ *b;
+    Ext_HmapBuildPhase_ phase;
+    size_t id;
+    size_t size, tombstones;
+} Ext_HmapBuildJob_;
+
+#define ext_hmap_build_field_(b, field, i) \
+    ((void *)((char *)(b)->maps.field + (i) * (b)->stride))
+
+static size_t ext_hmap_build_hash_(const Ext_HmapBuild_ *b, const char *e) {
+    const char *k = e + b->key.offset;
+    switch(b->key.kind) {
+    case EXT_HMAP_KEY_BYTES_:
+        return ext_hash_bytes_(k, b->key.size);
+    case EXT_HMAP_KEY_CSTR_: {
+        const char *s;
+        memcpy(&s, k, sizeof(s));
+        return ext_hash_cstr_(s);
+    }
+    case EXT_HMAP_KEY_SS_: {
+        Ext_StringSlice ss;
+        memcpy(&ss, k, sizeof(ss));
+        return ext_hash_bytes_(ss.data, ss.size);
+    }
+    case EXT_HMAP_KEY_FN_:
+        return b->key.hash(e);
+    }
+    EXT_UNREACHABLE();
+    return 0;
+}
 
-    const char* data = mem;
-    while(size > 0) {
-        size_t written = fwrite(data, 1, size, f);
-        if (ferror(f)) goto error;
-        size -= written;
-        data += written;
+static int ext_hmap_build_cmp_(const Ext_HmapBuild_ *b, const char *e1, const char *e2) {
+    const char *k1 = e1 + b->key.offset, *k2 = e2 + b->key.offset;
+    switch(b->key.kind) {
+    case EXT_HMAP_KEY_BYTES_:
+        return memcmp(k1, k2, b->key.size);
+    case EXT_HMAP_KEY_CSTR_: {
+        const char *s1, *s2;
+        memcpy(&s1, k1, sizeof(s1));
+        memcpy(&s2, k2, sizeof(s2));
+        return ext_ss_cmp(ext_ss_from_cstr(s1), ext_ss_from_cstr(s2));
+    }
+    case EXT_HMAP_KEY_SS_: {
+        Ext_StringSlice ss1, ss2;
+        memcpy(&ss1, k1, sizeof(ss1));
+        memcpy(&ss2, k2, sizeof(ss2));
+        return ext_ss_cmp(ss1, ss2);
     }
+    case EXT_HMAP_KEY_FN_:
+        return b->key.cmp(e1, e2);
+    }
+    EXT_UNREACHABLE();
+    return 0;
+}
 
-    fclose(f);
-    return true;
-error:
-    ext_log(EXT_ERROR, "couldn't write file %s: %s\n", path, strerror(errno));
-    int saved_errno = errno;
-    if(f) fclose(f);
-    errno = saved_errno;
-    return false;
+static bool ext_hmap_build_is_valid_(const Ext_HmapBuild_ *b, size_t i) {
+    if(!b->src_hashes) return true;
+    return EXT_HMAP_IS_VALID(ext_hmap_get_hash_(b->src_hashes, b->src_hash_sz, i));
 }
-int ext_cmd(const char* cmd) {
-    EXT_ASSERT(cmd, "cmd is NULL");
-    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
-    int res = system(cmd);
-    if(res < 0) {
-        ext_log(EXT_ERROR, "couldn't exec cmd '%s': %s", cmd, strerror(errno));
-        return res;
+
+static size_t ext_hmap_build_partition_(const Ext_HmapBuild_ *b, size_t hash) {
+    if(b->sharded) {
+        return ext_shmap_shard_index_(hash, b->nparts);
     }
-    return res;
+    size_t cap = *b->maps.capacity;
+    return (ext_hmap_fix_hash_width_(hash, b->hash_sz) & cap) >> b->part_shift;
 }
 
-int ext_cmd_read(const char* cmd, Ext_StringBuffer* sb) {
-    EXT_ASSERT(cmd, "cmd is NULL");
-    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
+// Inserts the entry `i` of the array, probing at most `limit` slots from its home slot.
+// Returns false if no free slot or entry with the same key was found within the limit
+static bool ext_hmap_build_insert_(const Ext_HmapBuild_ *b, size_t map, size_t i, size_t limit,
+                                   size_t *size, size_t *tombstones) {
+    char *entries = *(void **)ext_hmap_build_field_(b, entries, map);
+    void *hashes = *(void **)ext_hmap_build_field_(b, hashes, map);
+    size_t cap = *(size_t *)ext_hmap_build_field_(b, capacity, map);
+    const char *entry = b->arr + i * b->entries_sz;
+    size_t hash = ext_hmap_fix_hash_width_(b->hashes[i], b->hash_sz);
+    size_t idx = hash & cap, tomb_idx = SIZE_MAX;
+    for(size_t probes = 0;; probes++, idx = (idx + 1) & cap) {
+        if(probes == limit) return false;
+        size_t buck = ext_hmap_get_hash_(hashes, b->hash_sz, idx);
+        if(EXT_HMAP_IS_EMPTY(buck)) {
+            if(tomb_idx != SIZE_MAX) {
+                idx = tomb_idx;
+                (*tombstones)--;
+            }
+            (*size)++;
+            break;
+        } else if(EXT_HMAP_IS_TOMB(buck)) {
+            if(tomb_idx == SIZE_MAX) tomb_idx = idx;
+        } else if(buck == hash &&
+                  ext_hmap_build_cmp_(b, entry, entries + idx * b->entries_sz) == 0) {
+            break;
+        }
+    }
+    memcpy(entries + idx * b->entries_sz, entry, b->entries_sz);
+    ext_hmap_set_hash_(hashes, b->hash_sz, idx, hash);
+    return true;
+}
 
-    int res = 0;
-#ifdef EXT_WINDOWS
-    const char* mode = "rb";
-#else
-    const char* mode = "r";
-#endif  // EXT_WINDOWS
-    FILE* p = popen(cmd, mode);
-    if(!p) {
-        res = -1;
-        goto error;
+// Makes sure map `map` can take `n` more entries without growing
+static void ext_hmap_build_reserve_(const Ext_HmapBuild_ *b, size_t map, size_t n) {
+    void **entries = ext_hmap_build_field_(b, entries, map);
+    void **hashes = ext_hmap_build_field_(b, hashes, map);
+    size_t *size = ext_hmap_build_field_(b, size, map);
+    size_t *tombstones = ext_hmap_build_field_(b, tombstones, map);
+    size_t *cap = ext_hmap_build_field_(b, capacity, map);
+    Ext_Allocator **a = ext_hmap_build_field_(b, allocator, map);
+    if(!*entries || *size + *tombstones + n > EXT_HMAP_MAX_ENTRY_LOAD(*cap + 1)) {
+        // Also purges the tombstones
+        ext_hmap_reserve_(entries, b->entries_sz, hashes, b->hash_sz, cap, *size + n, a);
+        *tombstones = 0;
     }
+}
 
-    const size_t chunk_size = 512;
-    for(;;) {
-        ext_array_reserve(sb, sb->size + chunk_size);
-        size_t read = fread(sb->items + sb->size, 1, sb->capacity - sb->size, p);
-        sb->size += read;
-        if(ferror(p)) {
-            res = -1;
-            goto error;
+static void ext_hmap_build_chunk_(size_t n, size_t nthreads, size_t id, size_t *start,
+                                  size_t *end) {
+    *start = n / nthreads * id + (id < n % nthreads ? id : n % nthreads);
+    *end = *start + n / nthreads + (id < n % nthreads);
+}
+
+static void ext_hmap_build_job_(void *arg) {
+    Ext_HmapBuildJob_ *job = arg;
+    Ext_HmapBuild_ *b = job->b;
+    size_t *counts = b->counts + job->id * b->nparts;
+    size_t start, end;
+    ext_hmap_build_chunk_(b->n, b->nthreads, job->id, &start, &end);
+    switch(job->phase) {
+    case EXT_HMAP_BUILD_HASH_:
+        for(size_t i = start; i < end; i++) {
+            if(!ext_hmap_build_is_valid_(b, i)) continue;
+            if(b->src_hashes && b->src_hash_sz >= b->hash_sz) {
+                b->hashes[i] = ext_hmap_get_hash_(b->src_hashes, b->src_hash_sz, i);
+            } else {
+                b->hashes[i] = ext_hmap_build_hash_(b, b->arr + i * b->entries_sz);
+            }
+            counts[ext_hmap_build_partition_(b, b->hashes[i])]++;
         }
-        if(feof(p)) break;
+        break;
+    case EXT_HMAP_BUILD_SCATTER_:
+        for(size_t i = start; i < end; i++) {
+            if(!ext_hmap_build_is_valid_(b, i)) continue;
+            b->order[counts[ext_hmap_build_partition_(b, b->hashes[i])]++] = i;
+        }
+        break;
+    case EXT_HMAP_BUILD_INSERT_:
+        for(size_t p = job->id; p < b->nparts; p += b->nthreads) {
+            size_t *part = b->order + b->part_start[p];
+            size_t part_n = b->part_start[p + 1] - b->part_start[p];
+            if(b->sharded) {
+                // The partition is a whole shard
+                ext_hmap_build_reserve_(b, p, part_n);
+                size_t *size = ext_hmap_build_field_(b, size, p);
+                size_t *tombstones = ext_hmap_build_field_(b, tombstones, p);
+                size_t cap = *(size_t *)ext_hmap_build_field_(b, capacity, p);
+                for(size_t j = 0; j < part_n; j++) {
+                    ext_hmap_build_insert_(b, p, part[j], cap + 1, size, tombstones);
+                }
+            } else {
+                size_t cap = *b->maps.capacity;
+                size_t range_end = (p + 1) << b->part_shift;
+                for(size_t j = 0; j < part_n; j++) {
+                    size_t home = ext_hmap_fix_hash_width_(b->hashes[part[j]], b->hash_sz) & cap;
+                    if(!ext_hmap_build_insert_(b, 0, part[j], range_end - home, &job->size,
+                                               &job->tombstones)) {
+                        part[b->deferred[p]++] = part[j];
+                    }
+                }
+            }
+        }
+        break;
     }
+}
 
-    res = pclose(p);
-    if(res < 0) goto error;
-    return res;
-error:
-    ext_log(EXT_ERROR, "couldn't exec cmd '%s' for read: %s\n", cmd, strerror(errno));
-    int saved_errno = errno;
-    if(p) pclose(p);
-    errno = saved_errno;
-    return -1;
+static void ext_hmap_build_run_(Ext_HmapBuild_ *b, Ext_HmapBuildJob_ *jobs, Ext_Thread *threads,
+                                Ext_HmapBuildPhase_ phase) {
+    for(size_t t = 0; t < b->nthreads; t++) {
+        jobs[t].phase = phase;
+        ext_thread_create(&threads[t], ext_hmap_build_job_, &jobs[t]);
+    }
+    for(size_t t = 0; t < b->nthreads; t++) {
+        ext_thread_join(&threads[t]);
+    }
 }
 
-int ext_cmd_write(const char* cmd, const void* mem, size_t size) {
-    EXT_ASSERT(cmd, "cmd is NULL");
-    ext_log(EXT_INFO, "[CMD] %s\n", cmd);
+void ext_hmap_build_parallel_(Ext_HmapFields_ maps, size_t nmaps, size_t stride, bool sharded,
+                              size_t entries_sz, size_t hash_sz, const void *arr, size_t n,
+                              size_t nvalid, const void *src_hashes, size_t src_hash_sz,
+                              Ext_HmapKey_ key, size_t nthreads) {
+    EXT_ASSERT(nthreads > 0, "at least one thread is needed");
+    if(!*maps.allocator) *maps.allocator = ext_context->alloc;
+    Ext_Allocator *a = *maps.allocator;
+    if(nthreads > n) nthreads = n;
+
+    Ext_HmapBuild_ b = {
+        .maps = maps,
+        .nmaps = nmaps,
+        .stride = stride,
+        .sharded = sharded,
+        .entries_sz = entries_sz,
+        .hash_sz = hash_sz,
+        .arr = arr,
+        .n = n,
+        .src_hashes = src_hashes,
+        .src_hash_sz = src_hash_sz,
+        .key = key,
+        .nthreads = nthreads,
+    };
 
-    int res = 0;
-#ifdef EXT_WINDOWS
-    const char* mode = "wb";
-#else
-    const char* mode = "w";
-#endif  // EXT_WINDOWS
-    FILE* p = popen(cmd, mode);
-    if(!p)  {
-        res = -1;
-        goto error;
+    if(sharded) {
+        b.nparts = nmaps;
+    } else {
+        ext_hmap_build_reserve_(&b, 0, nvalid);
+        // Aim for a few partitions per thread, each one owning a large enough range of the table
+        size_t slots = *maps.capacity + 1, cap_bits = 0;
+        while(((size_t)1 << cap_bits) < slots) cap_bits++;
+        b.nparts = 1;
+        b.part_shift = cap_bits;
+        while(b.nparts < nthreads * 4 && slots / (b.nparts * 2) >= EXT_HMAP_PARALLEL_MIN_RANGE) {
+            b.nparts *= 2;
+            b.part_shift--;
+        }
     }
-    
-    const char* data = mem;
-    while(size > 0) {
-        size_t written = fwrite(data, 1, size, p);
-        if (ferror(p)) {
-            res = -1;
-            goto error;
+
+    size_t scratch_sz = sizeof(size_t) * (2 * n + nthreads * b.nparts + 2 * b.nparts + 1) +
+                        sizeof(Ext_Thread) * nthreads + sizeof(Ext_HmapBuildJob_) * nthreads;
+    size_t *scratch = a->alloc(a, scratch_sz);
+    memset(scratch, 0, scratch_sz);
+    b.hashes = scratch;
+    b.order = b.hashes + n;
+    b.counts = b.order + n;
+    b.part_start = b.counts + nthreads * b.nparts;
+    b.deferred = b.part_start + b.nparts + 1;
+    Ext_Thread *threads = (Ext_Thread *)(b.deferred + b.nparts);
+    Ext_HmapBuildJob_ *jobs = (Ext_HmapBuildJob_ *)(threads + nthreads);
+    for(size_t t = 0; t < nthreads; t++) {
+        jobs[t] = (Ext_HmapBuildJob_){.b = &b, .id = t};
+    }
+
+    ext_hmap_build_run_(&b, jobs, threads, EXT_HMAP_BUILD_HASH_);
+
+    // Turn the counts of each chunk into offsets in `order`, partition by partition, so that
+    // entries keep their input order within a partition
+    size_t offset = 0;
+    for(size_t p = 0; p < b.nparts; p++) {
+        b.part_start[p] = offset;
+        for(size_t t = 0; t < nthreads; t++) {
+            size_t count = b.counts[t * b.nparts + p];
+            b.counts[t * b.nparts + p] = offset;
+            offset += count;
         }
-        size -= written;
-        data += written;
     }
+    b.part_start[b.nparts] = offset;
 
-    res = pclose(p);
-    if (res < 0) goto error;
-    return res;
-error:
-    ext_log(EXT_ERROR, "couldn't exec cmd '%s' for write: %s\n", cmd, strerror(errno));
-    int saved_errno = errno;
-    if(p) pclose(p);
-    errno = saved_errno;
-    return -1;
-}
-#endif  // EXTLIB_NO_STD
+    ext_hmap_build_run_(&b, jobs, threads, EXT_HMAP_BUILD_SCATTER_);
+    ext_hmap_build_run_(&b, jobs, threads, EXT_HMAP_BUILD_INSERT_);
 
-// -----------------------------------------------------------------------------
-// SECTION: Hashmap
-//
-void ext_hmap_grow_(void **entries, size_t entries_sz, size_t **hashes, size_t *cap,
-                    Ext_Allocator **a) {
-    size_t newcap = *cap ? (*cap + 1) * 2 : EXT_HMAP_INIT_CAPACITY;
-    size_t newsz = newcap * entries_sz;
-    size_t pad = EXT_ALIGN(newsz, sizeof(size_t));
-    size_t totalsz = newsz + pad + sizeof(size_t) * newcap;
-    if(!*a) *a = ext_context->alloc;
-    void *newentries = (*a)->alloc(*a, totalsz);
-    size_t *newhashes = (size_t *)((char *)newentries + newsz + pad);
-    EXT_ASSERT(((uintptr_t)newhashes & (sizeof(size_t) - 1)) == 0,
-               "newhashes allocation is not aligned");
-    memset(newhashes, 0, sizeof(size_t) * newcap);
-    if(*cap > 0) {
-        for(size_t i = 0; i <= *cap; i++) {
-            size_t hash = (*hashes)[i];
-            if(EXT_HMAP_IS_VALID(hash)) {
-                size_t newidx = hash & (newcap - 1);
-                while(!EXT_HMAP_IS_EMPTY(newhashes[newidx])) {
-                    newidx = (newidx + 1) & (newcap - 1);
-                }
-                memcpy((char *)newentries + newidx * entries_sz,
-                       (char *)(*entries) + i * entries_sz, entries_sz);
-                newhashes[newidx] = hash;
+    if(!sharded) {
+        for(size_t t = 0; t < nthreads; t++) {
+            *maps.size += jobs[t].size;
+            *maps.tombstones += jobs[t].tombstones;
+        }
+        // The table is complete except for the deferred entries, so they can be inserted with
+        // regular probing
+        size_t cap = *maps.capacity;
+        for(size_t p = 0; p < b.nparts; p++) {
+            for(size_t j = 0; j < b.deferred[p]; j++) {
+                ext_hmap_build_insert_(&b, 0, b.order[b.part_start[p] + j], cap + 1, maps.size,
+                                       maps.tombstones);
             }
         }
     }
-    if(*entries) {
-        size_t sz = (*cap + 1) * entries_sz;
-        size_t pad = EXT_ALIGN(sz, sizeof(size_t));
-        size_t totalsz = sz + pad + sizeof(size_t) * (*cap + 1);
-        (*a)->free(*a, *entries, totalsz);
-    }
-    *entries = newentries;
-    *hashes = newhashes;
-    *cap = newcap - 1;
+
+    a->free(a, scratch, scratch_sz);
 }
 #endif  // EXTLIB_IMPL
 
@@ -2338,6 +7390,7 @@ static inline int ext_dbg_unknown(const char *name, const char *file, int line,
 #define ALIGN         EXT_ALIGN
 #define ARR_SIZE      EXT_ARR_SIZE
 #define PRINTF_FORMAT EXT_PRINTF_FORMAT
+#define PREFETCH      EXT_PREFETCH
 
 #define INFO       EXT_INFO
 #define WARNING    EXT_WARNING
@@ -2349,6 +7402,18 @@ typedef Ext_Context Context;
 #define push_context ext_push_context
 #define pop_context  ext_pop_context
 
+typedef Ext_Mutex Mutex;
+#define mutex_init    ext_mutex_init
+#define mutex_destroy ext_mutex_destroy
+#define mutex_lock    ext_mutex_lock
+#define mutex_unlock  ext_mutex_unlock
+
+typedef Ext_ThreadFn ThreadFn;
+typedef Ext_Thread Thread;
+#define thread_create ext_thread_create
+#define thread_join   ext_thread_join
+
+typedef Ext_AllocatorFlags AllocatorFlags;
 typedef Ext_Allocator Allocator;
 typedef Ext_DefaultAllocator DefaultAllocator;
 
@@ -2386,6 +7451,42 @@ typedef Ext_ArenaCheckpoint ArenaCheckpoint;
 #define arena_vsprintf ext_arena_vsprintf
 #endif  // EXTLIB_NO_STD
 
+typedef Ext_ConcurrentArena ConcurrentArena;
+typedef Ext_ConcurrentArenaPage ConcurrentArenaPage;
+#define new_concurrent_arena     ext_new_concurrent_arena
+#define concurrent_arena_alloc   ext_concurrent_arena_alloc
+#define concurrent_arena_realloc ext_concurrent_arena_realloc
+#define concurrent_arena_free    ext_concurrent_arena_free
+#define concurrent_arena_reset   ext_concurrent_arena_reset
+#define concurrent_arena_destroy ext_concurrent_arena_destroy
+
+typedef Ext_Pool Pool;
+typedef Ext_PoolSlab PoolSlab;
+#define new_pool     ext_new_pool
+#define pool_alloc   ext_pool_alloc
+#define pool_realloc ext_pool_realloc
+#define pool_free    ext_pool_free
+#define pool_reset   ext_pool_reset
+#define pool_destroy ext_pool_destroy
+
+typedef Ext_SlabAllocator SlabAllocator;
+#define new_slab_allocator     ext_new_slab_allocator
+#define slab_alloc             ext_slab_alloc
+#define slab_realloc           ext_slab_realloc
+#define slab_free              ext_slab_free
+#define slab_allocator_destroy ext_slab_allocator_destroy
+#define slab_block_size        ext_slab_block_size
+
+typedef Ext_CentralHeap CentralHeap;
+typedef Ext_ThreadCache ThreadCache;
+#define central_heap_init      ext_central_heap_init
+#define central_heap_destroy   ext_central_heap_destroy
+#define thread_cache_init      ext_thread_cache_init
+#define thread_cache_alloc     ext_thread_cache_alloc
+#define thread_cache_realloc   ext_thread_cache_realloc
+#define thread_cache_free      ext_thread_cache_free
+#define thread_cache_flush     ext_thread_cache_flush
+
 #define array_foreach       ext_array_foreach
 #define array_reserve       ext_array_reserve
 #define array_reserve_exact ext_array_reserve_exact
@@ -2444,21 +7545,211 @@ typedef Ext_StringSlice StringSlice;
 #define cmd_read          ext_cmd_read
 #define cmd_write         ext_cmd_write
 
-#define hmap_foreach     ext_hmap_foreach
-#define hmap_end         ext_hmap_end
-#define hmap_begin       ext_hmap_begin
-#define hmap_next        ext_hmap_next
-#define hmap_put         ext_hmap_put
-#define hmap_get         ext_hmap_get
-#define hmap_delete      ext_hmap_delete
-#define hmap_put_cstr    ext_hmap_put_cstr
-#define hmap_get_cstr    ext_hmap_get_cstr
-#define hmap_delete_cstr ext_hmap_delete_cstr
-#define hmap_put_ss      ext_hmap_put_ss
-#define hmap_get_ss      ext_hmap_get_ss
-#define hmap_delete_ss   ext_hmap_delete_ss
-#define hmap_clear       ext_hmap_clear
-#define hmap_free        ext_hmap_free
+typedef Ext_HmapStats HmapStats;
+#define hmap_foreach        ext_hmap_foreach
+#define hmap_end            ext_hmap_end
+#define hmap_begin          ext_hmap_begin
+#define hmap_next           ext_hmap_next
+#define hmap_put            ext_hmap_put
+#define hmap_get            ext_hmap_get
+#define hmap_delete         ext_hmap_delete
+#define hmap_put_cstr       ext_hmap_put_cstr
+#define hmap_get_cstr       ext_hmap_get_cstr
+#define hmap_delete_cstr    ext_hmap_delete_cstr
+#define hmap_put_ss         ext_hmap_put_ss
+#define hmap_get_ss         ext_hmap_get_ss
+#define hmap_delete_ss      ext_hmap_delete_ss
+#define hmap_clear          ext_hmap_clear
+#define hmap_compact        ext_hmap_compact
+#define hmap_shrink_to_fit  ext_hmap_shrink_to_fit
+#define hmap_reserve        ext_hmap_reserve
+#define hmap_entry          ext_hmap_entry
+#define hmap_entry_cstr     ext_hmap_entry_cstr
+#define hmap_entry_ss       ext_hmap_entry_ss
+#define hmap_put_all        ext_hmap_put_all
+#define hmap_put_all_cstr   ext_hmap_put_all_cstr
+#define hmap_put_all_ss     ext_hmap_put_all_ss
+#define hmap_get_batch      ext_hmap_get_batch
+#define hmap_get_batch_cstr ext_hmap_get_batch_cstr
+#define hmap_get_batch_ss   ext_hmap_get_batch_ss
+#define hmap_free           ext_hmap_free
+#define hmap_stats          ext_hmap_stats
+#ifdef EXT_HMAP_PROBE_COUNTERS
+typedef Ext_HmapCounters HmapCounters;
+#define hmap_counters       ext_hmap_counters
+#define hmap_reset_counters ext_hmap_reset_counters
+#endif  // EXT_HMAP_PROBE_COUNTERS
+
+#define rhmap_foreach     ext_rhmap_foreach
+#define rhmap_end         ext_rhmap_end
+#define rhmap_begin       ext_rhmap_begin
+#define rhmap_next        ext_rhmap_next
+#define rhmap_put         ext_rhmap_put
+#define rhmap_get         ext_rhmap_get
+#define rhmap_delete      ext_rhmap_delete
+#define rhmap_put_cstr    ext_rhmap_put_cstr
+#define rhmap_get_cstr    ext_rhmap_get_cstr
+#define rhmap_delete_cstr ext_rhmap_delete_cstr
+#define rhmap_put_ss      ext_rhmap_put_ss
+#define rhmap_get_ss      ext_rhmap_get_ss
+#define rhmap_delete_ss   ext_rhmap_delete_ss
+#define rhmap_clear       ext_rhmap_clear
+#define rhmap_free        ext_rhmap_free
+
+#define ihmap_foreach     ext_ihmap_foreach
+#define ihmap_end         ext_ihmap_end
+#define ihmap_begin       ext_ihmap_begin
+#define ihmap_next        ext_ihmap_next
+#define ihmap_put         ext_ihmap_put
+#define ihmap_get         ext_ihmap_get
+#define ihmap_delete      ext_ihmap_delete
+#define ihmap_put_cstr    ext_ihmap_put_cstr
+#define ihmap_get_cstr    ext_ihmap_get_cstr
+#define ihmap_delete_cstr ext_ihmap_delete_cstr
+#define ihmap_put_ss      ext_ihmap_put_ss
+#define ihmap_get_ss      ext_ihmap_get_ss
+#define ihmap_delete_ss   ext_ihmap_delete_ss
+#define ihmap_clear       ext_ihmap_clear
+#define ihmap_free        ext_ihmap_free
+
+#define shmap_init        ext_shmap_init
+#define shmap_foreach     ext_shmap_foreach
+#define shmap_put         ext_shmap_put
+#define shmap_get         ext_shmap_get
+#define shmap_delete      ext_shmap_delete
+#define shmap_put_cstr    ext_shmap_put_cstr
+#define shmap_get_cstr    ext_shmap_get_cstr
+#define shmap_delete_cstr ext_shmap_delete_cstr
+#define shmap_put_ss      ext_shmap_put_ss
+#define shmap_get_ss      ext_shmap_get_ss
+#define shmap_delete_ss   ext_shmap_delete_ss
+#define shmap_size        ext_shmap_size
+#define shmap_clear       ext_shmap_clear
+#define shmap_free        ext_shmap_free
+
+#define swmap_foreach     ext_swmap_foreach
+#define swmap_end         ext_swmap_end
+#define swmap_begin       ext_swmap_begin
+#define swmap_next        ext_swmap_next
+#define swmap_put         ext_swmap_put
+#define swmap_get         ext_swmap_get
+#define swmap_delete      ext_swmap_delete
+#define swmap_put_cstr    ext_swmap_put_cstr
+#define swmap_get_cstr    ext_swmap_get_cstr
+#define swmap_delete_cstr ext_swmap_delete_cstr
+#define swmap_put_ss      ext_swmap_put_ss
+#define swmap_get_ss      ext_swmap_get_ss
+#define swmap_delete_ss   ext_swmap_delete_ss
+#define swmap_clear       ext_swmap_clear
+#define swmap_free        ext_swmap_free
+
+#define dmap_foreach     ext_dmap_foreach
+#define dmap_end         ext_dmap_end
+#define dmap_begin       ext_dmap_begin
+#define dmap_next        ext_dmap_next
+#define dmap_put         ext_dmap_put
+#define dmap_get         ext_dmap_get
+#define dmap_delete      ext_dmap_delete
+#define dmap_put_cstr    ext_dmap_put_cstr
+#define dmap_get_cstr    ext_dmap_get_cstr
+#define dmap_delete_cstr ext_dmap_delete_cstr
+#define dmap_put_ss      ext_dmap_put_ss
+#define dmap_get_ss      ext_dmap_get_ss
+#define dmap_delete_ss   ext_dmap_delete_ss
+#define dmap_clear       ext_dmap_clear
+#define dmap_free        ext_dmap_free
+
+#define hset_foreach       ext_hset_foreach
+#define hset_end           ext_hset_end
+#define hset_begin         ext_hset_begin
+#define hset_next          ext_hset_next
+#define hset_add           ext_hset_add
+#define hset_contains      ext_hset_contains
+#define hset_remove        ext_hset_remove
+#define hset_add_cstr      ext_hset_add_cstr
+#define hset_contains_cstr ext_hset_contains_cstr
+#define hset_remove_cstr   ext_hset_remove_cstr
+#define hset_add_ss        ext_hset_add_ss
+#define hset_contains_ss   ext_hset_contains_ss
+#define hset_remove_ss     ext_hset_remove_ss
+#define hset_clear         ext_hset_clear
+#define hset_reserve       ext_hset_reserve
+#define hset_free          ext_hset_free
+
+#define iset_foreach  ext_iset_foreach
+#define iset_end      ext_iset_end
+#define iset_begin    ext_iset_begin
+#define iset_next     ext_iset_next
+#define iset_add      ext_iset_add
+#define iset_contains ext_iset_contains
+#define iset_remove   ext_iset_remove
+#define iset_reserve  ext_iset_reserve
+#define iset_clear    ext_iset_clear
+#define iset_free     ext_iset_free
+
+#define ghmap_foreach     ext_ghmap_foreach
+#define ghmap_end         ext_ghmap_end
+#define ghmap_begin       ext_ghmap_begin
+#define ghmap_next        ext_ghmap_next
+#define ghmap_put         ext_ghmap_put
+#define ghmap_get         ext_ghmap_get
+#define ghmap_delete      ext_ghmap_delete
+#define ghmap_put_cstr    ext_ghmap_put_cstr
+#define ghmap_get_cstr    ext_ghmap_get_cstr
+#define ghmap_delete_cstr ext_ghmap_delete_cstr
+#define ghmap_put_ss      ext_ghmap_put_ss
+#define ghmap_get_ss      ext_ghmap_get_ss
+#define ghmap_delete_ss   ext_ghmap_delete_ss
+#define ghmap_clear       ext_ghmap_clear
+#define ghmap_free        ext_ghmap_free
+
+#define nmap_foreach     ext_nmap_foreach
+#define nmap_end         ext_nmap_end
+#define nmap_begin       ext_nmap_begin
+#define nmap_next        ext_nmap_next
+#define nmap_put         ext_nmap_put
+#define nmap_get         ext_nmap_get
+#define nmap_delete      ext_nmap_delete
+#define nmap_put_cstr    ext_nmap_put_cstr
+#define nmap_get_cstr    ext_nmap_get_cstr
+#define nmap_delete_cstr ext_nmap_delete_cstr
+#define nmap_put_ss      ext_nmap_put_ss
+#define nmap_get_ss      ext_nmap_get_ss
+#define nmap_delete_ss   ext_nmap_delete_ss
+#define nmap_clear       ext_nmap_clear
+#define nmap_free        ext_nmap_free
+
+#define ckmap_foreach     ext_ckmap_foreach
+#define ckmap_end         ext_ckmap_end
+#define ckmap_begin       ext_ckmap_begin
+#define ckmap_next        ext_ckmap_next
+#define ckmap_put         ext_ckmap_put
+#define ckmap_get         ext_ckmap_get
+#define ckmap_delete      ext_ckmap_delete
+#define ckmap_put_cstr    ext_ckmap_put_cstr
+#define ckmap_get_cstr    ext_ckmap_get_cstr
+#define ckmap_delete_cstr ext_ckmap_delete_cstr
+#define ckmap_put_ss      ext_ckmap_put_ss
+#define ckmap_get_ss      ext_ckmap_get_ss
+#define ckmap_delete_ss   ext_ckmap_delete_ss
+#define ckmap_reserve     ext_ckmap_reserve
+#define ckmap_clear       ext_ckmap_clear
+#define ckmap_free        ext_ckmap_free
+
+typedef Ext_HmapHashFn HmapHashFn;
+typedef Ext_HmapCmpFn HmapCmpFn;
+#define hmap_put_all_parallel       ext_hmap_put_all_parallel
+#define hmap_put_all_parallel_cstr  ext_hmap_put_all_parallel_cstr
+#define hmap_put_all_parallel_ss    ext_hmap_put_all_parallel_ss
+#define hmap_put_all_parallel_ex    ext_hmap_put_all_parallel_ex
+#define hmap_merge_parallel         ext_hmap_merge_parallel
+#define hmap_merge_parallel_cstr    ext_hmap_merge_parallel_cstr
+#define hmap_merge_parallel_ss      ext_hmap_merge_parallel_ss
+#define hmap_merge_parallel_ex      ext_hmap_merge_parallel_ex
+#define shmap_put_all_parallel      ext_shmap_put_all_parallel
+#define shmap_put_all_parallel_cstr ext_shmap_put_all_parallel_cstr
+#define shmap_put_all_parallel_ss   ext_shmap_put_all_parallel_ss
+#define shmap_put_all_parallel_ex   ext_shmap_put_all_parallel_ex
 #endif  // EXTLIB_NO_SHORTHANDS
 
 #endif  // EXTLIB_H
@@ -14,7 +14,7 @@ typedef struct {
 typedef struct {
     IntEntry *entries;
     size_t *hashes;
-    size_t size, capacity;
+    size_t size, tombstones, capacity;
     Allocator *allocator;
 } IntHashMap;
 
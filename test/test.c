@@ -13,32 +13,42 @@
 #include "../extlib.h"
 
 size_t allocated;
+// Allocations can come from worker threads when the suite is built with EXTLIB_THREADSAFE
+Mutex allocated_lock;
 
 void* tracking_alloc(Allocator* a, size_t size) {
     (void)a;
+    mutex_lock(&allocated_lock);
     allocated += size;
-    return ext_default_allocator.base.alloc(ext_context->prev->alloc, size);
+    mutex_unlock(&allocated_lock);
+    return ext_default_allocator.base.alloc(&ext_default_allocator.base, size);
 }
 
 void* tracking_realloc(Allocator* a, void* ptr, size_t old_sz, size_t new_sz) {
     (void)a;
+    mutex_lock(&allocated_lock);
     allocated += (int)new_sz - (int)old_sz;
-    return ext_default_allocator.base.realloc(ext_context->prev->alloc, ptr, old_sz, new_sz);
+    mutex_unlock(&allocated_lock);
+    return ext_default_allocator.base.realloc(&ext_default_allocator.base, ptr, old_sz, new_sz);
 }
 
 void tracking_free(Allocator* a, void* ptr, size_t size) {
     (void)a;
+    mutex_lock(&allocated_lock);
     allocated -= size;
-    ext_default_allocator.base.free(ext_context->prev->alloc, ptr, size);
+    mutex_unlock(&allocated_lock);
+    ext_default_allocator.base.free(&ext_default_allocator.base, ptr, size);
 }
 
 Allocator tracking_allocator = {
     tracking_alloc,
     tracking_realloc,
     tracking_free,
+    0,
 };
 
 int main(int argc, const char** argv) {
+    mutex_init(&allocated_lock);
     Context ctx = *ext_context;
     ctx.alloc = &tracking_allocator;
     push_context(&ctx);
@@ -192,7 +202,7 @@ void noop_free(Allocator* a, void* ptr, size_t size) {
     ASSERT_TRUE(allocator->noop);
 }
 
-NoopAlloc noop_allocator = {{noop_alloc, noop_realloc, noop_free}, true};
+NoopAlloc noop_allocator = {{noop_alloc, noop_realloc, noop_free, 0}, true};
 
 CTEST(context, push_pop) {
     Context ctx = *ext_context;
@@ -362,6 +372,395 @@ CTEST(arena, checkpoint) {
     temp_reset();
 }
 
+#ifdef EXT_POSIX
+CTEST(arena, virtual_growth) {
+    Arena a = new_arena(NULL, 0, 0, EXT_ARENA_VIRTUAL);
+    size_t size = sizeof(int);
+    int* mem = arena_alloc(&a, size);
+    *mem = 42;
+    for(size_t new_size = size * 2; new_size <= 64 * 1024 * 1024; new_size *= 2) {
+        int* new_mem = arena_realloc(&a, mem, size, new_size);
+        ASSERT_TRUE(new_mem == mem);
+        new_mem[new_size / sizeof(int) - 1] = (int)new_size;
+        size = new_size;
+    }
+    ASSERT_TRUE(*mem == 42);
+    ASSERT_TRUE(a.first_page == a.last_page && a.first_page->next == NULL);
+    ASSERT_TRUE(a.allocated == size);
+    // Pages come from the OS, not the page allocator
+    ASSERT_TRUE(allocated == 0);
+
+    int* next = arena_alloc(&a, sizeof(int));
+    ASSERT_TRUE((char*)next == (char*)mem + size);
+    arena_destroy(&a);
+    ASSERT_TRUE(a.first_page == NULL && a.allocated == 0);
+}
+
+CTEST(arena, virtual_decommit) {
+    Arena a = new_arena(NULL, 0, 0, EXT_ARENA_VIRTUAL | EXT_ARENA_DECOMMIT);
+    char* small = arena_alloc(&a, 16);
+    memset(small, 'a', 16);
+    ArenaCheckpoint c = arena_checkpoint(&a);
+
+    char* big = arena_alloc(&a, 8 * 1024 * 1024);
+    memset(big, 'b', 8 * 1024 * 1024);
+    char* committed = a.last_page->end;
+    arena_rewind(&a, c);
+    ASSERT_TRUE(a.allocated == c.allocated);
+    ASSERT_TRUE(a.last_page->end < committed);
+    ASSERT_TRUE(a.last_page->end - a.last_page->start < 1024 * 1024);
+    ASSERT_TRUE(small[15] == 'a');
+
+    // Decommitted memory is committed again and reads as zero
+    char* again = arena_alloc(&a, 8 * 1024 * 1024);
+    ASSERT_TRUE(again == big);
+    ASSERT_TRUE(again[8 * 1024 * 1024 - 1] == 0);
+
+    arena_reset(&a);
+    ASSERT_TRUE(a.allocated == 0);
+    ASSERT_TRUE(a.last_page->end - a.last_page->start < 1024 * 1024);
+    small = arena_alloc(&a, 16);
+    ASSERT_TRUE(small != NULL);
+    arena_destroy(&a);
+}
+#endif  // EXT_POSIX
+
+CTEST(concurrent_arena, alloc_realloc_free) {
+    ConcurrentArena a = new_concurrent_arena(NULL, 0, 0);
+    int* i = concurrent_arena_alloc(&a, sizeof(int));
+    *i = 42;
+    ASSERT_TRUE(a.allocated == sizeof(int) + EXT_ALIGN(sizeof(int), a.alignment));
+    int* new_i = concurrent_arena_realloc(&a, i, sizeof(int), sizeof(int) * 20);
+    ASSERT_TRUE(i == new_i && *new_i == 42);
+    ASSERT_TRUE(a.allocated == sizeof(int) * 20);
+
+    concurrent_arena_alloc(&a, sizeof(int));
+    new_i = concurrent_arena_realloc(&a, i, sizeof(int) * 20, sizeof(int) * 100);
+    ASSERT_TRUE(new_i != i && *new_i == 42);
+
+    size_t before = a.allocated;
+    concurrent_arena_free(&a, new_i, sizeof(int) * 100);
+    ASSERT_TRUE(a.allocated == before - sizeof(int) * 100);
+    // Not the last allocation, nothing to free
+    concurrent_arena_free(&a, i, sizeof(int) * 20);
+    ASSERT_TRUE(a.allocated == before - sizeof(int) * 100);
+
+    concurrent_arena_destroy(&a);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(concurrent_arena, pages) {
+    ConcurrentArena a = new_concurrent_arena(NULL, 0, 1024);
+    for(int i = 0; i < 1000; i++) {
+        int* p = concurrent_arena_alloc(&a, sizeof(int) * 10);
+        ASSERT_TRUE(EXT_ALIGN(p, a.alignment) == 0);
+        p[9] = i;
+    }
+    ASSERT_TRUE(a.page->next != NULL);
+    char* big = concurrent_arena_alloc(&a, 10000);
+    memset(big, 0, 10000);
+    ASSERT_TRUE(a.large_pages != NULL && a.large_pages->start == big);
+
+    concurrent_arena_reset(&a);
+    ASSERT_TRUE(a.allocated == 0);
+    ASSERT_TRUE(a.page->next == NULL && a.large_pages == NULL);
+    concurrent_arena_destroy(&a);
+    ASSERT_TRUE(allocated == 0);
+}
+
+typedef struct {
+    ConcurrentArena* arena;
+    int** results;
+    int id;
+} ArenaWorker;
+
+static void arena_worker(void* arg) {
+    ArenaWorker* w = arg;
+    Context ctx = *ext_context;
+    ctx.alloc = &w->arena->base;
+    push_context(&ctx);
+    for(int i = 0; i < 1000; i++) {
+        int* p = ext_alloc(sizeof(int) * 4);
+        p[0] = w->id;
+        p[3] = i;
+        w->results[i] = p;
+    }
+    pop_context();
+}
+
+CTEST(concurrent_arena, threads) {
+    ConcurrentArena a = new_concurrent_arena(NULL, 0, 1024);
+    int* results[4][1000];
+    Thread threads[4];
+    ArenaWorker workers[4];
+    for(int i = 0; i < 4; i++) {
+        workers[i] = (ArenaWorker){&a, results[i], i};
+        thread_create(&threads[i], arena_worker, &workers[i]);
+    }
+    for(int i = 0; i < 4; i++) {
+        thread_join(&threads[i]);
+    }
+    for(int i = 0; i < 4; i++) {
+        for(int j = 0; j < 1000; j++) {
+            ASSERT_TRUE(results[i][j][0] == i && results[i][j][3] == j);
+        }
+    }
+    ASSERT_TRUE(a.allocated == 4 * 1000 * sizeof(int) * 4);
+    concurrent_arena_destroy(&a);
+    ASSERT_TRUE(allocated == 0);
+}
+
+typedef struct PoolNode {
+    struct PoolNode* next;
+    int value;
+} PoolNode;
+
+CTEST(pool, alloc_free) {
+    Pool p = new_pool(NULL, sizeof(PoolNode), 0, 4);
+    ASSERT_TRUE(p.object_size >= sizeof(PoolNode) && p.object_size % p.alignment == 0);
+
+    PoolNode* head = NULL;
+    for(int i = 0; i < 10; i++) {
+        PoolNode* n = pool_alloc(&p, sizeof(PoolNode));
+        ASSERT_TRUE(EXT_ALIGN(n, p.alignment) == 0);
+        n->value = i;
+        n->next = head;
+        head = n;
+    }
+    ASSERT_TRUE(p.count == 10);
+    // 10 objects in slabs of 4
+    ASSERT_TRUE(p.slabs && p.slabs->next && p.slabs->next->next && !p.slabs->next->next->next);
+    ASSERT_TRUE(allocated == 3 * (sizeof(PoolSlab) + p.alignment + 4 * p.object_size));
+
+    PoolNode* second = head->next;
+    pool_free(&p, head, sizeof(PoolNode));
+    ASSERT_TRUE(p.count == 9);
+    // Freed objects are reused first
+    PoolNode* n = pool_alloc(&p, sizeof(PoolNode));
+    ASSERT_TRUE(n == head);
+    n->next = second;
+    int expected = 8;
+    for(PoolNode* it = second; it; it = it->next) {
+        ASSERT_TRUE(it->value == expected--);
+    }
+
+    pool_reset(&p);
+    ASSERT_TRUE(p.count == 0 && p.free_list == NULL);
+    ASSERT_TRUE(p.slabs && p.slabs->next == NULL && p.slabs->used == 0);
+    ASSERT_TRUE(pool_alloc(&p, sizeof(PoolNode)) != NULL);
+
+    pool_destroy(&p);
+    ASSERT_TRUE(p.slabs == NULL);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(pool, large_and_realloc) {
+    Pool p = new_pool(NULL, sizeof(int), 0, 0);
+    // Reallocating NULL allocates, as with every other allocator
+    int* small = pool_realloc(&p, NULL, 0, sizeof(int));
+    ASSERT_TRUE(small != NULL && p.count == 1);
+    *small = 42;
+    ASSERT_TRUE(pool_realloc(&p, small, sizeof(int), p.object_size) == small);
+
+    // Growing past the object size moves the data to the parent allocator
+    int* big = pool_realloc(&p, small, sizeof(int), sizeof(int) * 100);
+    ASSERT_TRUE(big != small && *big == 42);
+    ASSERT_TRUE(p.count == 0);
+    big[99] = 1;
+    big = pool_realloc(&p, big, sizeof(int) * 100, sizeof(int) * 200);
+    ASSERT_TRUE(*big == 42 && big[99] == 1);
+
+    // And back into the pool
+    small = pool_realloc(&p, big, sizeof(int) * 200, sizeof(int));
+    ASSERT_TRUE(*small == 42 && p.count == 1);
+    pool_free(&p, small, sizeof(int));
+
+    pool_destroy(&p);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(pool, context) {
+    Pool p = new_pool(NULL, sizeof(PoolNode), 0, 0);
+    Context ctx = *ext_context;
+    ctx.alloc = &p.base;
+    push_context(&ctx);
+    Ints ints = {0};
+    for(int i = 0; i < 100; i++) {
+        array_push(&ints, i);
+    }
+    PoolNode* n = ext_alloc(sizeof(PoolNode));
+    ASSERT_TRUE(p.count == 1);
+    ext_free(n, sizeof(PoolNode));
+    array_free(&ints);
+    pop_context();
+    pool_destroy(&p);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(slab, size_classes) {
+    ASSERT_TRUE(slab_block_size(0) == 16);
+    ASSERT_TRUE(slab_block_size(1) == 16);
+    ASSERT_TRUE(slab_block_size(17) == 32);
+    ASSERT_TRUE(slab_block_size(128) == 128);
+    ASSERT_TRUE(slab_block_size(129) == 160);
+    ASSERT_TRUE(slab_block_size(256) == 256);
+    ASSERT_TRUE(slab_block_size(257) == 320);
+    ASSERT_TRUE(slab_block_size(EXT_SLAB_MAX_SIZE) == EXT_SLAB_MAX_SIZE);
+    ASSERT_TRUE(slab_block_size(EXT_SLAB_MAX_SIZE + 1) == EXT_SLAB_MAX_SIZE + 1);
+    size_t prev = 0;
+    for(size_t size = 1; size <= EXT_SLAB_MAX_SIZE; size++) {
+        size_t block = slab_block_size(size);
+        ASSERT_TRUE(block >= size && block >= prev && block % EXT_DEFAULT_ALIGNMENT == 0);
+        // At most 25% of waste past the first classes
+        ASSERT_TRUE(size <= 128 || block - size < block / 4);
+        prev = block;
+    }
+}
+
+CTEST(slab, alloc_realloc_free) {
+    SlabAllocator s = new_slab_allocator(NULL);
+    char* p = slab_alloc(&s, 100);
+    memset(p, 'a', 100);
+    // Same size class, no move
+    ASSERT_TRUE(slab_realloc(&s, p, 100, 112) == p);
+    char* q = slab_realloc(&s, p, 112, 1000);
+    ASSERT_TRUE(q != p && q[99] == 'a');
+    // The freed block is reused by the next allocation in its class
+    ASSERT_TRUE(slab_alloc(&s, 97) == p);
+    slab_free(&s, p, 97);
+
+    char* big = slab_realloc(&s, q, 1000, EXT_SLAB_MAX_SIZE * 2);
+    ASSERT_TRUE(big[99] == 'a');
+    big = slab_realloc(&s, big, EXT_SLAB_MAX_SIZE * 2, 50);
+    ASSERT_TRUE(big[49] == 'a');
+    slab_free(&s, big, 50);
+
+    // Reallocating NULL allocates, as with every other allocator
+    p = slab_realloc(&s, NULL, 0, 8);
+    ASSERT_TRUE(p != NULL);
+    slab_free(&s, p, 8);
+
+    slab_allocator_destroy(&s);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(slab, context) {
+    SlabAllocator s = new_slab_allocator(NULL);
+    Context ctx = *ext_context;
+    ctx.alloc = &s.base;
+    push_context(&ctx);
+    Ints ints = {0};
+    char* strs[100];
+    for(int i = 0; i < 10000; i++) {
+        array_push(&ints, i);
+        if(i < 100) strs[i] = ext_strdup(temp_sprintf("string %d", i));
+    }
+    for(int i = 0; i < 10000; i++) {
+        ASSERT_TRUE(ints.items[i] == i);
+    }
+    for(int i = 0; i < 100; i++) {
+        ASSERT_TRUE(strcmp(strs[i], temp_sprintf("string %d", i)) == 0);
+        ext_free(strs[i], strlen(strs[i]) + 1);
+    }
+    array_free(&ints);
+    pop_context();
+    temp_reset();
+    slab_allocator_destroy(&s);
+    ASSERT_TRUE(allocated == 0);
+}
+
+CTEST(tcache, alloc_free) {
+    CentralHeap heap;
+    central_heap_init(&heap, NULL);
+    ThreadCache cache;
+    thread_cache_init(&cache, &heap);
+
+    void* blocks[100];
+    for(int i = 0; i < 100; i++) {
+        blocks[i] = thread_cache_alloc(&cache, 24);
+        memset(blocks[i], i, 24);
+    }
+    // Refills happen in batches
+    size_t cls = 1;
+    ASSERT_TRUE(heap.slab.classes[cls].count % EXT_TCACHE_BATCH == 0);
+    ASSERT_TRUE(heap.slab.classes[cls].count - 100 == cache.magazines[cls].count);
+    for(int i = 0; i < 100; i++) {
+        ASSERT_TRUE(((unsigned char*)blocks[i])[23] == i);
+        thread_cache_free(&cache, blocks[i], 24);
+    }
+    // Full magazines drain half of their blocks to the heap
+    ASSERT_TRUE(cache.magazines[cls].count <= EXT_TCACHE_MAGAZINE_SIZE);
+    ASSERT_TRUE(heap.slab.classes[cls].count == cache.magazines[cls].count);
+    // The last freed block is the first to be reused
+    ASSERT_TRUE(thread_cache_alloc(&cache, 24) == blocks[99]);
+    thread_cache_free(&cache, blocks[99], 24);
+
+    char* p = thread_cache_realloc(&cache, NULL, 0, 10);
+    strcpy(p, "ciao");
+    p = thread_cache_realloc(&cache, p, 10, 16);
+    p = thread_cache_realloc(&cache, p, 16, 1000);
+    p = thread_cache_realloc(&cache, p, 1000, EXT_SLAB_MAX_SIZE * 2);
+    ASSERT_TRUE(strcmp(p, "ciao") == 0);
+    thread_cache_free(&cache, p, EXT_SLAB_MAX_SIZE * 2);
+
+    thread_cache_flush(&cache);
+    for(size_t i = 0; i < EXT_SLAB_CLASSES; i++) {
+        ASSERT_TRUE(cache.magazines[i].count == 0 && heap.slab.classes[i].count == 0);
+    }
+    central_heap_destroy(&heap);
+    ASSERT_TRUE(allocated == 0);
+}
+
+typedef struct {
+    CentralHeap* heap;
+    void** blocks;
+    bool alloc;
+} TcacheWorker;
+
+static void tcache_worker(void* arg) {
+    TcacheWorker* w = arg;
+    ThreadCache cache;
+    thread_cache_init(&cache, w->heap);
+    Context ctx = *ext_context;
+    ctx.alloc = &cache.base;
+    push_context(&ctx);
+    for(int i = 0; i < 1000; i++) {
+        if(w->alloc) {
+            w->blocks[i] = ext_alloc(32 + i % 100);
+            memset(w->blocks[i], 1, 32 + i % 100);
+        } else {
+            ext_free(w->blocks[i], 32 + i % 100);
+        }
+    }
+    pop_context();
+    thread_cache_flush(&cache);
+}
+
+CTEST(tcache, cross_thread_free) {
+    CentralHeap heap;
+    central_heap_init(&heap, NULL);
+    void* blocks[1000];
+    Thread t;
+    // Blocks allocated in a thread and freed in another go back through the central heap.
+    // They are real threads only in the EXTLIB_THREADSAFE build, otherwise they run inline
+    TcacheWorker producer = {&heap, blocks, true}, consumer = {&heap, blocks, false};
+    thread_create(&t, tcache_worker, &producer);
+    thread_join(&t);
+    thread_create(&t, tcache_worker, &consumer);
+    thread_join(&t);
+    for(size_t i = 0; i < EXT_SLAB_CLASSES; i++) {
+        ASSERT_TRUE(heap.slab.classes[i].count == 0);
+    }
+
+    // The heap itself is an allocator
+    int* shared = heap.base.alloc(&heap.base, sizeof(int) * 10);
+    shared = heap.base.realloc(&heap.base, shared, sizeof(int) * 10, sizeof(int) * 100);
+    heap.base.free(&heap.base, shared, sizeof(int) * 100);
+
+    central_heap_destroy(&heap);
+    ASSERT_TRUE(allocated == 0);
+}
+
 CTEST(array, reserve) {
     Ints ints = {0};
     array_reserve(&ints, 100);
@@ -763,6 +1162,13 @@ CTEST(slice, eq) {
     ASSERT_TRUE(!ss_eq(ss_from_cstr("Hello"), ss_from_cstr("")));
 }
 
+CTEST(slice, cmp) {
+    ASSERT_TRUE(ss_cmp(ss_from_cstr("key 4"), ss_from_cstr("key 4")) == 0);
+    ASSERT_TRUE(ss_cmp(ss_from_cstr("key 4"), ss_from_cstr("key 42")) < 0);
+    ASSERT_TRUE(ss_cmp(ss_from_cstr("key 42"), ss_from_cstr("key 4")) > 0);
+    ASSERT_TRUE(ss_cmp(ss_from_cstr("key 5"), ss_from_cstr("key 42")) > 0);
+}
+
 CTEST(slice, to_cstr) {
     StringSlice ss = ss_from_cstr("Cantami o diva del pelide Achille");
     char* copy = ss_to_cstr_alloc(ss, &ext_temp_allocator.base);
@@ -771,6 +1177,56 @@ CTEST(slice, to_cstr) {
     temp_reset();
 }
 
+CTEST(hash, bytes) {
+    char buf[128];
+    for(size_t i = 0; i < sizeof(buf); i++) buf[i] = (char)('a' + i % 26);
+
+    // Prefixes of every length must hash differently, and the same bytes must hash the same
+    size_t hashes[sizeof(buf)];
+    for(size_t len = 0; len < sizeof(buf); len++) {
+        hashes[len] = ext_hash_bytes_(buf, len);
+        ASSERT_TRUE(hashes[len] == ext_hash_bytes_(buf, len));
+        for(size_t j = 0; j < len; j++) {
+            ASSERT_TRUE(hashes[j] != hashes[len]);
+        }
+    }
+
+    // Every byte must contribute to the hash
+    size_t h = ext_hash_bytes_(buf, 100);
+    for(size_t i = 0; i < 100; i++) {
+        buf[i] ^= 1;
+        ASSERT_TRUE(ext_hash_bytes_(buf, 100) != h);
+        buf[i] ^= 1;
+    }
+
+    ASSERT_TRUE(ext_hash_cstr_("hello world") == ext_hash_cstr_("hello world"));
+    ASSERT_TRUE(ext_hash_cstr_("hello world") != ext_hash_cstr_("hello worle"));
+}
+
+// With EXT_HASH_CRC32C the hardware hash must be picked whenever the instructions are available
+#if defined(EXT_HASH_CRC32C) && defined(__SSE4_2__) && defined(__x86_64__) && \
+    !defined(EXT_HASH_HW_CRC32C_)
+#error "EXT_HASH_CRC32C doesn't use the hardware CRC32C instructions"
+#endif
+
+CTEST(hash, selection) {
+    // Keys that are not 4 or 8 bytes long go through the hash selected at compile time
+    const char* s = "neither four nor eight bytes";
+    size_t len = strlen(s), seed = 2147483647;
+#if defined(EXT_HASH_HW_CRC32C_)
+    size_t expected = ext_crc32c_bytes_(s, len, seed);
+#elif defined(EXT_HASH_WYHASH) || defined(EXT_HASH_CRC32C)
+    size_t expected = ext_wyhash_bytes_(s, len, seed);
+#else
+    size_t expected = ext_siphash_bytes_(s, len, seed);
+#endif
+    ASSERT_TRUE(ext_hash_bytes_(s, len) == expected);
+#if defined(EXT_SIPHASH_2_4) || defined(EXT_HASH_WYHASH) || defined(EXT_HASH_CRC32C)
+    // C-strings are hashed with the same function
+    ASSERT_TRUE(ext_hash_cstr_(s) == expected);
+#endif
+}
+
 typedef struct {
     int key;
     int value;
@@ -779,7 +1235,7 @@ typedef struct {
 typedef struct {
     IntEntry* entries;
     size_t* hashes;
-    size_t size, capacity;
+    size_t size, tombstones, capacity;
     Allocator* allocator;
 } IntMap;
 
@@ -866,214 +1322,2092 @@ CTEST(hmap, clear) {
     hmap_free(&map);
 }
 
-CTEST(hmap, iter) {
+CTEST(hmap, tombstones) {
     IntMap map = {0};
+    IntEntry* e;
     for(int i = 0; i < 50; i++) {
-        hmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
     }
-    int i = 0;
-    for(IntEntry* it = hmap_begin(&map); it != hmap_end(&map); it = hmap_next(&map, it)) {
-        i++;
+    for(int i = 0; i < 50; i += 2) {
+        hmap_delete(&map, &((IntEntry){.key = i}));
     }
-    ASSERT_TRUE(i == 50);
-
-    i = 0;
-    hmap_foreach(IntEntry, it, &map) {
-        i++;
+    ASSERT_TRUE(map.size == 25);
+    ASSERT_TRUE(map.tombstones == 25);
+
+    // Deleting a missing key doesn't leave a tombstone
+    hmap_delete(&map, &((IntEntry){.key = 0}));
+    ASSERT_TRUE(map.tombstones == 25);
+
+    size_t capacity = map.capacity;
+    hmap_compact(&map);
+    ASSERT_TRUE(map.tombstones == 0);
+    ASSERT_TRUE(map.size == 25);
+    ASSERT_TRUE(map.capacity == capacity);
+    for(int i = 0; i < 50; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 2 != 0));
+        if(e) ASSERT_TRUE(e->value == i);
     }
-    ASSERT_TRUE(i == 50);
 
     hmap_free(&map);
 }
 
-CTEST(hmap, allocator) {
-    IntMap ints = {0};
-    size_t temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
-    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail == 0);
-    ints.allocator = &ext_temp_allocator.base;
+CTEST(hmap, churn) {
+    IntMap map = {0};
+    IntEntry* e;
     for(int i = 0; i < 100; i++) {
-        hmap_put(&ints, &((IntEntry){.key = i, .value = i * 10}));
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
     }
-    temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
-    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail >= 100 * sizeof(IntEntry));
-    ASSERT_TRUE(allocated == 0);
-    temp_reset();
-}
 
-CTEST(hmap, ctx_allocator) {
-    Context ctx = *ext_context;
-    ctx.alloc = &ext_temp_allocator.base;
-    push_context(&ctx);
+    // Steady insert/delete churn must not grow the table nor fill it with tombstones
+    size_t capacity = map.capacity;
+    for(int i = 100; i < 100000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        hmap_delete(&map, &((IntEntry){.key = i - 100}));
+        ASSERT_TRUE(map.size + map.tombstones <= EXT_HMAP_MAX_ENTRY_LOAD(map.capacity + 1));
+    }
+    ASSERT_TRUE(map.size == 100);
+    ASSERT_TRUE(map.capacity == capacity);
 
-    IntMap ints = {0};
-    size_t temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
-    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail == 0);
-    ints.allocator = &ext_temp_allocator.base;
-    for(int i = 0; i < 100; i++) {
-        hmap_put(&ints, &((IntEntry){.key = i, .value = i * 10}));
+    for(int i = 100000 - 100; i < 100000; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
     }
-    temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
-    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail >= 100 * sizeof(IntEntry));
-    ASSERT_TRUE(allocated == 0);
+    hmap_get(&map, &((IntEntry){.key = 100000 - 101}), &e);
+    ASSERT_TRUE(e == NULL);
 
-    pop_context();
-    temp_reset();
-}
+    int count = 0;
+    hmap_foreach(IntEntry, it, &map) {
+        count++;
+    }
+    ASSERT_TRUE(count == 100);
 
-typedef struct {
-    const char* key;
-    int value;
-} StrEntry;
+    hmap_free(&map);
+}
 
-typedef struct {
-    StrEntry* entries;
-    size_t* hashes;
-    size_t capacity, size;
-    Allocator* allocator;
-} StrMap;
+CTEST(hmap, arena_growth) {
+    Arena a = new_arena(NULL, 0, 0, EXT_ARENA_FLEXIBLE_PAGE);
+    IntMap map = {.allocator = &a.base};
+    for(int i = 0; i < 10000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    // Old tables are reclaimed on growth, so only the current table is allocated in the arena
+    size_t table_size = (map.capacity + 1) * (sizeof(*map.entries) + sizeof(*map.hashes));
+    ASSERT_TRUE(a.allocated == table_size);
+    for(int i = 0; i < 10000; i++) {
+        IntEntry* e;
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+    hmap_free(&map);
+    ASSERT_TRUE(a.allocated == 0);
+    arena_destroy(&a);
 
-CTEST(hmap, get_put_cstr) {
-    StrMap map = {0};
-    for(int i = 0; i < 22; i++) {
-        const char* key = temp_sprintf("key %d", i);
-        hmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    void* checkpoint = temp_checkpoint();
+    map = (IntMap){.allocator = &ext_temp_allocator.base};
+    for(int i = 0; i < 1000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
     }
+    table_size = (map.capacity + 1) * (sizeof(*map.entries) + sizeof(*map.hashes));
+    ASSERT_TRUE((size_t)((char*)temp_checkpoint() - (char*)checkpoint) == table_size);
+    temp_rewind(checkpoint);
+}
 
-    ASSERT_TRUE(map.size == 22);
-    hmap_put_cstr(&map, &((StrEntry){.key = "key 2", .value = 100}));
-    ASSERT_TRUE(map.size == 22);
+CTEST(hmap, shrink_to_fit) {
+    IntMap map = {0};
+    hmap_shrink_to_fit(&map);
+    ASSERT_TRUE(map.entries == NULL);
 
-    StrEntry* entry;
-    ext_hmap_get_cstr(&map, "key 2", &entry);
-    ASSERT_TRUE(entry != NULL);
-    ASSERT_TRUE(entry->value == 100);
-    entry->value += 50;
+    for(int i = 0; i < 100000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    size_t capacity = map.capacity;
+    for(int i = 0; i < 100000; i++) {
+        if(i % 1000) hmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 100);
+
+    hmap_shrink_to_fit(&map);
+    ASSERT_TRUE(map.capacity < capacity);
+    ASSERT_TRUE(map.tombstones == 0);
+    ASSERT_TRUE(map.size <= EXT_HMAP_MAX_ENTRY_LOAD(map.capacity + 1));
+    ASSERT_TRUE(map.size > EXT_HMAP_MAX_ENTRY_LOAD((map.capacity + 1) / 2));
+    for(int i = 0; i < 100000; i++) {
+        IntEntry* e;
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 1000 == 0));
+    }
 
-    StrEntry* entry2;
-    hmap_get_cstr(&map, "key 2", &entry2);
-    ASSERT_TRUE(entry == entry2);
-    ASSERT_TRUE(entry2->value == 150);
+    // Emptied maps keep the smallest table
+    hmap_clear(&map);
+    hmap_shrink_to_fit(&map);
+    ASSERT_TRUE(map.capacity + 1 == EXT_HMAP_INIT_CAPACITY);
+    hmap_put(&map, &((IntEntry){.key = 1, .value = 1}));
+    ASSERT_TRUE(map.size == 1);
 
-    StrEntry* entry3;
-    hmap_get_cstr(&map, "key 30", &entry3);
-    ASSERT_TRUE(entry3 == NULL);
+    hmap_free(&map);
+}
+
+#ifdef EXT_HMAP_AUTO_SHRINK
+CTEST(hmap, auto_shrink) {
+    IntMap map = {0};
+    for(int i = 0; i < 1000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    // The table shrinks only once the load drops below 1/8
+    size_t cap = map.capacity + 1;
+    int key = 999;
+    for(; map.size > cap / 8; key--) {
+        hmap_delete(&map, &((IntEntry){.key = key}));
+    }
+    ASSERT_TRUE(map.capacity + 1 == cap);
+    hmap_delete(&map, &((IntEntry){.key = key}));
+    key--;
+    // It's then sized for twice its entries
+    size_t newcap = EXT_HMAP_INIT_CAPACITY;
+    while(EXT_HMAP_MAX_ENTRY_LOAD(newcap) < map.size * 2) newcap *= 2;
+    ASSERT_TRUE(map.capacity + 1 == newcap && newcap < cap);
+    ASSERT_TRUE(map.tombstones == 0);
+    for(int i = 0; i < 1000; i++) {
+        IntEntry* e;
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(i <= key ? e != NULL && e->value == i : e == NULL);
+    }
 
+    // But never below the initial capacity
+    for(; key >= 0; key--) {
+        hmap_delete(&map, &((IntEntry){.key = key}));
+    }
+    ASSERT_TRUE(map.size == 0 && map.capacity + 1 == EXT_HMAP_INIT_CAPACITY);
     hmap_free(&map);
-    temp_reset();
 }
+#endif  // EXT_HMAP_AUTO_SHRINK
 
-CTEST(hmap, delete_cstr) {
-    StrEntry* e;
-    StrMap map = {0};
+CTEST(hmap, reserve) {
+    IntMap map = {0};
+    hmap_reserve(&map, 0);
+    ASSERT_TRUE(map.entries == NULL);
 
-    for(int i = 1; i < 50; i++) {
-        const char* key = temp_sprintf("key %d", i);
-        hmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    hmap_reserve(&map, 1000);
+    size_t capacity = map.capacity;
+    ASSERT_TRUE(EXT_HMAP_MAX_ENTRY_LOAD(capacity + 1) >= 1000);
+    for(int i = 0; i < 1000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
     }
+    ASSERT_TRUE(map.size == 1000);
+    ASSERT_TRUE(map.capacity == capacity);
 
-    hmap_get_cstr(&map, "key 1", &e);
-    ASSERT_TRUE(e != NULL);
-    ASSERT_TRUE(e->value == 10);
+    // Reserving less than the current capacity is a no-op
+    hmap_reserve(&map, 10);
+    ASSERT_TRUE(map.capacity == capacity);
 
-    ASSERT_TRUE(map.size == 49);
-    hmap_delete_cstr(&map, "key 1");
-    ASSERT_TRUE(map.size == 48);
-    hmap_get_cstr(&map, "key 1", &e);
-    ASSERT_TRUE(e == NULL);
+    for(int i = 0; i < 1000; i++) {
+        IntEntry* e;
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
 
-    for(int i = 2; i < 50; i++) {
-        const char* key = temp_sprintf("key %d", i);
-        hmap_delete_cstr(&map, key);
+    hmap_free(&map);
+}
+
+CTEST(hmap, put_all) {
+    IntEntry entries[1000];
+    for(int i = 0; i < 1000; i++) {
+        entries[i] = (IntEntry){.key = i, .value = i * 10};
     }
-    for(int i = 2; i < 50; i++) {
-        StrEntry* e;
-        const char* key = temp_sprintf("key %d", i);
-        hmap_get_cstr(&map, key, &e);
-        ASSERT_TRUE(e == NULL);
+
+    IntMap map = {0};
+    hmap_put(&map, &((IntEntry){.key = 5000, .value = 1}));
+    hmap_put(&map, &((IntEntry){.key = 2, .value = 1}));
+    hmap_put_all(&map, entries, 1000);
+    ASSERT_TRUE(map.size == 1001);
+    ASSERT_TRUE(map.size + map.tombstones <= EXT_HMAP_MAX_ENTRY_LOAD(map.capacity + 1));
+
+    IntEntry* e;
+    for(int i = 0; i < 1000; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i * 10);
     }
-    ASSERT_TRUE(map.size == 0);
+    hmap_get(&map, &((IntEntry){.key = 5000}), &e);
+    ASSERT_TRUE(e != NULL && e->value == 1);
+
+    hmap_put_all(&map, entries, 0);
+    ASSERT_TRUE(map.size == 1001);
+
+    hmap_free(&map);
+}
+
+CTEST(hmap, get_batch) {
+    IntMap map = {0};
+    IntEntry keys[300];
+    IntEntry* outs[300];
+    for(int i = 0; i < 300; i++) {
+        keys[i] = (IntEntry){.key = i};
+    }
+
+    hmap_get_batch(&map, keys, 300, outs);
+    for(int i = 0; i < 300; i++) {
+        ASSERT_TRUE(outs[i] == NULL);
+    }
+
+    for(int i = 0; i < 300; i += 2) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    hmap_get_batch(&map, keys, 300, outs);
+    for(int i = 0; i < 300; i++) {
+        if(i % 2 == 0) {
+            ASSERT_TRUE(outs[i] != NULL);
+            ASSERT_TRUE(outs[i]->key == i && outs[i]->value == i * 10);
+        } else {
+            ASSERT_TRUE(outs[i] == NULL);
+        }
+    }
+
+    hmap_free(&map);
+}
+
+#define colliding_hash(e) 42
+#define int_cmp(a, b)     ((a)->key != (b)->key)
+
+CTEST(hmap, stats) {
+    IntMap map = {0};
+    HmapStats stats;
+    hmap_stats(&map, &stats);
+    ASSERT_TRUE(stats.size == 0 && stats.capacity == 0 && stats.entries_bytes == 0);
+
+    // All keys land on the same home slot, so the i-th key has a probe length of i
+    for(int i = 0; i < 10; i++) {
+        ext_hmap_put_ex(&map, &((IntEntry){.key = i, .value = i}), colliding_hash, int_cmp);
+    }
+    ext_hmap_delete_ex(&map, &((IntEntry){.key = 9}), colliding_hash, int_cmp);
+    hmap_stats(&map, &stats);
+    ASSERT_TRUE(stats.size == 9);
+    ASSERT_TRUE(stats.capacity == map.capacity + 1);
+    ASSERT_TRUE(stats.tombstones == 1);
+    ASSERT_TRUE(stats.load_factor == 10.0 / stats.capacity);
+    ASSERT_TRUE(stats.max_probe == 8);
+    ASSERT_TRUE(stats.avg_probe == 4.0);
+    for(int i = 0; i < 9; i++) {
+        ASSERT_TRUE(stats.probe_histogram[i] == 1);
+    }
+    ASSERT_TRUE(stats.probe_histogram[9] == 0);
+    ASSERT_TRUE(stats.entries_bytes == stats.capacity * sizeof(IntEntry));
+    ASSERT_TRUE(stats.hashes_bytes == stats.capacity * sizeof(size_t));
+
+    // Long probes are all counted in the last bucket
+    for(int i = 10; i < 30; i++) {
+        ext_hmap_put_ex(&map, &((IntEntry){.key = i, .value = i}), colliding_hash, int_cmp);
+    }
+    hmap_stats(&map, &stats);
+    ASSERT_TRUE(stats.size == 29);
+    ASSERT_TRUE(stats.max_probe == 28);
+    ASSERT_TRUE(stats.probe_histogram[EXT_HMAP_STATS_HISTOGRAM_SIZE - 1] ==
+                29 - (EXT_HMAP_STATS_HISTOGRAM_SIZE - 1));
+
+    hmap_free(&map);
+}
+
+#ifdef EXT_HMAP_PROBE_COUNTERS
+CTEST(hmap, probe_counters) {
+    IntMap map = {0};
+    // All keys share the same hash, so looking up the i-th key visits and compares i + 1 slots
+    for(int i = 0; i < 10; i++) {
+        ext_hmap_put_ex(&map, &((IntEntry){.key = i, .value = i}), colliding_hash, int_cmp);
+    }
+    hmap_reset_counters();
+    for(int i = 0; i < 10; i++) {
+        IntEntry* e;
+        ext_hmap_get_ex(&map, &((IntEntry){.key = i}), &e, colliding_hash, int_cmp);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+    ASSERT_TRUE(hmap_counters.lookups == 10);
+    ASSERT_TRUE(hmap_counters.probes == 55);
+    ASSERT_TRUE(hmap_counters.comparisons == 55);
+
+    hmap_reset_counters();
+    ASSERT_TRUE(hmap_counters.lookups == 0 && hmap_counters.probes == 0);
+    ASSERT_TRUE(hmap_counters.comparisons == 0);
+    hmap_free(&map);
+}
+#endif  // EXT_HMAP_PROBE_COUNTERS
+
+CTEST(hmap, entry) {
+    IntMap map = {0};
+    IntEntry* e;
+    bool inserted;
+    for(int n = 0; n < 3; n++) {
+        for(int i = 0; i < 100; i++) {
+            hmap_entry(&map, &((IntEntry){.key = i % 10}), &e, &inserted);
+            ASSERT_TRUE(inserted == (n == 0 && i < 10));
+            ASSERT_TRUE(e->key == i % 10);
+            e->value++;
+        }
+    }
+    ASSERT_TRUE(map.size == 10);
+    for(int i = 0; i < 10; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == 30);
+    }
+
+    // New entries reuse tombstones
+    hmap_delete(&map, &((IntEntry){.key = 3}));
+    ASSERT_TRUE(map.tombstones == 1);
+    hmap_entry(&map, &((IntEntry){.key = 3, .value = 42}), &e, &inserted);
+    ASSERT_TRUE(inserted);
+    ASSERT_TRUE(e->key == 3 && e->value == 0);
+    ASSERT_TRUE(map.size == 10);
+
+    // Growing while inserting
+    for(int i = 0; i < 1000; i++) {
+        hmap_entry(&map, &((IntEntry){.key = i}), &e, &inserted);
+        e->value = -i;
+    }
+    ASSERT_TRUE(map.size == 1000);
+    for(int i = 0; i < 1000; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == -i);
+    }
+
+    hmap_free(&map);
+}
+
+typedef struct {
+    IntEntry* entries;
+    uint32_t* hashes;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+} IntMap32;
+
+CTEST(hmap, hashes_32) {
+    IntMap32 map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 10000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    ASSERT_TRUE(map.size == 10000);
+    for(int i = 0; i < 10000; i++) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+
+    // Churn exercises compaction
+    size_t capacity = map.capacity;
+    for(int i = 0; i < 10000; i += 2) {
+        hmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    for(int i = 10000; i < 50000; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        hmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 5000);
+    ASSERT_TRUE(map.capacity == capacity);
+
+    bool inserted;
+    hmap_entry(&map, &((IntEntry){.key = 1}), &e, &inserted);
+    ASSERT_TRUE(!inserted && e->value == 1);
+
+    int count = 0;
+    hmap_foreach(IntEntry, it, &map) {
+        ASSERT_TRUE(it->key % 2 != 0 && it->key < 10000);
+        count++;
+    }
+    ASSERT_TRUE(count == 5000);
+
+    HmapStats stats;
+    hmap_stats(&map, &stats);
+    ASSERT_TRUE(stats.hashes_bytes == stats.capacity * sizeof(uint32_t));
+
+    hmap_reserve(&map, 100000);
+    for(int i = 1; i < 10000; i += 2) {
+        hmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+
+    hmap_free(&map);
+}
+
+CTEST(hmap, iter) {
+    IntMap map = {0};
+    for(int i = 0; i < 50; i++) {
+        hmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    int i = 0;
+    for(IntEntry* it = hmap_begin(&map); it != hmap_end(&map); it = hmap_next(&map, it)) {
+        i++;
+    }
+    ASSERT_TRUE(i == 50);
+
+    i = 0;
+    hmap_foreach(IntEntry, it, &map) {
+        i++;
+    }
+    ASSERT_TRUE(i == 50);
 
     hmap_free(&map);
+}
+
+CTEST(hmap, allocator) {
+    IntMap ints = {0};
+    size_t temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
+    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail == 0);
+    ints.allocator = &ext_temp_allocator.base;
+    for(int i = 0; i < 100; i++) {
+        hmap_put(&ints, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
+    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail >= 100 * sizeof(IntEntry));
+    ASSERT_TRUE(allocated == 0);
+    temp_reset();
+}
+
+CTEST(hmap, ctx_allocator) {
+    Context ctx = *ext_context;
+    ctx.alloc = &ext_temp_allocator.base;
+    push_context(&ctx);
+
+    IntMap ints = {0};
+    size_t temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
+    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail == 0);
+    ints.allocator = &ext_temp_allocator.base;
+    for(int i = 0; i < 100; i++) {
+        hmap_put(&ints, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    temp_avail = ext_temp_allocator.end - ext_temp_allocator.start;
+    ASSERT_TRUE(ext_temp_allocator.mem_size - temp_avail >= 100 * sizeof(IntEntry));
+    ASSERT_TRUE(allocated == 0);
+
+    pop_context();
     temp_reset();
 }
 
 typedef struct {
-    StringSlice key;
+    const char* key;
     int value;
-} SliceEntry;
+} StrEntry;
 
 typedef struct {
-    SliceEntry* entries;
+    StrEntry* entries;
     size_t* hashes;
-    size_t capacity, size;
+    size_t capacity, size, tombstones;
     Allocator* allocator;
-} SliceMap;
+} StrMap;
 
-CTEST(hmap, get_put_ss) {
-    SliceMap map = {0};
+CTEST(hmap, get_put_cstr) {
+    StrMap map = {0};
     for(int i = 0; i < 22; i++) {
-        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
-        hmap_put_ss(&map, &((SliceEntry){.key = key, .value = i * 10}));
+        const char* key = temp_sprintf("key %d", i);
+        hmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
     }
 
     ASSERT_TRUE(map.size == 22);
-    hmap_put_ss(&map, &((SliceEntry){.key = ss_from_cstr("key 2"), .value = 100}));
+    hmap_put_cstr(&map, &((StrEntry){.key = "key 2", .value = 100}));
     ASSERT_TRUE(map.size == 22);
 
-    SliceEntry* entry;
-    ext_hmap_get_ss(&map, ss_from_cstr("key 2"), &entry);
+    StrEntry* entry;
+    ext_hmap_get_cstr(&map, "key 2", &entry);
     ASSERT_TRUE(entry != NULL);
     ASSERT_TRUE(entry->value == 100);
     entry->value += 50;
 
-    SliceEntry* entry2;
-    hmap_get_ss(&map, ss_from_cstr("key 2"), &entry2);
+    StrEntry* entry2;
+    hmap_get_cstr(&map, "key 2", &entry2);
     ASSERT_TRUE(entry == entry2);
     ASSERT_TRUE(entry2->value == 150);
 
-    SliceEntry* entry3;
-    hmap_get_ss(&map, ss_from_cstr("key 30"), &entry3);
+    StrEntry* entry3;
+    hmap_get_cstr(&map, "key 30", &entry3);
     ASSERT_TRUE(entry3 == NULL);
 
     hmap_free(&map);
     temp_reset();
 }
 
-CTEST(hmap, delete_ss) {
-    SliceEntry* e;
-    SliceMap map = {0};
+CTEST(hmap, put_all_cstr) {
+    StrEntry entries[100];
+    for(int i = 0; i < 100; i++) {
+        entries[i] = (StrEntry){.key = temp_sprintf("key %d", i), .value = i};
+    }
+    StrMap map = {0};
+    hmap_put_all_cstr(&map, entries, 100);
+    ASSERT_TRUE(map.size == 100);
 
-    for(int i = 1; i < 50; i++) {
-        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
-        hmap_put_ss(&map, &((SliceEntry){.key = key, .value = i * 10}));
+    StrEntry* e;
+    hmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 42);
+
+    hmap_free(&map);
+    temp_reset();
+}
+
+CTEST(hmap, put_all_parallel) {
+    size_t n = 100000;
+    IntEntry* entries = ext_alloc(sizeof(*entries) * n);
+    for(size_t i = 0; i < n; i++) {
+        // Every key appears twice, the second time with the value that must win
+        entries[i] = (IntEntry){.key = (int)(i % (n / 2)), .value = (int)i};
     }
 
-    hmap_get_ss(&map, ss_from_cstr("key 1"), &e);
-    ASSERT_TRUE(e != NULL);
-    ASSERT_TRUE(e->value == 10);
+    IntMap map = {0};
+    hmap_put(&map, &((IntEntry){.key = -1, .value = -1}));
+    hmap_put(&map, &((IntEntry){.key = 7, .value = -1}));
+    hmap_put(&map, &((IntEntry){.key = -2, .value = -1}));
+    hmap_delete(&map, &((IntEntry){.key = -2}));
+    hmap_put_all_parallel(&map, entries, n, 4);
+    ASSERT_TRUE(map.size == n / 2 + 1);
+    ASSERT_TRUE(map.size + map.tombstones <= EXT_HMAP_MAX_ENTRY_LOAD(map.capacity + 1));
 
-    ASSERT_TRUE(map.size == 49);
-    hmap_delete_ss(&map, ss_from_cstr("key 1"));
-    ASSERT_TRUE(map.size == 48);
-    hmap_get_ss(&map, ss_from_cstr("key 1"), &e);
-    ASSERT_FALSE(e != NULL);
+    IntEntry* e;
+    for(size_t i = 0; i < n / 2; i++) {
+        hmap_get(&map, &((IntEntry){.key = (int)i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == (int)(i + n / 2));
+    }
+    hmap_get(&map, &((IntEntry){.key = -1}), &e);
+    ASSERT_TRUE(e != NULL && e->value == -1);
+    size_t count = 0;
+    hmap_foreach(IntEntry, it, &map) {
+        count++;
+    }
+    ASSERT_TRUE(count == map.size);
+
+    // Merging a map in an empty one copies it
+    IntMap copy = {0};
+    hmap_merge_parallel(&copy, &map, 3);
+    ASSERT_TRUE(copy.size == map.size);
+    // The destination is sized for the entries of the source, not for its capacity
+    IntMap seq = {0};
+    hmap_foreach(IntEntry, it, &map) {
+        hmap_put(&seq, it);
+    }
+    ASSERT_TRUE(copy.capacity == seq.capacity);
+    hmap_free(&seq);
+    hmap_foreach(IntEntry, it, &map) {
+        hmap_get(&copy, it, &e);
+        ASSERT_TRUE(e != NULL && e->value == it->value);
+    }
 
-    for(int i = 2; i < 50; i++) {
-        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
-        hmap_delete_ss(&map, key);
+    // Merging in a map with 32-bit hashes recomputes nothing, but still finds the same keys
+    IntMap32 map32 = {0};
+    hmap_put(&map32, &((IntEntry){.key = 0, .value = -1}));
+    hmap_merge_parallel(&map32, &map, 2);
+    ASSERT_TRUE(map32.size == map.size);
+    hmap_get(&map32, &((IntEntry){.key = 0}), &e);
+    ASSERT_TRUE(e != NULL && e->value == (int)(n / 2));
+
+    hmap_free(&map32);
+    hmap_free(&copy);
+    hmap_free(&map);
+    ext_free(entries, sizeof(*entries) * n);
+}
+
+static size_t int_entry_hash(const void* e) {
+    return (size_t)((const IntEntry*)e)->key * 0x9e3779b97f4a7c15ull;
+}
+
+static int int_entry_cmp(const void* a, const void* b) {
+    return ((const IntEntry*)a)->key != ((const IntEntry*)b)->key;
+}
+
+#define int_entry_hash_macro(e) int_entry_hash(e)
+
+CTEST(hmap, put_all_parallel_ex) {
+    IntEntry entries[5000];
+    for(int i = 0; i < 5000; i++) {
+        entries[i] = (IntEntry){.key = i, .value = i * 10};
     }
-    for(int i = 2; i < 50; i++) {
-        SliceEntry* e;
-        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
-        hmap_get_ss(&map, key, &e);
-        ASSERT_TRUE(e == NULL);
+    IntMap map = {0};
+    hmap_put_all_parallel_ex(&map, entries, 5000, 4, int_entry_hash, int_entry_cmp);
+    ASSERT_TRUE(map.size == 5000);
+    for(int i = 0; i < 5000; i++) {
+        IntEntry* e;
+        ext_hmap_get_ex(&map, &((IntEntry){.key = i}), &e, int_entry_hash_macro, int_cmp);
+        ASSERT_TRUE(e != NULL && e->value == i * 10);
     }
-    ASSERT_TRUE(map.size == 0);
+    hmap_free(&map);
+}
+
+CTEST(hmap, put_all_parallel_cstr) {
+    StrEntry entries[2000];
+    for(int i = 0; i < 2000; i++) {
+        entries[i] = (StrEntry){.key = temp_sprintf("key %d", i % 1000), .value = i};
+    }
+    StrMap map = {0};
+    hmap_put_all_parallel_cstr(&map, entries, 2000, 4);
+    ASSERT_TRUE(map.size == 1000);
+    StrEntry* e;
+    hmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 1042);
+    hmap_free(&map);
+    temp_reset();
+}
+
+CTEST(hmap, get_batch_cstr) {
+    StrMap map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        hmap_put_cstr(&map, &((StrEntry){.key = key, .value = i}));
+    }
+    const char* keys[] = {"key 1", "key 99", "missing", "key 42"};
+    StrEntry* outs[EXT_ARR_SIZE(keys)];
+    hmap_get_batch_cstr(&map, keys, EXT_ARR_SIZE(keys), outs);
+    ASSERT_TRUE(outs[0] != NULL && outs[0]->value == 1);
+    ASSERT_TRUE(outs[1] != NULL && outs[1]->value == 99);
+    ASSERT_TRUE(outs[2] == NULL);
+    ASSERT_TRUE(outs[3] != NULL && outs[3]->value == 42);
 
     hmap_free(&map);
     temp_reset();
 }
 
+CTEST(hmap, entry_cstr) {
+    const char* words[] = {"the", "quick", "fox", "jumps", "over", "the", "lazy", "fox", "the"};
+    StrMap map = {0};
+    for(size_t i = 0; i < ARR_SIZE(words); i++) {
+        StrEntry* e;
+        bool inserted;
+        hmap_entry_cstr(&map, words[i], &e, &inserted);
+        e->value++;
+    }
+    ASSERT_TRUE(map.size == 6);
+
+    StrEntry* e;
+    hmap_get_cstr(&map, "the", &e);
+    ASSERT_TRUE(e != NULL && e->value == 3);
+    hmap_get_cstr(&map, "fox", &e);
+    ASSERT_TRUE(e != NULL && e->value == 2);
+    hmap_get_cstr(&map, "lazy", &e);
+    ASSERT_TRUE(e != NULL && e->value == 1);
+
+    hmap_free(&map);
+}
+
+CTEST(hmap, delete_cstr) {
+    StrEntry* e;
+    StrMap map = {0};
+
+    for(int i = 1; i < 50; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        hmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+
+    hmap_get_cstr(&map, "key 1", &e);
+    ASSERT_TRUE(e != NULL);
+    ASSERT_TRUE(e->value == 10);
+
+    ASSERT_TRUE(map.size == 49);
+    hmap_delete_cstr(&map, "key 1");
+    ASSERT_TRUE(map.size == 48);
+    hmap_get_cstr(&map, "key 1", &e);
+    ASSERT_TRUE(e == NULL);
+
+    for(int i = 2; i < 50; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        hmap_delete_cstr(&map, key);
+    }
+    for(int i = 2; i < 50; i++) {
+        StrEntry* e;
+        const char* key = temp_sprintf("key %d", i);
+        hmap_get_cstr(&map, key, &e);
+        ASSERT_TRUE(e == NULL);
+    }
+    ASSERT_TRUE(map.size == 0);
+
+    hmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    StringSlice key;
+    int value;
+} SliceEntry;
+
+typedef struct {
+    SliceEntry* entries;
+    size_t* hashes;
+    size_t capacity, size, tombstones;
+    Allocator* allocator;
+} SliceMap;
+
+CTEST(hmap, get_put_ss) {
+    SliceMap map = {0};
+    for(int i = 0; i < 22; i++) {
+        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
+        hmap_put_ss(&map, &((SliceEntry){.key = key, .value = i * 10}));
+    }
+
+    ASSERT_TRUE(map.size == 22);
+    hmap_put_ss(&map, &((SliceEntry){.key = ss_from_cstr("key 2"), .value = 100}));
+    ASSERT_TRUE(map.size == 22);
+
+    SliceEntry* entry;
+    ext_hmap_get_ss(&map, ss_from_cstr("key 2"), &entry);
+    ASSERT_TRUE(entry != NULL);
+    ASSERT_TRUE(entry->value == 100);
+    entry->value += 50;
+
+    SliceEntry* entry2;
+    hmap_get_ss(&map, ss_from_cstr("key 2"), &entry2);
+    ASSERT_TRUE(entry == entry2);
+    ASSERT_TRUE(entry2->value == 150);
+
+    SliceEntry* entry3;
+    hmap_get_ss(&map, ss_from_cstr("key 30"), &entry3);
+    ASSERT_TRUE(entry3 == NULL);
+
+    hmap_free(&map);
+    temp_reset();
+}
+
+CTEST(hmap, delete_ss) {
+    SliceEntry* e;
+    SliceMap map = {0};
+
+    for(int i = 1; i < 50; i++) {
+        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
+        hmap_put_ss(&map, &((SliceEntry){.key = key, .value = i * 10}));
+    }
+
+    hmap_get_ss(&map, ss_from_cstr("key 1"), &e);
+    ASSERT_TRUE(e != NULL);
+    ASSERT_TRUE(e->value == 10);
+
+    ASSERT_TRUE(map.size == 49);
+    hmap_delete_ss(&map, ss_from_cstr("key 1"));
+    ASSERT_TRUE(map.size == 48);
+    hmap_get_ss(&map, ss_from_cstr("key 1"), &e);
+    ASSERT_FALSE(e != NULL);
+
+    for(int i = 2; i < 50; i++) {
+        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
+        hmap_delete_ss(&map, key);
+    }
+    for(int i = 2; i < 50; i++) {
+        SliceEntry* e;
+        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
+        hmap_get_ss(&map, key, &e);
+        ASSERT_TRUE(e == NULL);
+    }
+    ASSERT_TRUE(map.size == 0);
+
+    hmap_free(&map);
+    temp_reset();
+}
+
+CTEST(hmap, entry_ss) {
+    SliceMap map = {0};
+    StringSlice text = ss_from_cstr("a b a c b a");
+    while(text.size) {
+        StringSlice word = ss_split_once(&text, ' ');
+        SliceEntry* e;
+        bool inserted;
+        hmap_entry_ss(&map, word, &e, &inserted);
+        ASSERT_TRUE(ss_eq(e->key, word));
+        e->value++;
+    }
+    ASSERT_TRUE(map.size == 3);
+
+    SliceEntry* e;
+    hmap_get_ss(&map, ss_from_cstr("a"), &e);
+    ASSERT_TRUE(e != NULL && e->value == 3);
+    hmap_get_ss(&map, ss_from_cstr("b"), &e);
+    ASSERT_TRUE(e != NULL && e->value == 2);
+    hmap_get_ss(&map, ss_from_cstr("c"), &e);
+    ASSERT_TRUE(e != NULL && e->value == 1);
+
+    hmap_free(&map);
+}
+
+typedef struct {
+    IntEntry* entries;
+    uint8_t* ctrl;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+} IntSwissMap;
+
+CTEST(swmap, get_put) {
+    IntSwissMap map = {0};
+    IntEntry* e;
+    swmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    for(int i = 0; i < 1000; i++) {
+        swmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 1000);
+    swmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 1000);
+
+    for(int i = 0; i < 1000; i++) {
+        swmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+    }
+    swmap_get(&map, &((IntEntry){.key = 1000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    swmap_free(&map);
+}
+
+CTEST(swmap, delete) {
+    IntSwissMap map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 200; i++) {
+        swmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    for(int i = 0; i < 200; i += 2) {
+        swmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 100);
+    for(int i = 0; i < 200; i++) {
+        swmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 2 != 0));
+    }
+
+    // Churn: the table must reclaim tombstones instead of growing forever
+    size_t capacity = map.capacity;
+    for(int i = 200; i < 20000; i++) {
+        swmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        swmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 100);
+    ASSERT_TRUE(map.capacity == capacity);
+    for(int i = 1; i < 200; i += 2) {
+        swmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+
+    swmap_free(&map);
+}
+
+CTEST(swmap, clear_iter) {
+    IntSwissMap map = {0};
+    for(int i = 0; i < 50; i++) {
+        swmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    int count = 0, sum = 0;
+    swmap_foreach(IntEntry, it, &map) {
+        count++;
+        sum += it->key;
+    }
+    ASSERT_TRUE(count == 50);
+    ASSERT_TRUE(sum == 49 * 50 / 2);
+
+    swmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(swmap_begin(&map) == swmap_end(&map));
+    IntEntry* e;
+    swmap_get(&map, &((IntEntry){.key = 3}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    swmap_free(&map);
+}
+
+typedef struct {
+    SliceEntry* entries;
+    uint8_t* ctrl;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+} SliceSwissMap;
+
+CTEST(swmap, get_put_ss) {
+    SliceSwissMap map = {0};
+    for(int i = 0; i < 100; i++) {
+        StringSlice key = ss_from_cstr(temp_sprintf("key %d", i));
+        swmap_put_ss(&map, &((SliceEntry){.key = key, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 100);
+
+    SliceEntry* e;
+    swmap_get_ss(&map, ss_from_cstr("key 42"), &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    swmap_delete_ss(&map, ss_from_cstr("key 42"));
+    swmap_get_ss(&map, ss_from_cstr("key 42"), &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    swmap_free(&map);
+    temp_reset();
+}
+
+static bool rhmap_check_invariant(const IntMap* map) {
+    // Every entry must be reachable from its home slot without crossing an empty slot, and there
+    // must be no tombstones
+    for(size_t i = 0; i <= map->capacity; i++) {
+        size_t h = map->hashes[i];
+        if(EXT_HMAP_IS_TOMB(h)) return false;
+        if(EXT_HMAP_IS_EMPTY(h)) continue;
+        for(size_t j = h & map->capacity; j != i; j = (j + 1) & map->capacity) {
+            if(EXT_HMAP_IS_EMPTY(map->hashes[j])) return false;
+        }
+    }
+    return true;
+}
+
+CTEST(rhmap, get_put) {
+    IntMap map = {0};
+    IntEntry* e;
+    rhmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    for(int i = 0; i < 1000; i++) {
+        rhmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 1000);
+    rhmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 1000);
+    ASSERT_TRUE(rhmap_check_invariant(&map));
+
+    for(int i = 0; i < 1000; i++) {
+        rhmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+    }
+    rhmap_get(&map, &((IntEntry){.key = 1000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    int count = 0;
+    rhmap_foreach(IntEntry, it, &map) {
+        count++;
+    }
+    ASSERT_TRUE(count == 1000);
+
+    rhmap_free(&map);
+}
+
+CTEST(rhmap, delete) {
+    IntMap map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 500; i++) {
+        rhmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    for(int i = 0; i < 500; i += 3) {
+        rhmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(rhmap_check_invariant(&map));
+    for(int i = 0; i < 500; i++) {
+        rhmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 3 != 0));
+    }
+
+    size_t size = map.size, capacity = map.capacity;
+    for(int i = 500; i < 20000; i++) {
+        rhmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        rhmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == size);
+    ASSERT_TRUE(map.capacity == capacity);
+    ASSERT_TRUE(rhmap_check_invariant(&map));
+
+    for(int i = 0; i < 500; i++) {
+        rhmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(rhmap_begin(&map) == rhmap_end(&map));
+
+    rhmap_free(&map);
+}
+
+CTEST(rhmap, get_put_cstr) {
+    StrMap map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        rhmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    rhmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    rhmap_delete_cstr(&map, "key 42");
+    rhmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    rhmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    IntEntry* entries;
+    size_t* hashes;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+    IntEntry* old_entries;
+    size_t* old_hashes;
+    size_t old_capacity, migrated;
+} IntIncMap;
+
+typedef struct {
+    StrEntry* entries;
+    size_t* hashes;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+    StrEntry* old_entries;
+    size_t* old_hashes;
+    size_t old_capacity, migrated;
+} StrIncMap;
+
+CTEST(ihmap, get_put) {
+    IntIncMap map = {0};
+    IntEntry* e;
+    ihmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    bool saw_rehash = false;
+    for(int i = 0; i < 1000; i++) {
+        ihmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+        if(map.old_entries) {
+            saw_rehash = true;
+            // All keys must be reachable while the rehash is in progress
+            for(int j = 0; j <= i; j++) {
+                ihmap_get(&map, &((IntEntry){.key = j}), &e);
+                ASSERT_TRUE(e != NULL && e->value == j * 10);
+            }
+        }
+    }
+    ASSERT_TRUE(saw_rehash);
+    ASSERT_TRUE(map.size == 1000);
+    ihmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 1000);
+
+    for(int i = 0; i < 1000; i++) {
+        ihmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+    }
+    ihmap_get(&map, &((IntEntry){.key = 1000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    ihmap_free(&map);
+}
+
+CTEST(ihmap, rehash_in_progress) {
+    IntIncMap map = {0};
+    IntEntry* e;
+    int n = 0;
+    while(!map.old_entries) {
+        ihmap_put(&map, &((IntEntry){.key = n, .value = n}));
+        n++;
+    }
+
+    // Overwrite and delete keys that may still be in the old table
+    ihmap_put(&map, &((IntEntry){.key = 0, .value = -1}));
+    ihmap_delete(&map, &((IntEntry){.key = 1}));
+    ASSERT_TRUE(map.size == (size_t)n - 1);
+
+    int count = 0;
+    ihmap_foreach(IntEntry, it, &map) {
+        ASSERT_TRUE(it->key != 1);
+        ASSERT_TRUE(it->value == (it->key == 0 ? -1 : it->key));
+        count++;
+    }
+    ASSERT_TRUE(count == n - 1);
+
+    // Enough operations complete the migration and release the old table
+    for(int i = 0; i < n && map.old_entries; i++) {
+        ihmap_get(&map, &((IntEntry){.key = i}), &e);
+    }
+    ASSERT_TRUE(map.old_entries == NULL);
+    ihmap_get(&map, &((IntEntry){.key = 0}), &e);
+    ASSERT_TRUE(e != NULL && e->value == -1);
+    ihmap_get(&map, &((IntEntry){.key = 1}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    ihmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(ihmap_begin(&map) == ihmap_end(&map));
+
+    ihmap_free(&map);
+}
+
+CTEST(ihmap, churn) {
+    IntIncMap map = {0};
+    // Deletes leave tombstones, that must trigger a rehash instead of filling up the table
+    for(int i = 0; i < 100000; i++) {
+        ihmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        ihmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(map.capacity + 1 == EXT_HMAP_INIT_CAPACITY);
+    IntEntry* e;
+    ihmap_get(&map, &((IntEntry){.key = 42}), &e);
+    ASSERT_TRUE(e == NULL);
+    ihmap_free(&map);
+}
+
+CTEST(ihmap, get_put_cstr) {
+    StrIncMap map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        ihmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    ihmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    ihmap_delete_cstr(&map, "key 42");
+    ihmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    ihmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    IntMap map;
+    Mutex lock;
+} IntShard;
+
+typedef struct {
+    IntShard* shards;
+    size_t shard_count;
+    Allocator* allocator;
+} IntShardedMap;
+
+CTEST(shmap, get_put) {
+    IntShardedMap map = {0};
+    shmap_init(&map, 16);
+    ASSERT_TRUE(map.shard_count == 16);
+
+    IntEntry e;
+    bool found;
+    shmap_get(&map, &((IntEntry){.key = 2}), &e, &found);
+    ASSERT_FALSE(found);
+
+    for(int i = 0; i < 1000; i++) {
+        shmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    shmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    size_t size;
+    shmap_size(&map, &size);
+    ASSERT_TRUE(size == 1000);
+
+    // Keys must be spread over the shards
+    for(size_t i = 0; i < map.shard_count; i++) {
+        ASSERT_TRUE(map.shards[i].map.size > 0);
+    }
+
+    for(int i = 0; i < 1000; i++) {
+        shmap_get(&map, &((IntEntry){.key = i}), &e, &found);
+        ASSERT_TRUE(found);
+        ASSERT_TRUE(e.key == i && e.value == (i == 2 ? 100 : i * 10));
+    }
+
+    int count = 0;
+    shmap_foreach(IntEntry, it, &map) {
+        count++;
+    }
+    ASSERT_TRUE(count == 1000);
+
+    shmap_free(&map);
+    ASSERT_TRUE(map.shards == NULL);
+}
+
+CTEST(shmap, delete_clear) {
+    IntShardedMap map = {0};
+    shmap_init(&map, 4);
+
+    IntEntry e;
+    bool found;
+    shmap_delete(&map, &((IntEntry){.key = 1}));
+    for(int i = 0; i < 100; i++) {
+        shmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    for(int i = 0; i < 100; i += 2) {
+        shmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    for(int i = 0; i < 100; i++) {
+        shmap_get(&map, &((IntEntry){.key = i}), &e, &found);
+        ASSERT_TRUE(found == (i % 2 != 0));
+    }
+    size_t size;
+    shmap_size(&map, &size);
+    ASSERT_TRUE(size == 50);
+
+    shmap_clear(&map);
+    shmap_size(&map, &size);
+    ASSERT_TRUE(size == 0);
+    shmap_get(&map, &((IntEntry){.key = 1}), &e, &found);
+    ASSERT_FALSE(found);
+
+    shmap_free(&map);
+}
+
+typedef struct {
+    StrMap map;
+    Mutex lock;
+} StrShard;
+
+typedef struct {
+    StrShard* shards;
+    size_t shard_count;
+    Allocator* allocator;
+} StrShardedMap;
+
+CTEST(shmap, get_put_cstr) {
+    StrShardedMap map = {0};
+    shmap_init(&map, 8);
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        shmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry e;
+    bool found;
+    shmap_get_cstr(&map, "key 42", &e, &found);
+    ASSERT_TRUE(found && e.value == 420);
+    shmap_delete_cstr(&map, "key 42");
+    shmap_get_cstr(&map, "key 42", &e, &found);
+    ASSERT_FALSE(found);
+
+    shmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    int x, y;
+} Point;
+
+static size_t hash_point(Point p) {
+    return ext_hash_bytes_(&p, sizeof(p));
+}
+
+static bool point_eq(Point a, Point b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+EXT_DECLARE_HMAP(PointMap, pointmap, Point, int, hash_point, point_eq)
+EXT_DECLARE_HMAP_INT(IntIntMap, intmap, int, int)
+EXT_DECLARE_HMAP_EX(U64Map, u64map, uint64_t, const char*, ext_hmap_hash_int_, ext_hmap_int_eq_,
+                    static)
+// Never used: its `static` functions must not trigger unused function warnings
+EXT_DECLARE_HMAP_EX(UnusedMap, unusedmap, int, int, ext_hmap_hash_int_, ext_hmap_int_eq_, static)
+
+CTEST(shmap, put_all_parallel) {
+    size_t n = 20000;
+    IntEntry* entries = ext_alloc(sizeof(*entries) * n);
+    for(size_t i = 0; i < n; i++) {
+        entries[i] = (IntEntry){.key = (int)(i % (n / 2)), .value = (int)i};
+    }
+    IntShardedMap map = {0};
+    shmap_init(&map, 16);
+    shmap_put(&map, &((IntEntry){.key = -1, .value = -1}));
+    shmap_put_all_parallel(&map, entries, n, 4);
+    size_t size;
+    shmap_size(&map, &size);
+    ASSERT_TRUE(size == n / 2 + 1);
+    for(size_t i = 0; i < n / 2; i++) {
+        IntEntry e;
+        bool found;
+        shmap_get(&map, &((IntEntry){.key = (int)i}), &e, &found);
+        ASSERT_TRUE(found && e.value == (int)(i + n / 2));
+    }
+    shmap_free(&map);
+    ext_free(entries, sizeof(*entries) * n);
+}
+
+CTEST(typed_hmap, int_keys) {
+    IntIntMap map = {0};
+    ASSERT_TRUE(intmap_get(&map, 1) == NULL);
+    ASSERT_FALSE(intmap_delete(&map, 1));
+
+    for(int i = 0; i < 1000; i++) {
+        intmap_put(&map, i, i * 10);
+    }
+    intmap_put(&map, 2, 100);
+    ASSERT_TRUE(map.size == 1000);
+    for(int i = 0; i < 1000; i++) {
+        int* v = intmap_get(&map, i);
+        ASSERT_TRUE(v != NULL);
+        ASSERT_TRUE(*v == (i == 2 ? 100 : i * 10));
+    }
+    ASSERT_TRUE(intmap_get(&map, 1000) == NULL);
+
+    for(int i = 0; i < 1000; i += 2) {
+        ASSERT_TRUE(intmap_delete(&map, i));
+    }
+    ASSERT_FALSE(intmap_delete(&map, 0));
+    ASSERT_TRUE(map.size == 500);
+    for(int i = 0; i < 1000; i++) {
+        ASSERT_TRUE((intmap_get(&map, i) != NULL) == (i % 2 != 0));
+    }
+
+    // The generic hmap macros work on the generated struct
+    int count = 0;
+    hmap_foreach(IntIntMapEntry, it, &map) {
+        ASSERT_TRUE(it->key % 2 != 0 && it->value == it->key * 10);
+        count++;
+    }
+    ASSERT_TRUE(count == 500);
+
+    intmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(intmap_get(&map, 1) == NULL);
+
+    intmap_free(&map);
+}
+
+CTEST(typed_hmap, custom_keys) {
+    PointMap map = {0};
+    pointmap_reserve(&map, 100);
+    size_t capacity = map.capacity;
+    for(int i = 0; i < 10; i++) {
+        for(int j = 0; j < 10; j++) {
+            pointmap_put(&map, (Point){i, j}, i * 10 + j);
+        }
+    }
+    ASSERT_TRUE(map.size == 100);
+    ASSERT_TRUE(map.capacity == capacity);
+    int* v = pointmap_get(&map, (Point){4, 2});
+    ASSERT_TRUE(v != NULL && *v == 42);
+    ASSERT_TRUE(pointmap_delete(&map, (Point){4, 2}));
+    ASSERT_TRUE(pointmap_get(&map, (Point){4, 2}) == NULL);
+    ASSERT_TRUE(pointmap_get(&map, (Point){10, 10}) == NULL);
+    pointmap_free(&map);
+
+    U64Map names = {0};
+    u64map_put(&names, UINT64_MAX, "max");
+    u64map_put(&names, 0, "zero");
+    ASSERT_STR(*u64map_get(&names, UINT64_MAX), "max");
+    ASSERT_STR(*u64map_get(&names, 0), "zero");
+    ASSERT_TRUE(u64map_delete(&names, 0));
+    u64map_clear(&names);
+    u64map_reserve(&names, 1);
+    u64map_free(&names);
+}
+
+typedef struct {
+    IntEntry* entries;
+    size_t* hashes;
+    void* index;
+    size_t size, used, capacity;
+    Allocator* allocator;
+} IntDenseMap;
+
+CTEST(dmap, get_put) {
+    IntDenseMap map = {0};
+    IntEntry* e;
+    dmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(dmap_begin(&map) == dmap_end(&map));
+
+    // Crosses the 8 and 16 bit index widths
+    for(int i = 0; i < 100000; i++) {
+        dmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 100000);
+    dmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 100000);
+
+    for(int i = 0; i < 100000; i++) {
+        dmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+    }
+    dmap_get(&map, &((IntEntry){.key = 100000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    // Iteration follows insertion order
+    int expected = 0;
+    dmap_foreach(IntEntry, it, &map) {
+        ASSERT_TRUE(it->key == expected);
+        expected++;
+    }
+    ASSERT_TRUE(expected == 100000);
+
+    dmap_free(&map);
+}
+
+CTEST(dmap, delete) {
+    IntDenseMap map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 100; i++) {
+        dmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    for(int i = 0; i < 100; i += 3) {
+        dmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 66);
+    for(int i = 0; i < 100; i++) {
+        dmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 3 != 0));
+    }
+
+    // Re-inserting a deleted key moves it last
+    dmap_put(&map, &((IntEntry){.key = 0, .value = -1}));
+    int prev = -1, count = 0;
+    dmap_foreach(IntEntry, it, &map) {
+        if(it->key == 0) {
+            ASSERT_TRUE(count == 66);
+        } else {
+            ASSERT_TRUE(it->key > prev && it->key % 3 != 0);
+            prev = it->key;
+        }
+        count++;
+    }
+    ASSERT_TRUE(count == 67);
+
+    // Churn compacts the holes instead of growing the table
+    size_t capacity = map.capacity;
+    for(int i = 100; i < 20000; i++) {
+        dmap_put(&map, &((IntEntry){.key = i, .value = i}));
+        dmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 67);
+    ASSERT_TRUE(map.capacity == capacity);
+
+    dmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(dmap_begin(&map) == dmap_end(&map));
+    dmap_get(&map, &((IntEntry){.key = 1}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    dmap_free(&map);
+}
+
+CTEST(dmap, get_put_cstr) {
+    struct {
+        StrEntry* entries;
+        size_t* hashes;
+        void* index;
+        size_t size, used, capacity;
+        Allocator* allocator;
+    } map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        dmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    dmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    dmap_delete_cstr(&map, "key 42");
+    dmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    dmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    int* entries;
+    uint32_t* hashes;
+    size_t size, tombstones, capacity;
+    Allocator* allocator;
+} IntSet;
+
+CTEST(hset, add_contains) {
+    IntSet set = {0};
+    bool found;
+    hset_contains(&set, &((int){1}), &found);
+    ASSERT_FALSE(found);
+    hset_remove(&set, &((int){1}));
+
+    for(int i = 0; i < 1000; i++) {
+        hset_add(&set, &i);
+        hset_add(&set, &i);
+    }
+    ASSERT_TRUE(set.size == 1000);
+    for(int i = 0; i < 2000; i++) {
+        hset_contains(&set, &i, &found);
+        ASSERT_TRUE(found == (i < 1000));
+    }
+
+    for(int i = 0; i < 1000; i += 2) {
+        hset_remove(&set, &i);
+    }
+    ASSERT_TRUE(set.size == 500);
+    int count = 0;
+    hset_foreach(int, it, &set) {
+        ASSERT_TRUE(*it % 2 != 0);
+        count++;
+    }
+    ASSERT_TRUE(count == 500);
+
+    hset_clear(&set);
+    ASSERT_TRUE(set.size == 0);
+    hset_contains(&set, &((int){1}), &found);
+    ASSERT_FALSE(found);
+
+    hset_free(&set);
+}
+
+CTEST(hset, strings) {
+    struct {
+        const char** entries;
+        size_t* hashes;
+        size_t size, tombstones, capacity;
+        Allocator* allocator;
+    } set = {0};
+    const char* words[] = {"the", "quick", "fox", "jumps", "over", "the", "lazy", "fox"};
+    for(size_t i = 0; i < ARR_SIZE(words); i++) {
+        hset_add_cstr(&set, words[i]);
+    }
+    ASSERT_TRUE(set.size == 6);
+    bool found;
+    hset_contains_cstr(&set, "lazy", &found);
+    ASSERT_TRUE(found);
+    hset_remove_cstr(&set, "lazy");
+    hset_contains_cstr(&set, "lazy", &found);
+    ASSERT_FALSE(found);
+    hset_free(&set);
+
+    struct {
+        StringSlice* entries;
+        size_t* hashes;
+        size_t size, tombstones, capacity;
+        Allocator* allocator;
+    } ss_set = {0};
+    StringSlice text = ss_from_cstr("a b a c b a");
+    while(text.size) {
+        hset_add_ss(&ss_set, ss_split_once(&text, ' '));
+    }
+    ASSERT_TRUE(ss_set.size == 3);
+    hset_contains_ss(&ss_set, ss_from_cstr("c"), &found);
+    ASSERT_TRUE(found);
+    hset_remove_ss(&ss_set, ss_from_cstr("c"));
+    hset_contains_ss(&ss_set, ss_from_cstr("c"), &found);
+    ASSERT_FALSE(found);
+    hset_free(&ss_set);
+}
+
+typedef struct {
+    uint64_t* entries;
+    size_t size, capacity;
+    bool has_zero;
+    Allocator* allocator;
+} IdSet;
+
+CTEST(iset, add_contains) {
+    IdSet set = {0};
+    bool found;
+    iset_contains(&set, 1, &found);
+    ASSERT_FALSE(found);
+    iset_remove(&set, 1);
+
+    // The zero key is stored out of the table
+    iset_add(&set, 0);
+    iset_contains(&set, 0, &found);
+    ASSERT_TRUE(found);
+    ASSERT_TRUE(set.size == 1);
+
+    for(uint64_t i = 0; i < 10000; i++) {
+        iset_add(&set, i * 7919);
+    }
+    iset_add(&set, UINT64_MAX);
+    ASSERT_TRUE(set.size == 10001);
+    for(uint64_t i = 0; i < 10000; i++) {
+        iset_contains(&set, i * 7919, &found);
+        ASSERT_TRUE(found);
+        iset_contains(&set, i * 7919 + 1, &found);
+        ASSERT_FALSE(found);
+    }
+    iset_contains(&set, UINT64_MAX, &found);
+    ASSERT_TRUE(found);
+
+    size_t count = 0;
+    bool zero_found = false;
+    iset_foreach(uint64_t, it, &set) {
+        if(*it == 0) zero_found = true;
+        count++;
+    }
+    ASSERT_TRUE(count == 10001);
+    ASSERT_TRUE(zero_found);
+
+    iset_remove(&set, 0);
+    iset_contains(&set, 0, &found);
+    ASSERT_FALSE(found);
+    ASSERT_TRUE(set.size == 10000);
+
+    iset_clear(&set);
+    ASSERT_TRUE(set.size == 0);
+    iset_contains(&set, 7919, &found);
+    ASSERT_FALSE(found);
+    iset_free(&set);
+}
+
+CTEST(iset, remove) {
+    // Random adds and removes, checked against a plain bitmap
+    IdSet set = {0};
+    static bool present[4096];
+    memset(present, 0, sizeof(present));
+    uint32_t rng = 12345;
+    size_t expected = 0;
+    for(int i = 0; i < 200000; i++) {
+        rng = rng * 1103515245 + 12345;
+        uint64_t key = (rng >> 8) % 4096;
+        if((rng >> 4) & 1) {
+            iset_add(&set, key);
+            if(!present[key]) expected++;
+            present[key] = true;
+        } else {
+            iset_remove(&set, key);
+            if(present[key]) expected--;
+            present[key] = false;
+        }
+    }
+    ASSERT_TRUE(set.size == expected);
+    for(uint64_t key = 0; key < 4096; key++) {
+        bool found;
+        iset_contains(&set, key, &found);
+        ASSERT_TRUE(found == present[key]);
+    }
+    iset_free(&set);
+}
+
+CTEST(iset, small_keys) {
+    struct {
+        int8_t* entries;
+        size_t size, capacity;
+        bool has_zero;
+        Allocator* allocator;
+    } set = {0};
+    for(int i = -128; i < 128; i++) {
+        iset_add(&set, (int8_t)i);
+    }
+    ASSERT_TRUE(set.size == 256);
+    iset_reserve(&set, 1000);
+    for(int i = -128; i < 128; i++) {
+        bool found;
+        iset_contains(&set, (int8_t)i, &found);
+        ASSERT_TRUE(found);
+    }
+    iset_remove(&set, -1);
+    iset_remove(&set, -128);
+    ASSERT_TRUE(set.size == 254);
+    int sum = 0;
+    iset_foreach(int8_t, it, &set) {
+        sum += *it;
+    }
+    ASSERT_TRUE(sum == -128 + 1 + 128);
+    iset_free(&set);
+}
+
+typedef struct {
+    IntEntry* entries;
+    size_t* hashes;
+    size_t size, tombstones, capacity;
+    size_t generation;
+    Allocator* allocator;
+} IntScratchMap;
+
+CTEST(ghmap, get_put) {
+    IntScratchMap map = {0};
+    IntEntry* e;
+    ghmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    for(int i = 0; i < 1000; i++) {
+        ghmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 1000);
+    ghmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 1000);
+    for(int i = 0; i < 1000; i++) {
+        ghmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+    }
+
+    for(int i = 0; i < 1000; i += 2) {
+        ghmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 500);
+    int count = 0;
+    ghmap_foreach(IntEntry, it, &map) {
+        ASSERT_TRUE(it->key % 2 == 1);
+        count++;
+    }
+    ASSERT_TRUE(count == 500);
+
+    ghmap_free(&map);
+}
+
+CTEST(ghmap, clear) {
+    IntScratchMap map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 100; i++) {
+        ghmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    size_t capacity = map.capacity;
+    ghmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(map.capacity == capacity);
+    ASSERT_TRUE(ghmap_begin(&map) == ghmap_end(&map));
+    for(int i = 0; i < 100; i++) {
+        ghmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e == NULL);
+    }
+
+    // Entries of a previous generation must not resurface after a rehash
+    for(int i = 0; i < 1000; i++) {
+        ghmap_put(&map, &((IntEntry){.key = i + 1000, .value = i}));
+    }
+    ASSERT_TRUE(map.size == 1000);
+    for(int i = 0; i < 100; i++) {
+        ghmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e == NULL);
+    }
+    ghmap_free(&map);
+}
+
+CTEST(ghmap, clear_wraparound) {
+    IntScratchMap map = {0};
+    IntEntry* e;
+    ghmap_put(&map, &((IntEntry){.key = -1, .value = -1}));
+    ghmap_clear(&map);
+    // Go through the generation counter more than once, leaving stale slots from every generation
+    for(size_t i = 0; i < 2 * EXT_GHMAP_MAX_GENERATION + 10; i++) {
+        ASSERT_TRUE(map.generation >= 1 && map.generation <= EXT_GHMAP_MAX_GENERATION);
+        int key = (int)(i % 64);
+        ghmap_put(&map, &((IntEntry){.key = key, .value = (int)i}));
+        ghmap_get(&map, &((IntEntry){.key = key}), &e);
+        ASSERT_TRUE(e != NULL && e->value == (int)i);
+        ghmap_get(&map, &((IntEntry){.key = key + 1}), &e);
+        ASSERT_TRUE(e == NULL);
+        ASSERT_TRUE(map.size == 1);
+        ghmap_clear(&map);
+    }
+    ghmap_get(&map, &((IntEntry){.key = -1}), &e);
+    ASSERT_TRUE(e == NULL);
+    ghmap_free(&map);
+}
+
+CTEST(ghmap, get_put_cstr) {
+    struct {
+        StrEntry* entries;
+        size_t* hashes;
+        size_t size, tombstones, capacity;
+        size_t generation;
+        Allocator* allocator;
+    } map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        ghmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    ghmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    ghmap_delete_cstr(&map, "key 42");
+    ghmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+    ghmap_clear(&map);
+    ghmap_get_cstr(&map, "key 1", &e);
+    ASSERT_TRUE(e == NULL);
+
+    ghmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    int key;
+    char value[200];
+} BigEntry;
+
+typedef struct {
+    BigEntry** entries;
+    size_t* hashes;
+    size_t size, tombstones, capacity;
+    void *slabs, *free_nodes;
+    Allocator* allocator;
+} BigNodeMap;
+
+CTEST(nmap, get_put) {
+    BigNodeMap map = {0};
+    BigEntry* e;
+    nmap_get(&map, &((BigEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    nmap_put(&map, &((BigEntry){.key = 0, .value = "zero"}));
+    BigEntry* first;
+    nmap_get(&map, &((BigEntry){.key = 0}), &first);
+    ASSERT_TRUE(first != NULL);
+
+    for(int i = 1; i < 1000; i++) {
+        BigEntry entry = {.key = i};
+        snprintf(entry.value, sizeof(entry.value), "%d", i);
+        nmap_put(&map, &entry);
+    }
+    ASSERT_TRUE(map.size == 1000);
+
+    // The table grew many times, but the entries never moved
+    nmap_get(&map, &((BigEntry){.key = 0}), &e);
+    ASSERT_TRUE(e == first);
+    ASSERT_TRUE(strcmp(first->value, "zero") == 0);
+
+    // Overwriting an entry updates it in place
+    nmap_put(&map, &((BigEntry){.key = 0, .value = "new"}));
+    ASSERT_TRUE(map.size == 1000);
+    ASSERT_TRUE(strcmp(first->value, "new") == 0);
+
+    for(int i = 1; i < 1000; i++) {
+        nmap_get(&map, &((BigEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->key == i && atoi(e->value) == i);
+    }
+    nmap_get(&map, &((BigEntry){.key = 1000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    nmap_free(&map);
+}
+
+CTEST(nmap, delete_reuses_nodes) {
+    BigNodeMap map = {0};
+    BigEntry* e;
+    for(int i = 0; i < 100; i++) {
+        nmap_put(&map, &((BigEntry){.key = i}));
+    }
+    BigEntry* deleted;
+    nmap_get(&map, &((BigEntry){.key = 42}), &deleted);
+    nmap_delete(&map, &((BigEntry){.key = 42}));
+    ASSERT_TRUE(map.size == 99);
+    nmap_get(&map, &((BigEntry){.key = 42}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    // The freed node is handed to the next insertion
+    nmap_put(&map, &((BigEntry){.key = 1000}));
+    nmap_get(&map, &((BigEntry){.key = 1000}), &e);
+    ASSERT_TRUE(e == deleted);
+
+    int count = 0;
+    nmap_foreach(BigEntry, it, &map) {
+        ASSERT_TRUE(it->key != 42);
+        count++;
+    }
+    ASSERT_TRUE(count == 100);
+
+    size_t allocated_before = allocated;
+    nmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(nmap_begin(&map) == nmap_end(&map));
+    for(int i = 0; i < 100; i++) {
+        nmap_put(&map, &((BigEntry){.key = i}));
+    }
+    // Refilling after a clear reuses the existing nodes
+    ASSERT_TRUE(allocated == allocated_before);
+
+    nmap_free(&map);
+}
+
+CTEST(nmap, get_put_cstr) {
+    struct {
+        StrEntry** entries;
+        size_t* hashes;
+        size_t size, tombstones, capacity;
+        void *slabs, *free_nodes;
+        Allocator* allocator;
+    } map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        nmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    nmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    nmap_delete_cstr(&map, "key 42");
+    nmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    nmap_free(&map);
+    temp_reset();
+}
+
+typedef struct {
+    IntEntry* entries;
+    size_t size, capacity;
+    Allocator* allocator;
+} IntCuckooMap;
+
+CTEST(ckmap, get_put) {
+    IntCuckooMap map = {0};
+    IntEntry* e;
+    ckmap_get(&map, &((IntEntry){.key = 2}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    for(int i = 0; i < 10000; i++) {
+        ckmap_put(&map, &((IntEntry){.key = i, .value = i * 10}));
+    }
+    ASSERT_TRUE(map.size == 10000);
+    ckmap_put(&map, &((IntEntry){.key = 2, .value = 100}));
+    ASSERT_TRUE(map.size == 10000);
+
+    for(int i = 0; i < 10000; i++) {
+        ckmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL);
+        ASSERT_TRUE(e->key == i && e->value == (i == 2 ? 100 : i * 10));
+        // Every entry lives in one of the two buckets of its hash
+        size_t idx = e - map.entries;
+        size_t hash = ext_ckmap_fix_hash_(ext_hmap_hash_bytes_(e));
+        size_t bucket = hash & map.capacity;
+        size_t alt = ext_ckmap_alt_bucket_(bucket, hash, map.capacity);
+        size_t units = ext_ckmap_bucket_units_(sizeof(IntEntry));
+        ASSERT_TRUE(idx / units == bucket || idx / units == alt);
+    }
+    ckmap_get(&map, &((IntEntry){.key = 10000}), &e);
+    ASSERT_TRUE(e == NULL);
+
+    // Buckets of 8-byte entries take exactly one cache line
+    ASSERT_TRUE((uintptr_t)map.entries % EXT_CKMAP_LINE_SIZE == 0);
+    ASSERT_TRUE(ext_ckmap_bucket_units_(sizeof(IntEntry)) * sizeof(IntEntry) ==
+                EXT_CKMAP_LINE_SIZE);
+
+    size_t count = 0;
+    ckmap_foreach(IntEntry, it, &map) {
+        count++;
+    }
+    ASSERT_TRUE(count == 10000);
+
+    ckmap_free(&map);
+}
+
+CTEST(ckmap, delete) {
+    IntCuckooMap map = {0};
+    IntEntry* e;
+    for(int i = 0; i < 1000; i++) {
+        ckmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        ckmap_delete(&map, &((IntEntry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 500);
+    for(int i = 0; i < 1000; i++) {
+        ckmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE((e != NULL) == (i % 2 == 1));
+    }
+
+    ckmap_clear(&map);
+    ASSERT_TRUE(map.size == 0);
+    ASSERT_TRUE(ckmap_begin(&map) == ckmap_end(&map));
+    ckmap_free(&map);
+}
+
+CTEST(ckmap, reserve) {
+    IntCuckooMap map = {0};
+    ckmap_reserve(&map, 5000);
+    size_t capacity = map.capacity;
+    // The table can be filled up to the reserved size without growing
+    for(int i = 0; i < 5000; i++) {
+        ckmap_put(&map, &((IntEntry){.key = i, .value = i}));
+    }
+    ASSERT_TRUE(map.capacity == capacity);
+    for(int i = 0; i < 5000; i++) {
+        IntEntry* e;
+        ckmap_get(&map, &((IntEntry){.key = i}), &e);
+        ASSERT_TRUE(e != NULL && e->value == i);
+    }
+    ckmap_free(&map);
+}
+
+CTEST(ckmap, odd_entry_size) {
+    // 12-byte entries don't fit a line, and buckets are only padded to keep the hashes aligned
+    typedef struct {
+        int key;
+        int value[2];
+    } Entry;
+    struct {
+        Entry* entries;
+        size_t size, capacity;
+        Allocator* allocator;
+    } map = {0};
+    ASSERT_TRUE(ext_ckmap_bucket_units_(sizeof(Entry)) * sizeof(Entry) % sizeof(size_t) == 0);
+    for(int i = 0; i < 1000; i++) {
+        ckmap_put(&map, &((Entry){.key = i, .value = {i, -i}}));
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        ckmap_delete(&map, &((Entry){.key = i}));
+    }
+    ASSERT_TRUE(map.size == 500);
+    for(int i = 0; i < 1000; i++) {
+        Entry* e;
+        ckmap_get(&map, &((Entry){.key = i}), &e);
+        ASSERT_TRUE(i % 2 == 0 ? e == NULL : e != NULL && e->value[0] == i && e->value[1] == -i);
+    }
+    size_t count = 0;
+    ckmap_foreach(Entry, it, &map) {
+        ASSERT_TRUE(it->key % 2 == 1);
+        count++;
+    }
+    ASSERT_TRUE(count == 500);
+    ckmap_free(&map);
+}
+
+CTEST(ckmap, get_put_cstr) {
+    struct {
+        StrEntry* entries;
+        size_t size, capacity;
+        Allocator* allocator;
+    } map = {0};
+    for(int i = 0; i < 100; i++) {
+        const char* key = temp_sprintf("key %d", i);
+        ckmap_put_cstr(&map, &((StrEntry){.key = key, .value = i * 10}));
+    }
+    StrEntry* e;
+    ckmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e != NULL && e->value == 420);
+    ckmap_delete_cstr(&map, "key 42");
+    ckmap_get_cstr(&map, "key 42", &e);
+    ASSERT_TRUE(e == NULL);
+    ASSERT_TRUE(map.size == 99);
+
+    ckmap_free(&map);
+    temp_reset();
+}
+
+// Fills a map of `IntEntry` in the temporary allocator, and checks that all entries survived the
+// moves to larger tables
+#define fill_temp_int_map(map, put, get)                      \
+    do {                                                      \
+        for(int i = 0; i < 1000; i++) {                       \
+            put(&(map), &((IntEntry){.key = i, .value = i})); \
+        }                                                     \
+        for(int i = 0; i < 1000; i++) {                       \
+            IntEntry* e;                                      \
+            get(&(map), &((IntEntry){.key = i}), &e);         \
+            ASSERT_TRUE(e != NULL && e->value == i);          \
+        }                                                     \
+    } while(0)
+
+// With LIFO allocators maps reclaim their old tables on growth, so the last table ends up where
+// the first one was allocated instead of leaving the old ones behind as dead memory
+CTEST(temp, map_growth) {
+    void* checkpoint = temp_checkpoint();
+
+    IntMap rh = {.allocator = &ext_temp_allocator.base};
+    fill_temp_int_map(rh, rhmap_put, rhmap_get);
+    ASSERT_TRUE((void*)rh.entries == checkpoint);
+    temp_rewind(checkpoint);
+
+    IntSwissMap sw = {.allocator = &ext_temp_allocator.base};
+    fill_temp_int_map(sw, swmap_put, swmap_get);
+    ASSERT_TRUE((void*)sw.entries == checkpoint);
+    temp_rewind(checkpoint);
+
+    IntDenseMap dense = {.allocator = &ext_temp_allocator.base};
+    fill_temp_int_map(dense, dmap_put, dmap_get);
+    ASSERT_TRUE((void*)dense.entries == checkpoint);
+    temp_rewind(checkpoint);
+
+    IntScratchMap scratch = {.allocator = &ext_temp_allocator.base};
+    fill_temp_int_map(scratch, ghmap_put, ghmap_get);
+    ASSERT_TRUE((void*)scratch.entries == checkpoint);
+    temp_rewind(checkpoint);
+
+    IntCuckooMap cuckoo = {.allocator = &ext_temp_allocator.base};
+    fill_temp_int_map(cuckoo, ckmap_put, ckmap_get);
+    // The cuckoo table is aligned to a cache line inside its block
+    ASSERT_TRUE((char*)cuckoo.entries - (char*)checkpoint <= EXT_CKMAP_LINE_SIZE);
+    temp_rewind(checkpoint);
+
+    IdSet set = {.allocator = &ext_temp_allocator.base};
+    for(uint64_t i = 1; i <= 1000; i++) {
+        iset_add(&set, i);
+    }
+    for(uint64_t i = 1; i <= 1000; i++) {
+        bool found;
+        iset_contains(&set, i, &found);
+        ASSERT_TRUE(found);
+    }
+    ASSERT_TRUE((void*)set.entries == checkpoint);
+    temp_rewind(checkpoint);
+}
+
 static void sb_log(Ext_LogLevel lvl, void* data, const char* fmt, va_list ap) {
     StringBuffer *sb = (StringBuffer*)data;
     switch(lvl) {
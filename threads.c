@@ -8,6 +8,7 @@
 
 #define THREAD_TMP_SIZE (256 * 1024 * 1024)
 #define THREAD_ITER     100
+#define SHARED_KEYS     10000
 
 typedef struct {
     int key;
@@ -17,10 +18,23 @@ typedef struct {
 typedef struct {
     IntEntry *entries;
     size_t *hashes;
-    size_t size, capacity;
+    size_t size, tombstones, capacity;
     Ext_Allocator *allocator;
 } IntHashMap;
 
+typedef struct {
+    IntHashMap map;
+    Mutex lock;
+} IntShard;
+
+typedef struct {
+    IntShard *shards;
+    size_t shard_count;
+    Ext_Allocator *allocator;
+} IntShardedMap;
+
+static IntShardedMap shared_map;
+
 typedef struct {
     int *items;
     size_t size, capacity;
@@ -81,8 +95,22 @@ static void ds_test(void) {
     printf("\n");
 }
 
+// Both threads write and read their own range of keys in the same map
+static void shared_map_test(int base) {
+    for(int i = base; i < base + SHARED_KEYS; i++) {
+        shmap_put(&shared_map, &((IntEntry){.key = i, .value = i * 2}));
+    }
+    for(int i = base; i < base + SHARED_KEYS; i++) {
+        IntEntry e;
+        bool found;
+        shmap_get(&shared_map, &((IntEntry){.key = i}), &e, &found);
+        assert(found && e.value == i * 2);
+    }
+}
+
 static int t2_start(void *data) {
     (void)data;
+    shared_map_test(SHARED_KEYS);
     void *temp = ext_alloc(THREAD_TMP_SIZE);
     temp_set_mem(temp, THREAD_TMP_SIZE);
 
@@ -102,6 +130,7 @@ static int t2_start(void *data) {
 
 static int t1_start(void *data) {
     (void)data;
+    shared_map_test(0);
     void *temp = ext_alloc(THREAD_TMP_SIZE);
     temp_set_mem(temp, THREAD_TMP_SIZE);
 
@@ -120,6 +149,8 @@ static int t1_start(void *data) {
 }
 
 int main(void) {
+    shmap_init(&shared_map, 16);
+
     thrd_t t1;
     if(thrd_create(&t1, t1_start, NULL) != thrd_success) {
         fprintf(stderr, "Couldn't create thread 1");
@@ -141,4 +172,10 @@ int main(void) {
         fprintf(stderr, "Couldn't join thread 2");
         abort();
     }
+
+    size_t size;
+    shmap_size(&shared_map, &size);
+    assert(size == 2 * SHARED_KEYS);
+    printf("Shared map entries: %zu\n", size);
+    shmap_free(&shared_map);
 }